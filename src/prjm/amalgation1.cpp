@@ -6,6 +6,7 @@
 //#include "src/ConfigFile.cpp"
 #include "src/fftsg.cpp"
 #include "src/KeyHandler.cpp"
+#include "src/MeshWorkerPool.cpp"
 #include "src/MilkdropPresetFactory/BuiltinFuncs.cpp"
 #include "src/MilkdropPresetFactory/BuiltinParams.cpp"
 #include "src/MilkdropPresetFactory/CustomShape.cpp"
@@ -20,6 +21,7 @@
 #include "src/MilkdropPresetFactory/Param.cpp"
 #include "src/MilkdropPresetFactory/PerFrameEqn.cpp"
 #include "src/MilkdropPresetFactory/PerPixelEqn.cpp"
+#include "src/MilkdropPresetFactory/PerPixelProgram.cpp"
 #include "src/MilkdropPresetFactory/PerPointEqn.cpp"
 #include "src/MilkdropPresetFactory/PresetFrameIO.cpp"
 #include "src/PCM.cpp"
@@ -28,6 +30,7 @@
 #include "src/PresetFactory.cpp"
 #include "src/PresetFactoryManager.cpp"
 #include "src/PresetLoader.cpp"
+#include "src/PresetPreloader.cpp"
 #include "src/projectM.cpp"
 #include "src/Renderer/BeatDetect.cpp"
 #include "src/Renderer/FBO.cpp"
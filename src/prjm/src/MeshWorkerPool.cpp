@@ -0,0 +1,258 @@
+/**
+ * projectM -- Milkdrop-esque visualisation SDK
+ * Copyright (C)2003-2007 projectM Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * See 'LICENSE.txt' included within this release
+ *
+ */
+
+// EDIT BY SJ: projectM's own USE_THREADS code is disabled for Silverjuke,
+// the pool uses the wxWidgets thread classes instead of pthreads.
+#include <wx/thread.h>
+#include <wx/time.h>
+#include <vector>
+#include "MeshWorkerPool.hpp"
+
+#define MESH_WORKERS_MAX 16
+
+class MeshWorkerThread;
+
+static struct {
+    wxMutex*            mutex;
+    wxCondition*        jobCond;    // signalled when a new job is available or on exit
+    wxCondition*        doneCond;   // signalled when the last thread has finished a job
+    std::vector<MeshWorkerThread*> threads;
+    bool                started;
+    bool                exit;
+
+    int                 configuredThreads;
+    bool                deterministic;
+
+    // the current job, protected by mutex
+    unsigned long       generation;
+    int                 pending;
+    int                 nextRow;
+    int                 rows;
+    int                 grain;
+    MeshWorkerPool::RowsFunc func;
+    void*               userData;
+
+    // timings, only used by the render thread
+    double              stageMicroseconds[MeshWorkerPool::NUM_STAGES];
+    int                 frames;
+} s_pool;
+
+static void doRows(int worker)
+{
+    const int workers = (int)s_pool.threads.size() + 1;
+
+    if (s_pool.deterministic)
+    {
+        int chunk = (s_pool.rows + workers - 1) / workers;
+        int begin = worker * chunk, end = begin + chunk;
+        if (end > s_pool.rows)
+            end = s_pool.rows;
+        if (begin < end)
+            s_pool.func(s_pool.userData, begin, end, worker);
+        return;
+    }
+
+    for (;;)
+    {
+        s_pool.mutex->Lock();
+        int begin = s_pool.nextRow;
+        s_pool.nextRow += s_pool.grain;
+        s_pool.mutex->Unlock();
+
+        if (begin >= s_pool.rows)
+            break;
+
+        int end = begin + s_pool.grain;
+        if (end > s_pool.rows)
+            end = s_pool.rows;
+        s_pool.func(s_pool.userData, begin, end, worker);
+    }
+}
+
+class MeshWorkerThread : public wxThread
+{
+public:
+    MeshWorkerThread(int worker, unsigned long generation)
+        : wxThread(wxTHREAD_JOINABLE), m_worker(worker), m_generation(generation) {}
+
+private:
+    int m_worker;
+    unsigned long m_generation;
+
+    void* Entry()
+    {
+        unsigned long seen = m_generation;
+
+        s_pool.mutex->Lock();
+        for (;;)
+        {
+            while (!s_pool.exit && s_pool.generation == seen)
+                s_pool.jobCond->Wait();
+            if (s_pool.exit)
+                break;
+            seen = s_pool.generation;
+
+            s_pool.mutex->Unlock();
+            doRows(m_worker);
+            s_pool.mutex->Lock();
+
+            if (--s_pool.pending == 0)
+                s_pool.doneCond->Signal();
+        }
+        s_pool.mutex->Unlock();
+        return 0;
+    }
+};
+
+static void startThreads()
+{
+    s_pool.started = true;
+
+    int wanted = s_pool.configuredThreads;
+    if (wanted <= 0)
+        wanted = wxThread::GetCPUCount();
+    if (wanted > MESH_WORKERS_MAX)
+        wanted = MESH_WORKERS_MAX;
+    if (wanted <= 1)
+        return;
+
+    if (s_pool.mutex == NULL)
+    {
+        s_pool.mutex = new wxMutex();
+        s_pool.jobCond = new wxCondition(*s_pool.mutex);
+        s_pool.doneCond = new wxCondition(*s_pool.mutex);
+    }
+
+    s_pool.exit = false;
+    for (int i = 1; i < wanted; i++)
+    {
+        MeshWorkerThread* thread = new MeshWorkerThread(i, s_pool.generation);
+        if (thread->Create() != wxTHREAD_NO_ERROR || thread->Run() != wxTHREAD_NO_ERROR)
+        {
+            delete thread; // not running, we can continue with the threads we have
+            break;
+        }
+        s_pool.threads.push_back(thread);
+    }
+}
+
+void MeshWorkerPool::run(int rows, RowsFunc func, void *userData)
+{
+    if (!s_pool.started)
+        startThreads();
+
+    if (rows <= 0)
+        return;
+
+    const int workers = (int)s_pool.threads.size() + 1;
+    if (workers <= 1 || rows < 2)
+    {
+        func(userData, 0, rows, 0);
+        return;
+    }
+
+    s_pool.mutex->Lock();
+    s_pool.func = func;
+    s_pool.userData = userData;
+    s_pool.rows = rows;
+    s_pool.nextRow = 0;
+    s_pool.grain = rows / (workers * 4);
+    if (s_pool.grain < 1)
+        s_pool.grain = 1;
+    s_pool.pending = workers - 1;
+    s_pool.generation++;
+    s_pool.jobCond->Broadcast();
+    s_pool.mutex->Unlock();
+
+    doRows(0);
+
+    s_pool.mutex->Lock();
+    while (s_pool.pending > 0)
+        s_pool.doneCond->Wait();
+    s_pool.mutex->Unlock();
+}
+
+void MeshWorkerPool::configure(int threads, bool deterministic)
+{
+    s_pool.deterministic = deterministic;
+    if (threads != s_pool.configuredThreads)
+    {
+        shutdown();
+        s_pool.configuredThreads = threads;
+    }
+}
+
+int MeshWorkerPool::maxWorkers()
+{
+    return MESH_WORKERS_MAX;
+}
+
+void MeshWorkerPool::shutdown()
+{
+    s_pool.started = false;
+    if (s_pool.threads.empty())
+        return;
+
+    s_pool.mutex->Lock();
+    s_pool.exit = true;
+    s_pool.jobCond->Broadcast();
+    s_pool.mutex->Unlock();
+
+    for (size_t i = 0; i < s_pool.threads.size(); i++)
+    {
+        s_pool.threads[i]->Wait();
+        delete s_pool.threads[i];
+    }
+    s_pool.threads.clear();
+}
+
+void MeshWorkerPool::addTiming(int stage, long microseconds)
+{
+    if (stage >= 0 && stage < NUM_STAGES)
+        s_pool.stageMicroseconds[stage] += microseconds;
+}
+
+MeshWorkerPool::StageTimer::StageTimer(int stage) : m_stage(stage)
+{
+    m_start = wxGetUTCTimeUSec().ToDouble();
+}
+
+MeshWorkerPool::StageTimer::~StageTimer()
+{
+    addTiming(m_stage, (long)(wxGetUTCTimeUSec().ToDouble() - m_start));
+}
+
+void MeshWorkerPool::frameDone()
+{
+    s_pool.frames++;
+}
+
+int MeshWorkerPool::getTimings(float ms[NUM_STAGES])
+{
+    const int frames = s_pool.frames;
+    for (int stage = 0; stage < NUM_STAGES; stage++)
+    {
+        ms[stage] = frames > 0 ? (float)(s_pool.stageMicroseconds[stage] / 1000.0 / frames) : 0.0f;
+        s_pool.stageMicroseconds[stage] = 0;
+    }
+    s_pool.frames = 0;
+    return frames;
+}
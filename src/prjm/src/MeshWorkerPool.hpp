@@ -0,0 +1,81 @@
+/**
+ * projectM -- Milkdrop-esque visualisation SDK
+ * Copyright (C)2003-2007 projectM Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * See 'LICENSE.txt' included within this release
+ *
+ */
+/**
+ * $Id$
+ *
+ * Worker threads for the per pixel mesh  // EDIT BY SJ
+ *
+ * $Log$
+ */
+
+#ifndef _MESH_WORKER_POOL_HPP
+#define _MESH_WORKER_POOL_HPP
+
+/// Distributes the rows of the per pixel mesh to some worker threads; the
+/// calling (render) thread works on the rows as well and run() returns when
+/// all rows are done.  All functions must be called from the render thread.
+class MeshWorkerPool {
+public:
+
+    /// Called for the rows [rowBegin, rowEnd); worker is in 0..maxWorkers()-1
+    /// and may be used to index per thread scratch data.
+    typedef void (*RowsFunc)(void *userData, int rowBegin, int rowEnd, int worker);
+
+    static void run(int rows, RowsFunc func, void *userData);
+
+    /// threads: 0 = one per CPU, 1 = no worker threads at all.
+    /// deterministic: every thread always gets the same, contiguous block of
+    /// rows instead of grabbing small chunks as it goes; slower on a loaded
+    /// system, but reproducible when comparing timings or debugging.
+    static void configure(int threads, bool deterministic);
+
+    /// Upper bound for the worker index given to RowsFunc
+    static int maxWorkers();
+
+    /// Stops and joins all threads; they're restarted on the next run()
+    static void shutdown();
+
+    /// Per frame timings of the mesh stages, see addTiming() and getTimings()
+    enum {
+        STAGE_PER_PIXEL_EQNS = 0,
+        STAGE_PER_PIXEL_MATH,
+        NUM_STAGES
+    };
+
+    static void addTiming(int stage, long microseconds);
+    static void frameDone();
+
+    /// Adds its lifetime to the given stage
+    class StageTimer {
+    public:
+        StageTimer(int stage);
+        ~StageTimer();
+    private:
+        int m_stage;
+        double m_start;
+    };
+
+    /// Average milliseconds per frame for each stage since the last call;
+    /// returns the number of frames measured and resets the counters.
+    static int getTimings(float ms[NUM_STAGES]);
+};
+
+#endif /** _MESH_WORKER_POOL_HPP */
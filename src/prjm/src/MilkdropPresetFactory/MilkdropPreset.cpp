@@ -39,13 +39,16 @@
 #include <fstream>
 
 #include "PresetFrameIO.hpp"
+#include "../MeshWorkerPool.hpp"  // EDIT BY SJ
 
 MilkdropPreset::MilkdropPreset(std::istream & in, const std::string & presetName,  PresetOutputs & presetOutputs):
 	Preset(presetName),
     	builtinParams(_presetInputs, presetOutputs),
     	_presetOutputs(presetOutputs)
 {
+  _perPixelProgram = NULL;
   initialize(in);
+  _presetOutputs.users++; // EDIT BY SJ
 
 }
 
@@ -56,17 +59,21 @@ MilkdropPreset::MilkdropPreset(const std::string & absoluteFilePath, const std::
     _presetOutputs(presetOutputs),
     _filename(parseFilename(absoluteFilePath))
 {
-
+  _perPixelProgram = NULL;
   initialize(absoluteFilePath);
+  _presetOutputs.users++; // EDIT BY SJ
 
 }
 MilkdropPreset::~MilkdropPreset()
 {
+  _presetOutputs.users--; // EDIT BY SJ
 
   traverse<TraverseFunctors::Delete<InitCond> >(init_cond_tree);
 
   traverse<TraverseFunctors::Delete<InitCond> >(per_frame_init_eqn_tree);
 
+  delete _perPixelProgram;
+
   traverse<TraverseFunctors::Delete<PerPixelEqn> >(per_pixel_eqn_tree);
 
   traverseVector<TraverseFunctors::Delete<PerFrameEqn> >(per_frame_eqn_tree);
@@ -142,6 +149,10 @@ int MilkdropPreset::add_per_pixel_eqn(char * name, GenExpr * gen_expr)
     return PROJECTM_FAILURE;
   }
 
+  /* The compiled equations are outdated now */
+  delete _perPixelProgram;
+  _perPixelProgram = NULL;
+
   /* Done */
   return PROJECTM_SUCCESS;
 }
@@ -465,6 +476,17 @@ void MilkdropPreset::initialize_PerPixelMeshes()
 // Evaluates all per-pixel equations
 void MilkdropPreset::evalPerPixelEqns()
 {
+  if (per_pixel_eqn_tree.empty())
+    return;
+
+  MeshWorkerPool::StageTimer timer(MeshWorkerPool::STAGE_PER_PIXEL_EQNS);  // EDIT BY SJ
+
+  /* Use the compiled program if possible, it evaluates several mesh points at once */
+  if (_perPixelProgram == NULL)
+    _perPixelProgram = new PerPixelProgram(per_pixel_eqn_tree);
+
+  if (_perPixelProgram->evaluate(presetInputs().gx, presetInputs().gy))
+    return;
 
   /* Evaluate all per pixel equations in the tree datastructure */
   for (int mesh_x = 0; mesh_x < presetInputs().gx; mesh_x++)
@@ -45,6 +45,7 @@
 #include "BuiltinParams.hpp"
 #include "PresetFrameIO.hpp"
 #include "InitCond.hpp"
+#include "PerPixelProgram.hpp"
 #include "../Preset.hpp"  // EDIT BY SJ
 
 class CustomWave;
@@ -176,6 +177,9 @@ private:
 
   PresetOutputs & _presetOutputs;
 
+  /// per_pixel_eqn_tree compiled on first use, NULL if not yet compiled
+  PerPixelProgram * _perPixelProgram;
+
 template <class CustomObject>
 void transfer_q_variables(std::vector<CustomObject*> & customObjects);
 };
@@ -214,6 +214,13 @@ PresetOutputs* MilkdropPresetFactory::createPresetOutputs(int gx, int gy)
 
 std::auto_ptr<Preset> MilkdropPresetFactory::allocate(const std::string & url, const std::string & name, const std::string & author) {
 
+    // EDIT BY SJ: the outputs are used alternately; however, if a preset was preloaded and dropped,
+    // the turn may be wrong, so make sure not to use the outputs of a living preset if possible
+    if (_presetOutputs->users == 0 && _presetOutputs2->users > 0)
+        _usePresetOutputs = true;
+    else if (_presetOutputs2->users == 0 && _presetOutputs->users > 0)
+        _usePresetOutputs = false;
+
     PresetOutputs *presetOutputs = _usePresetOutputs ? _presetOutputs : _presetOutputs2;
 
 	_usePresetOutputs = !_usePresetOutputs;
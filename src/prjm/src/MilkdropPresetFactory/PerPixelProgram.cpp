@@ -0,0 +1,444 @@
+/**
+ * projectM -- Milkdrop-esque visualisation SDK
+ * Copyright (C)2003-2007 projectM Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * See 'LICENSE.txt' included within this release
+ *
+ */
+
+#include "../fatal.h"  // EDIT BY SJ
+#include "../Common.hpp"  // EDIT BY SJ
+
+#include "Expr.hpp"
+#include "Eval.hpp"
+#include "Param.hpp"
+#include "PerPixelEqn.hpp"
+#include "BuiltinFuncs.hpp"
+#include "PerPixelProgram.hpp"
+#include "../MeshWorkerPool.hpp"  // EDIT BY SJ
+#include <cassert>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define PER_PIXEL_PROGRAM_SSE 1
+#include <xmmintrin.h>
+#endif
+
+#define PPP_MAX_ARGS 16
+
+enum {
+	PPP_CONST = 0,      // dst = constant
+	PPP_LOAD,           // dst = param (engine value or mesh row)
+	PPP_MOVE,           // dst = a
+	PPP_ADD,            // dst = dst op (dst+1), see TreeExpr::eval_tree_expr()
+	PPP_MINUS,
+	PPP_MULT,
+	PPP_DIV,
+	PPP_MOD,
+	PPP_OR,
+	PPP_AND,
+	PPP_CALL,           // dst = func(a .. a+b-1)
+	PPP_STORE_MATRIX,   // param mesh row = a
+	PPP_STORE_SCALAR    // dst (slot) = a, engine value = last lane of a for the last point
+};
+
+PerPixelProgram::PerPixelProgram(const std::map<int, PerPixelEqn*> & eqns):
+	m_numRegs(0), m_lanes(PER_PIXEL_PROGRAM_LANES), m_valid(false), m_gx(0), m_gy(0)
+{
+	std::map<int, PerPixelEqn*>::const_iterator pos;
+
+	/* Variables without a mesh are assigned for every point; they get a
+	   register of their own so that later equations of the same point can
+	   read them for all lanes. Temporaries are allocated above these slots. */
+	for (pos = eqns.begin(); pos != eqns.end(); ++pos)
+	{
+		Param *param = pos->second->param;
+		if (param->matrix == 0 && m_scalarSlots.find(param) == m_scalarSlots.end())
+		{
+			if (param->type != P_TYPE_DOUBLE)
+				m_lanes = 1; /* stored as float but read as int/bool by the trees */
+			int slot = (int)m_scalarSlots.size();
+			m_scalarSlots[param] = slot;
+			allocReg(slot);
+		}
+	}
+
+	const int temp = (int)m_scalarSlots.size();
+	for (pos = eqns.begin(); pos != eqns.end(); ++pos)
+	{
+		PerPixelEqn *eqn = pos->second;
+		if (eqn->gen_expr == 0 || !compileGenExpr(eqn->gen_expr, temp))
+			return;
+
+		Param *param = eqn->param;
+		if (param->matrix == 0)
+		{
+			emit(PPP_STORE_SCALAR, m_scalarSlots[param], temp).param = param;
+			m_scalarDests.push_back(param);
+		}
+		else
+		{
+			emit(PPP_STORE_MATRIX, 0, temp).param = param;
+			bool known = false;
+			for (size_t k = 0; k < m_matrixDests.size(); k++)
+				if (m_matrixDests[k] == param) known = true;
+			if (!known)
+				m_matrixDests.push_back(param);
+		}
+	}
+
+	m_regs.assign(m_numRegs * PER_PIXEL_PROGRAM_LANES * MeshWorkerPool::maxWorkers(), 0.0f);
+	m_valid = true;
+}
+
+int PerPixelProgram::allocReg(int reg)
+{
+	if (reg + 1 > m_numRegs)
+		m_numRegs = reg + 1;
+	return reg;
+}
+
+PerPixelProgram::Instr & PerPixelProgram::emit(int op, int dst, int a, int b)
+{
+	Instr instr;
+	instr.op = op;
+	instr.dst = dst;
+	instr.a = a;
+	instr.b = b;
+	instr.constant = 0;
+	instr.param = 0;
+	instr.func = 0;
+	m_code.push_back(instr);
+	return m_code.back();
+}
+
+void PerPixelProgram::emitConst(float value, int dst)
+{
+	allocReg(dst);
+	emit(PPP_CONST, dst).constant = value;
+}
+
+bool PerPixelProgram::compileParam(Param *param, int dst)
+{
+	allocReg(dst);
+
+	std::map<Param*, int>::iterator slot = m_scalarSlots.find(param);
+	if (slot != m_scalarSlots.end())
+	{
+		bool written = false;
+		for (size_t k = 0; k < m_scalarDests.size(); k++)
+			if (m_scalarDests[k] == param) written = true;
+
+		if (!written || param->type != P_TYPE_DOUBLE)
+		{
+			/* the value comes from the previous mesh point */
+			m_lanes = 1;
+			emit(PPP_LOAD, dst).param = param;
+		}
+		else
+		{
+			emit(PPP_MOVE, dst, slot->second);
+		}
+		return true;
+	}
+
+	if (param->type == P_TYPE_STRING)
+	{
+		emitConst(EVAL_ERROR, dst);
+		return true;
+	}
+
+	emit(PPP_LOAD, dst).param = param;
+	return true;
+}
+
+bool PerPixelProgram::compileGenExpr(GenExpr *expr, int dst)
+{
+	if (expr->item == 0)
+	{
+		emitConst(EVAL_ERROR, dst);
+		return true;
+	}
+
+	switch (expr->type)
+	{
+		case VAL_T:
+		{
+			ValExpr *val = (ValExpr*)expr->item;
+			if (val->type == CONSTANT_TERM_T)
+			{
+				emitConst(val->term.constant, dst);
+				return true;
+			}
+			if (val->type == PARAM_TERM_T)
+				return compileParam(val->term.param, dst);
+			emitConst(PROJECTM_FAILURE, dst);
+			return true;
+		}
+
+		case PREFUN_T:
+		{
+			PrefunExpr *prefun = (PrefunExpr*)expr->item;
+			if (prefun->func_ptr == 0 || prefun->num_args < 0 || prefun->num_args > PPP_MAX_ARGS)
+				return false;
+
+			float (*func)(float*) = (float (*)(float*))prefun->func_ptr;
+			if (func == FuncWrappers::rand_wrapper)
+				m_lanes = 1; /* keep the order of the random numbers */
+
+			for (int k = 0; k < prefun->num_args; k++)
+			{
+				if (!compileGenExpr(prefun->expr_list[k], dst + k))
+					return false;
+			}
+
+			allocReg(dst);
+			Instr & instr = emit(PPP_CALL, dst, dst, prefun->num_args);
+			instr.func = func;
+			return true;
+		}
+
+		case TREE_T:
+			return compileTreeExpr((TreeExpr*)expr->item, dst);
+
+		default:
+			emitConst(EVAL_ERROR, dst);
+			return true;
+	}
+}
+
+bool PerPixelProgram::compileTreeExpr(TreeExpr *tree, int dst)
+{
+	if (tree->infix_op == NULL)
+	{
+		if (tree->gen_expr == NULL)
+		{
+			emitConst(0, dst);
+			return true;
+		}
+		return compileGenExpr(tree->gen_expr, dst);
+	}
+
+	if (tree->left == NULL || tree->right == NULL)
+		return false;
+
+	if (!compileTreeExpr(tree->left, dst)
+	 || !compileTreeExpr(tree->right, allocReg(dst + 1)))
+		return false;
+
+	switch (tree->infix_op->type)
+	{
+		case INFIX_ADD:   emit(PPP_ADD, dst);   break;
+		case INFIX_MINUS: emit(PPP_MINUS, dst); break;
+		case INFIX_MULT:  emit(PPP_MULT, dst);  break;
+		case INFIX_DIV:   emit(PPP_DIV, dst);   break;
+		case INFIX_MOD:   emit(PPP_MOD, dst);   break;
+		case INFIX_OR:    emit(PPP_OR, dst);    break;
+		case INFIX_AND:   emit(PPP_AND, dst);   break;
+		default:          emitConst(EVAL_ERROR, dst); break;
+	}
+	return true;
+}
+
+bool PerPixelProgram::evaluate(int gx, int gy)
+{
+	if (!m_valid)
+		return false;
+
+	/* The trees read a mesh variable from its engine value until the first
+	   per pixel equation has assigned it; only from then on all points of
+	   a mesh can be evaluated independently. */
+	for (size_t k = 0; k < m_matrixDests.size(); k++)
+	{
+		if (!m_matrixDests[k]->matrix_flag)
+			return false;
+	}
+
+	if (gx <= 0 || gy <= 0)
+		return true;
+
+	m_gx = gx;
+	m_gy = gy;
+	if (m_lanes == PER_PIXEL_PROGRAM_LANES)
+		MeshWorkerPool::run(gx, evaluateRows, this);
+	else
+		evaluateRows(this, 0, gx, 0);
+
+	for (size_t k = 0; k < m_matrixDests.size(); k++)
+		m_matrixDests[k]->flags |= P_FLAG_PER_PIXEL;
+
+	return true;
+}
+
+void PerPixelProgram::evaluateRows(void *program, int rowBegin, int rowEnd, int worker)
+{
+	PerPixelProgram *self = (PerPixelProgram*)program;
+	const int lanes = self->m_lanes, gx = self->m_gx, gy = self->m_gy;
+	float *regs = &self->m_regs[worker * self->m_numRegs * PER_PIXEL_PROGRAM_LANES];
+
+	for (int i = rowBegin; i < rowEnd; i++)
+	{
+		for (int j = 0; j < gy; j += lanes)
+		{
+			int n = gy - j;
+			if (n > lanes)
+				n = lanes;
+			self->evaluateBlock(i, j, n, i == gx - 1 && j + n == gy, regs);
+		}
+	}
+}
+
+void PerPixelProgram::evaluateBlock(int i, int j, int n, bool last, float *regs)
+{
+	const int L = PER_PIXEL_PROGRAM_LANES;
+	float args[PPP_MAX_ARGS];
+	int k, m;
+
+	for (std::vector<Instr>::const_iterator ip = m_code.begin(); ip != m_code.end(); ++ip)
+	{
+		float *d = regs + ip->dst * L;
+		switch (ip->op)
+		{
+			case PPP_CONST:
+				for (k = 0; k < L; k++)
+					d[k] = ip->constant;
+				break;
+
+			case PPP_LOAD:
+			{
+				Param *param = ip->param;
+				float v;
+				switch (param->type)
+				{
+					case P_TYPE_BOOL:
+						v = (float)(*((bool*)param->engine_val));
+						break;
+					case P_TYPE_INT:
+						v = (float)(*((int*)param->engine_val));
+						break;
+					case P_TYPE_DOUBLE:
+						if ((param->matrix_flag | (param->flags & P_FLAG_ALWAYS_MATRIX)) && param->matrix)
+						{
+							const float *row = ((float**)param->matrix)[i] + j;
+							for (k = 0; k < L; k++)
+								d[k] = row[k < n ? k : n - 1];
+							continue;
+						}
+						v = *((float*)param->engine_val);
+						break;
+					default:
+						v = EVAL_ERROR;
+						break;
+				}
+				for (k = 0; k < L; k++)
+					d[k] = v;
+				break;
+			}
+
+			case PPP_MOVE:
+				for (k = 0; k < L; k++)
+					d[k] = regs[ip->a * L + k];
+				break;
+
+#ifdef PER_PIXEL_PROGRAM_SSE
+			case PPP_ADD:
+				_mm_storeu_ps(d, _mm_add_ps(_mm_loadu_ps(d), _mm_loadu_ps(d + L)));
+				break;
+			case PPP_MINUS:
+				_mm_storeu_ps(d, _mm_sub_ps(_mm_loadu_ps(d), _mm_loadu_ps(d + L)));
+				break;
+			case PPP_MULT:
+				_mm_storeu_ps(d, _mm_mul_ps(_mm_loadu_ps(d), _mm_loadu_ps(d + L)));
+				break;
+			case PPP_DIV:
+			{
+				__m128 r = _mm_loadu_ps(d + L);
+				__m128 zero = _mm_cmpeq_ps(r, _mm_setzero_ps());
+				__m128 q = _mm_div_ps(_mm_loadu_ps(d), r);
+				_mm_storeu_ps(d, _mm_or_ps(_mm_and_ps(zero, _mm_set1_ps((float)MAX_DOUBLE_SIZE)),
+				                           _mm_andnot_ps(zero, q)));
+				break;
+			}
+#else
+			case PPP_ADD:
+				for (k = 0; k < L; k++)
+					d[k] = d[k] + d[L + k];
+				break;
+			case PPP_MINUS:
+				for (k = 0; k < L; k++)
+					d[k] = d[k] - d[L + k];
+				break;
+			case PPP_MULT:
+				for (k = 0; k < L; k++)
+					d[k] = d[k] * d[L + k];
+				break;
+			case PPP_DIV:
+				for (k = 0; k < L; k++)
+					d[k] = d[L + k] == 0 ? (float)MAX_DOUBLE_SIZE : d[k] / d[L + k];
+				break;
+#endif
+
+			case PPP_MOD:
+				for (k = 0; k < n; k++)
+				{
+					if ((int)d[L + k] == 0)
+						d[k] = PROJECTM_DIV_BY_ZERO;
+					else
+						d[k] = (float)((int)d[k] % (int)d[L + k]);
+				}
+				break;
+
+			case PPP_OR:
+				for (k = 0; k < n; k++)
+					d[k] = (float)((int)d[k] | (int)d[L + k]);
+				break;
+
+			case PPP_AND:
+				for (k = 0; k < n; k++)
+					d[k] = (float)((int)d[k] & (int)d[L + k]);
+				break;
+
+			case PPP_CALL:
+				for (k = 0; k < n; k++)
+				{
+					for (m = 0; m < ip->b; m++)
+						args[m] = regs[(ip->a + m) * L + k];
+					d[k] = ip->func(args);
+				}
+				break;
+
+			case PPP_STORE_MATRIX:
+			{
+				float *row = ((float**)ip->param->matrix)[i] + j;
+				const float *s = regs + ip->a * L;
+				for (k = 0; k < n; k++)
+					row[k] = s[k];
+				break;
+			}
+
+			case PPP_STORE_SCALAR:
+			{
+				const float *s = regs + ip->a * L;
+				for (k = 0; k < L; k++)
+					d[k] = s[k];
+				/* with several lanes, nobody reads the engine value before the
+				   program is done; just the final value must be there */
+				if (m_lanes == 1 || last)
+					*((float*)ip->param->engine_val) = s[n - 1];
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,103 @@
+/**
+ * projectM -- Milkdrop-esque visualisation SDK
+ * Copyright (C)2003-2007 projectM Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * See 'LICENSE.txt' included within this release
+ *
+ */
+/**
+ * $Id$
+ *
+ * Per pixel equations compiled to a flat register program
+ *
+ * $Log$
+ */
+
+#ifndef _PER_PIXEL_PROGRAM_H
+#define _PER_PIXEL_PROGRAM_H
+
+#include "../Common.hpp"  // EDIT BY SJ
+#include <vector>
+#include <map>
+
+class GenExpr;
+class TreeExpr;
+class Param;
+class PerPixelEqn;
+
+/// Number of mesh points evaluated by one pass over the program.
+#define PER_PIXEL_PROGRAM_LANES 4
+
+/// The per pixel equations of a preset, flattened into a linear list of
+/// register instructions.  Every register holds PER_PIXEL_PROGRAM_LANES
+/// values, one for each of the neighbouring mesh points [i][j..j+3], so the
+/// infix operators run as one SIMD instruction for four points while
+/// function calls still go through the builtin function pointers lane by lane.
+///
+/// The results are the same as evaluating the expression trees point by point:
+/// if the equations depend on the evaluation order across points (a
+/// non-mesh variable read before it is assigned, rand(), non-float
+/// variables), the program runs with a single lane.  Otherwise, the mesh rows
+/// are independent and distributed to the MeshWorkerPool.
+class PerPixelProgram {
+public:
+
+    /// Compiles the given equations
+    PerPixelProgram(const std::map<int, PerPixelEqn*> & eqns);
+
+    /// Evaluates all equations for the gx * gy mesh. Returns false (without
+    /// touching anything) if some expression could not be translated or if
+    /// the parameters are not yet in the state the program was compiled for -
+    /// this is the case for the very first frame of a preset, the caller
+    /// should use the expression trees then.
+    bool evaluate(int gx, int gy);
+
+private:
+
+    struct Instr {
+        int op;
+        int dst;
+        int a;          // source register; first argument register for calls
+        int b;          // number of arguments for calls
+        float constant;
+        Param *param;
+        float (*func)(float*);
+    };
+
+    std::vector<Instr> m_code;
+    std::vector<float> m_regs;             // one register file per worker
+    int m_numRegs;
+    int m_lanes;
+    bool m_valid;
+
+    std::vector<Param*> m_matrixDests;     // variables with a mesh assigned by the program
+    std::map<Param*, int> m_scalarSlots;   // variables without a mesh -> register
+    std::vector<Param*> m_scalarDests;     // ... in the order they are assigned
+
+    int allocReg(int reg);
+    Instr & emit(int op, int dst, int a = 0, int b = 0);
+    void emitConst(float value, int dst);
+    bool compileGenExpr(GenExpr *expr, int dst);
+    bool compileTreeExpr(TreeExpr *tree, int dst);
+    bool compileParam(Param *param, int dst);
+
+    int m_gx, m_gy;
+
+    static void evaluateRows(void *program, int rowBegin, int rowEnd, int worker);
+    void evaluateBlock(int i, int j, int n, bool last, float *regs);
+};
+
+#endif /** _PER_PIXEL_PROGRAM_H */
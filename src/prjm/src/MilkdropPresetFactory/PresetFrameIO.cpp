@@ -5,6 +5,7 @@
 #include <iostream>
 #include <cmath>
 #include "../Renderer/BeatDetect.hpp"  // EDIT BY SJ
+#include "../MeshWorkerPool.hpp"  // EDIT BY SJ
 
 PresetInputs::PresetInputs() : PipelineContext()
 {
@@ -104,7 +105,7 @@ void PresetInputs::Initialize ( int gx, int gy )
 
 }
 
-PresetOutputs::PresetOutputs() : Pipeline()
+PresetOutputs::PresetOutputs() : Pipeline(), users(0) // EDIT BY SJ
 {}
 
 PresetOutputs::~PresetOutputs()
@@ -186,13 +187,35 @@ void PresetOutputs::Render(const BeatDetect &music, const PipelineContext &conte
 }
 
 
+// EDIT BY SJ: all points of the mesh are independent, the rows are distributed to the worker pool
+struct PerPixelMathJob
+{
+	PresetOutputs *outputs;
+	const PipelineContext *context;
+};
+
+void PresetOutputs::PerPixelMathRows(void *job, int xBegin, int xEnd, int worker)
+{
+	((PerPixelMathJob*)job)->outputs->PerPixelMath(*((PerPixelMathJob*)job)->context, xBegin, xEnd);
+}
+
 void PresetOutputs::PerPixelMath(const PipelineContext &context)
+{
+	MeshWorkerPool::StageTimer timer(MeshWorkerPool::STAGE_PER_PIXEL_MATH);
+
+	PerPixelMathJob job;
+	job.outputs = this;
+	job.context = &context;
+	MeshWorkerPool::run(gx, PerPixelMathRows, &job);
+}
+
+void PresetOutputs::PerPixelMath(const PipelineContext &context, int xBegin, int xEnd)
 {
 
 	int x, y;
 	float fZoom2, fZoom2Inv;
 
-	for (x = 0; x < gx; x++)
+	for (x = xBegin; x < xEnd; x++)
 	{
 		for (y = 0; y < gy; y++)
 		{
@@ -204,7 +227,7 @@ void PresetOutputs::PerPixelMath(const PipelineContext &context)
 		}
 	}
 
-	for (x = 0; x < gx; x++)
+	for (x = xBegin; x < xEnd; x++)
 	{
 		for (y = 0; y < gy; y++)
 		{
@@ -213,7 +236,7 @@ void PresetOutputs::PerPixelMath(const PipelineContext &context)
 		}
 	}
 
-	for (x = 0; x < gx; x++)
+	for (x = xBegin; x < xEnd; x++)
 	{
 		for (y = 0; y < gy; y++)
 		{
@@ -230,7 +253,7 @@ void PresetOutputs::PerPixelMath(const PipelineContext &context)
 	f[2] = 10.54f + 3.0f * cosf(fWarpTime * 1.233f + 3);
 	f[3] = 11.49f + 4.0f * cosf(fWarpTime * 0.933f + 5);
 
-	for (x = 0; x < gx; x++)
+	for (x = xBegin; x < xEnd; x++)
 	{
 		for (y = 0; y < gy; y++)
 		{
@@ -244,7 +267,7 @@ void PresetOutputs::PerPixelMath(const PipelineContext &context)
 					+ fWarpScaleInv * (this->orig_x[x][y] * f[0] + this->orig_y[x][y] * f[3]));
 		}
 	}
-	for (x = 0; x < gx; x++)
+	for (x = xBegin; x < xEnd; x++)
 	{
 		for (y = 0; y < gy; y++)
 		{
@@ -260,11 +283,11 @@ void PresetOutputs::PerPixelMath(const PipelineContext &context)
 		}
 	}
 
-	for (x = 0; x < gx; x++)
+	for (x = xBegin; x < xEnd; x++)
 		for (y = 0; y < gy; y++)
 			this->x_mesh[x][y] -= this->dx_mesh[x][y];
 
-	for (x = 0; x < gx; x++)
+	for (x = xBegin; x < xEnd; x++)
 		for (y = 0; y < gy; y++)
 			this->y_mesh[x][y] -= this->dy_mesh[x][y];
 
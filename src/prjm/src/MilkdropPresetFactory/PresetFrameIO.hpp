@@ -73,12 +73,16 @@ public:
     cwave_container customWaves;
     cshape_container customShapes;
 
+    int users; // EDIT BY SJ: number of MilkdropPreset objects bound to this instance
+
     void Initialize(int gx, int gy);
     PresetOutputs();
     PresetOutputs(const PresetOutputs& o) { wxASSERT_MSG(0, "The PresetOutputs copy constructor is not save! (in fact, there are always on two real instances of PresetOutputs - and many references)."); } // EDIT BY SJ
     ~PresetOutputs();
     virtual void Render(const BeatDetect &music, const PipelineContext &context);
     void PerPixelMath( const PipelineContext &context);
+    void PerPixelMath( const PipelineContext &context, int xBegin, int xEnd);  // EDIT BY SJ
+    static void PerPixelMathRows(void *job, int xBegin, int xEnd, int worker);  // EDIT BY SJ
     /* PER FRAME VARIABLES BEGIN */
 
     float zoom;
@@ -134,8 +134,8 @@ void PCM::addPCMfloat(const float *PCMdata, int samples)
  if (newsamples>maxsamples) newsamples=maxsamples;
   numsamples = getPCMnew(pcmdataR,1,0,waveSmoothing,0,0);
     getPCMnew(pcmdataL,0,0,waveSmoothing,0,1);
-    getPCM(vdataL,512,0,1,0,0);
-    getPCM(vdataR,512,1,1,0,0);
+    // EDIT BY SJ: no getPCM() for vdataL/vdataR; they are not read anywhere
+    // (BeatDetect uses pcmdataL/pcmdataR), so we skip the two FFTs for every block added
 }
 
 void PCM::addPCM16Data(const short* pcm_data, short samples)  {
@@ -0,0 +1,218 @@
+/**
+ * projectM -- Milkdrop-esque visualisation SDK
+ * Copyright (C)2003-2007 projectM Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * See 'LICENSE.txt' included within this release
+ *
+ */
+
+// EDIT BY SJ: uses the wxWidgets thread classes as MeshWorkerPool does
+#include <wx/thread.h>
+#include <wx/time.h>
+#include "Preset.hpp"
+#include "PresetLoader.hpp"
+#include "PresetPreloader.hpp"
+
+class PresetPreloaderThread : public wxThread
+{
+public:
+    PresetPreloaderThread(PresetPreloader * owner) : wxThread(wxTHREAD_JOINABLE), m_owner(owner) {}
+
+private:
+    PresetPreloader * m_owner;
+
+    void* Entry()
+    {
+        m_owner->threadMain();
+        return 0;
+    }
+};
+
+static double getMs()
+{
+    return wxGetUTCTimeUSec().ToDouble() / 1000.0;
+}
+
+PresetPreloader::PresetPreloader(const PresetLoader & presetLoader):
+    m_presetLoader(presetLoader), m_thread(0),
+    m_busy(false), m_parsing(false), m_exit(false), m_index(0), m_preset(0),
+    m_preloaded(0), m_loaded(0), m_failed(0), m_parsed(0),
+    m_parseMs(0), m_waitMs(0), m_loadMs(0)
+{
+    m_mutex = new wxMutex();
+    m_cond = new wxCondition(*m_mutex);
+    m_parseMutex = new wxMutex();
+}
+
+PresetPreloader::~PresetPreloader()
+{
+    drop();
+
+    if (m_thread)
+    {
+        m_mutex->Lock();
+        m_exit = true;
+        m_cond->Broadcast();
+        m_mutex->Unlock();
+
+        m_thread->Wait();
+        delete m_thread;
+    }
+
+    delete m_cond;
+    delete m_mutex;
+    delete m_parseMutex;
+}
+
+void PresetPreloader::threadMain()
+{
+    m_mutex->Lock();
+    for (;;)
+    {
+        while (!m_exit && !m_parsing)
+            m_cond->Wait();
+        if (m_exit)
+            break;
+
+        const unsigned int index = m_index;
+        m_mutex->Unlock();
+
+        Preset * preset = 0;
+        double startMs = getMs();
+        m_parseMutex->Lock();
+        try {
+            preset = m_presetLoader.loadPreset(index).release();
+        }
+        catch (...) {
+            preset = 0; // allocate() will try again and report the error
+        }
+        m_parseMutex->Unlock();
+        double parseMs = getMs() - startMs;
+
+        m_mutex->Lock();
+        m_preset = preset;
+        if (preset)
+        {
+            m_parsed++;
+            m_parseMs += parseMs;
+        }
+        else
+        {
+            m_failed++;
+        }
+        m_parsing = false;
+        m_cond->Broadcast();
+    }
+    m_mutex->Unlock();
+}
+
+void PresetPreloader::preload(unsigned int index)
+{
+    if (m_busy)
+        return;
+
+    if (m_thread == 0)
+    {
+        m_thread = new PresetPreloaderThread(this);
+        if (m_thread->Create() != wxTHREAD_NO_ERROR || m_thread->Run() != wxTHREAD_NO_ERROR)
+        {
+            delete m_thread;
+            m_thread = 0;
+            return; // no thread, allocate() loads synchronously as before
+        }
+    }
+
+    m_mutex->Lock();
+    m_busy = true;
+    m_parsing = true;
+    m_index = index;
+    m_preset = 0;
+    m_cond->Broadcast();
+    m_mutex->Unlock();
+}
+
+Preset * PresetPreloader::waitForParser()
+{
+    // returns the preloaded preset (if any) and makes the preloader idle
+    m_mutex->Lock();
+    while (m_parsing)
+        m_cond->Wait();
+    Preset * preset = m_preset;
+    m_preset = 0;
+    m_busy = false;
+    m_mutex->Unlock();
+    return preset;
+}
+
+std::auto_ptr<Preset> PresetPreloader::allocate(unsigned int index)
+{
+    if (m_busy)
+    {
+        const bool match = (m_index == index);
+        double startMs = getMs();
+        Preset * preset = waitForParser();
+        if (preset && match)
+        {
+            m_waitMs += getMs() - startMs;
+            m_preloaded++;
+            return std::auto_ptr<Preset>(preset);
+        }
+
+        // not the preset we need, free its outputs before loading the other one
+        delete preset;
+    }
+
+    double startMs = getMs();
+    m_parseMutex->Lock();
+    std::auto_ptr<Preset> preset;
+    try {
+        preset = m_presetLoader.loadPreset(index);
+    }
+    catch (...) {
+        m_parseMutex->Unlock();
+        throw;
+    }
+    m_parseMutex->Unlock();
+
+    m_loadMs += getMs() - startMs;
+    m_loaded++;
+    return preset;
+}
+
+void PresetPreloader::drop()
+{
+    if (m_busy)
+        delete waitForParser();
+}
+
+PresetPreloader::Stats PresetPreloader::getStats()
+{
+    Stats stats;
+
+    m_mutex->Lock();
+    stats.preloaded = m_preloaded;
+    stats.loaded = m_loaded;
+    stats.failed = m_failed;
+    stats.parseMs = m_parsed > 0 ? (float)(m_parseMs / m_parsed) : 0.0f;
+    stats.waitMs = m_preloaded > 0 ? (float)(m_waitMs / m_preloaded) : 0.0f;
+    stats.loadMs = m_loaded > 0 ? (float)(m_loadMs / m_loaded) : 0.0f;
+
+    m_preloaded = m_loaded = m_failed = m_parsed = 0;
+    m_parseMs = m_waitMs = m_loadMs = 0;
+    m_mutex->Unlock();
+
+    return stats;
+}
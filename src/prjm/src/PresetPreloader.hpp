@@ -0,0 +1,104 @@
+/**
+ * projectM -- Milkdrop-esque visualisation SDK
+ * Copyright (C)2003-2007 projectM Team
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * See 'LICENSE.txt' included within this release
+ *
+ */
+/**
+ * $Id$
+ *
+ * Parses the next preset in a background thread  // EDIT BY SJ
+ *
+ * $Log$
+ */
+
+#ifndef _PRESET_PRELOADER_HPP
+#define _PRESET_PRELOADER_HPP
+
+#include <memory>
+
+class Preset;
+class PresetLoader;
+class PresetPreloaderThread;
+class wxMutex;
+class wxCondition;
+
+/// Loads the preset that will (probably) be shown next in a background thread,
+/// so that a transition does not need to wait for the parser.
+///
+/// The parsed preset is kept until it is requested by allocate().  Only one
+/// preset is kept: a preset is bound to one of the two PresetOutputs of the
+/// factory and only one of them is free while no transition is in progress.
+/// All functions must be called from the render thread.
+class PresetPreloader {
+public:
+
+    PresetPreloader(const PresetLoader & presetLoader);
+    ~PresetPreloader();
+
+    /// Start parsing the given playlist index; does nothing if busy()
+    void preload(unsigned int index);
+
+    /// True if a preset is being parsed or is ready for allocate()
+    bool busy() const { return m_busy; }
+
+    /// The index given to preload(), only valid if busy()
+    unsigned int preloadIndex() const { return m_index; }
+
+    /// Returns the preset at the given playlist index; this is the preloaded
+    /// preset if possible, otherwise it is loaded synchronously.  Like
+    /// PresetLoader::loadPreset(), an exception is thrown on errors.
+    std::auto_ptr<Preset> allocate(unsigned int index);
+
+    /// Forget the preloaded preset; must be called before the playlist is changed.
+    void drop();
+
+    struct Stats {
+        int preloaded;      // presets taken from the background parser
+        int loaded;         // presets loaded synchronously
+        int failed;         // background parser errors
+        float parseMs;      // average background parse time
+        float waitMs;       // average time allocate() waited for the background parser
+        float loadMs;       // average synchronous load time
+    };
+
+    /// Statistics since the last call
+    Stats getStats();
+
+private:
+    const PresetLoader & m_presetLoader;
+    PresetPreloaderThread * m_thread;
+
+    wxMutex * m_mutex;          // protects the members below
+    wxCondition * m_cond;       // signalled when m_parsing or m_exit changes
+    wxMutex * m_parseMutex;     // the parser uses static data, only one preset may be parsed at a time
+
+    bool m_busy;
+    bool m_parsing;
+    bool m_exit;
+    unsigned int m_index;
+    Preset * m_preset;
+
+    int m_preloaded, m_loaded, m_failed, m_parsed;
+    double m_parseMs, m_waitMs, m_loadMs;
+
+    Preset * waitForParser();
+    void threadMain();
+    friend class PresetPreloaderThread;
+};
+
+#endif /** _PRESET_PRELOADER_HPP */
@@ -52,6 +52,7 @@
 #include "ConfigFile.h"
 #include "Renderer/TextureManager.hpp"  // EDIT BY SJ
 #include "TimeKeeper.hpp"
+#include "MeshWorkerPool.hpp"  // EDIT BY SJ
 #include "Renderer/RenderItemMergeFunction.hpp"  // EDIT BY SJ
 
 #ifdef USE_THREADS
@@ -95,6 +96,8 @@ projectM::~projectM()
     std::cout << std::endl;
     #endif
 
+    MeshWorkerPool::shutdown(); // EDIT BY SJ
+
     m_activePreset.reset();  // FIXED: EDIT BY SJ: m_activePreset->presetOutput is a pointer to m_presetLoader->_presetFactoryManager->_factoryList->_presetOutputs2 which is destroyed by destroyPresetTools()
     m_activePreset2.reset(); // so, make sure, it is released before destroyPresetTools() (not implicitly after the destructor)
 
@@ -140,7 +143,7 @@ beatDetect ( 0 ), renderer ( 0 ),  _pcm(0), m_presetPos(0), m_flags(flags), _pip
 */
 
 projectM::projectM(const Settings& settings, int flags):  // EDIT BY SJ
-beatDetect ( 0 ), renderer ( 0 ),  _pcm(0), m_presetPos(0), m_flags(flags), _pipelineContext(new PipelineContext()), _pipelineContext2(new PipelineContext())
+beatDetect ( 0 ), renderer ( 0 ),  _pcm(0), m_presetPos(0), m_presetPreloader(0), m_preloadIsRandom(false), m_flags(flags), _pipelineContext(new PipelineContext()), _pipelineContext2(new PipelineContext())
 {
     readSettings(settings);
     projectM_reset();
@@ -447,6 +450,8 @@ static void *thread_callback(void *prjm) {
 
 
         count++;
+        MeshWorkerPool::frameDone(); // EDIT BY SJ
+        preloadNextPreset(); // EDIT BY SJ
         #ifndef WIN32
         /** Frame-rate limiter */
         /** Compute once per preset */
@@ -607,6 +612,8 @@ static void *thread_callback(void *prjm) {
         if (!m_presetPos)
             m_presetPos = new PresetIterator();
 
+        m_presetPreloader = new PresetPreloader(*m_presetLoader); // EDIT BY SJ
+
         // Initialize a preset queue position as well
         //	m_presetQueuePos = new PresetIterator();
 
@@ -648,6 +655,11 @@ static void *thread_callback(void *prjm) {
 
     void projectM::destroyPresetTools()
     {
+        // EDIT BY SJ: a preloaded preset uses the outputs of the factory, delete it first
+        if ( m_presetPreloader )
+            delete ( m_presetPreloader );
+
+        m_presetPreloader = 0;
 
         if ( m_presetPos )
             delete ( m_presetPos );
@@ -669,6 +681,8 @@ static void *thread_callback(void *prjm) {
     /// @bug queuePreset case isn't handled
     void projectM::removePreset(unsigned int index) {
 
+        m_presetPreloader->drop(); // EDIT BY SJ
+
         unsigned int chooserIndex = **m_presetPos;
 
         m_presetLoader->removePreset(index);
@@ -696,6 +710,7 @@ static void *thread_callback(void *prjm) {
 
     unsigned int projectM::addPresetURL ( const std::string & presetURL, const std::string & presetName, const RatingList & ratings)
     {
+        m_presetPreloader->drop(); // EDIT BY SJ
         bool restorePosition = false;
 
         if (*m_presetPos == m_presetChooser->end())
@@ -742,7 +757,13 @@ void projectM::selectRandom(const bool hardCut) {
                 	timeKeeper->StartSmoothing();
 		}
 
-		*m_presetPos = m_presetChooser->weightedRandom(hardCut);
+		// EDIT BY SJ: use the random preset that is preloaded, if any and if it was
+		// chosen by the same rating type
+		if (m_presetPreloader->busy() && m_preloadIsRandom
+		 && (!hardCut || !settings().softCutRatingsEnabled))
+			*m_presetPos = m_presetChooser->begin(m_presetPreloader->preloadIndex());
+		else
+			*m_presetPos = m_presetChooser->weightedRandom(hardCut);
 
 		if (!hardCut) {
 			switchPreset(m_activePreset2);
@@ -816,7 +837,7 @@ void projectM::switchPreset(std::auto_ptr<Preset> & targetPreset) {
 	pthread_mutex_lock(&preset_mutex);
 	#endif
 
-        targetPreset = m_presetPos->allocate();
+        targetPreset = m_presetPreloader->allocate(**m_presetPos); // EDIT BY SJ, was: m_presetPos->allocate()
 
         // Set preset name here- event is not done because at the moment this function is oblivious to smooth/hard switches
         renderer->setPresetName(targetPreset->name());
@@ -827,6 +848,33 @@ void projectM::switchPreset(std::auto_ptr<Preset> & targetPreset) {
 	#endif
     }
 
+    // EDIT BY SJ: parse the preset that is probably needed next while the current one is shown;
+    // during a transition, both outputs of the preset factory are in use and we have to wait.
+    void projectM::preloadNextPreset()
+    {
+        if ( !m_presetPreloader || m_presetPreloader->busy() || timeKeeper->IsSmoothing() || m_presetChooser->empty() )
+            return;
+
+        PresetIterator pos;
+        m_preloadIsRandom = settings().shuffleEnabled;
+        if ( m_preloadIsRandom )
+        {
+            pos = m_presetChooser->weightedRandom(false);
+        }
+        else
+        {
+            pos = *m_presetPos;
+            m_presetChooser->nextPreset(pos);
+        }
+
+        m_presetPreloader->preload(*pos);
+    }
+
+    PresetPreloader::Stats projectM::getPresetPreloadStats()
+    {
+        return m_presetPreloader->getStats();
+    }
+
     void projectM::setPresetLock ( bool isLocked )
     {
         renderer->noSwitch = isLocked;
@@ -854,6 +902,7 @@ void projectM::switchPreset(std::auto_ptr<Preset> & targetPreset) {
 
     void projectM::clearPlaylist ( )
     {
+        m_presetPreloader->drop(); // EDIT BY SJ
         m_presetLoader->clear();
         *m_presetPos = m_presetChooser->end();
     }
@@ -889,6 +938,7 @@ void projectM::switchPreset(std::auto_ptr<Preset> & targetPreset) {
 
     void projectM::insertPresetURL(unsigned int index, const std::string & presetURL, const std::string & presetName, const RatingList & ratings)
     {
+        m_presetPreloader->drop(); // EDIT BY SJ
         bool atEndPosition = false;
 
         int newSelectedIndex = 0; // EDIT BY SJ
@@ -925,6 +975,7 @@ void projectM::switchPreset(std::auto_ptr<Preset> & targetPreset) {
     }
 
 void projectM::changePresetName ( unsigned int index, std::string name ) {
+	m_presetPreloader->drop(); // EDIT BY SJ
 	m_presetLoader->setPresetName(index, name);
 }
 
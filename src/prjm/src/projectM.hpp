@@ -77,6 +77,7 @@ class RenderItemMatcher;
 class MasterRenderItemMerge;
 
 #include "Common.hpp"
+#include "PresetPreloader.hpp"  // EDIT BY SJ
 #include "Preset.hpp" // EDIT BY SJ - added to avoid warning C4150 on MSW - std::auto_ptr<Preset> destructors cannot be called without declaration of 'Preset', maybe the stuff is inlined on MSW 
 
 #include <memory>
@@ -252,6 +253,9 @@ public:
   inline PCM * pcm() {
 	  return _pcm;
   }
+
+  /// Preset preloading statistics since the last call  // EDIT BY SJ
+  PresetPreloader::Stats getPresetPreloadStats();
   void *thread_func(void *vptr_args);
   PipelineContext & pipelineContext() { return *_pipelineContext; }
   PipelineContext & pipelineContext2() { return *_pipelineContext2; }
@@ -304,6 +308,11 @@ private:
   /// Provides accessor functions to choose presets
   PresetChooser * m_presetChooser;
 
+  /// Parses the next preset in the background  // EDIT BY SJ
+  PresetPreloader * m_presetPreloader;
+  bool m_preloadIsRandom;
+  void preloadNextPreset();
+
   /// Currently loaded preset
   std::auto_ptr<Preset> m_activePreset;
 
@@ -388,18 +388,15 @@ regexp_proto_exec(interp, self, thisobj, argc, argv, res)
 	ncaptures = SEE_regex_count_captures(ro->regex);
 	SEE_ASSERT(interp, ncaptures > 0);
 	captures = SEE_STRING_ALLOCA(interp, struct capture, ncaptures);
-	while (!SEE_regex_match(interp, ro->regex, S, i, captures)) {
-		i++;
-		if (i > S->length) {
-		    SEE_SET_NUMBER(&v, 0);
-		    SEE_OBJECT_PUT(interp, thisobj, STR(lastIndex), &v, 0); 
-		    SEE_SET_NULL(res);
-		    for (i = 0; i < ncaptures; i++)
-			captures[i].end = -1;
-		    regexp_set_static(interp, S, ro->regex, captures, 
-		    	ro->source);
-		    return;
-		}
+	if (!SEE_regex_search(interp, ro->regex, S, i, captures)) {
+		SEE_SET_NUMBER(&v, 0);
+		SEE_OBJECT_PUT(interp, thisobj, STR(lastIndex), &v, 0); 
+		SEE_SET_NULL(res);
+		for (i = 0; i < ncaptures; i++)
+		    captures[i].end = -1;
+		regexp_set_static(interp, S, ro->regex, captures, 
+		    ro->source);
+		return;
 	}
 	regexp_set_static(interp, S, ro->regex, captures, ro->source);
 
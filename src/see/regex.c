@@ -116,6 +116,30 @@ struct regex {
 	struct charclass      **cc;
 	int			ccalloc, cclen;
 	int			flags;
+
+	/* filled in by optimize_regex(), used by SEE_regex_search() */
+	int			firstvalid;	/* firstmap is usable */
+	unsigned char		firstmap[32];	/* possible first chars < 256 */
+	int			salen;		/* shift-and length, 0=unused */
+	SEE_uint32_t	       *samask;		/* shift-and masks for ch < 256 */
+};
+
+/*
+ * Compiled regexes do not depend on anything but their source and
+ * flags and are never modified after optimize_regex(), so they can be
+ * shared between RegExp instances. Regex literals inside loops create a
+ * new RegExp object on each evaluation; the per-interpreter cache below
+ * avoids reparsing the pattern each time. It is direct-mapped so that
+ * scripts building many dynamic patterns cannot grow it without bounds.
+ */
+#define REGEX_CACHE_SIZE	64
+
+struct regex_cache {
+	struct regex_cache_entry {
+		struct SEE_string *source;
+		int		   flags;
+		struct regex	  *regex;
+	} entry[REGEX_CACHE_SIZE];
 };
 
 struct recontext {
@@ -212,7 +236,11 @@ static void dprint_regex(struct regex *);
 static SEE_unicode_t Canonicalize(struct regex *, SEE_unicode_t);
 static SEE_boolean_t pcode_run(struct SEE_interpreter *, struct regex *,
         unsigned int, struct SEE_string *, char *);
+static int shiftand_run(struct SEE_interpreter *, struct regex *,
+        struct SEE_string *, unsigned int, struct capture *);
 static void optimize_regex(struct SEE_interpreter *, struct regex *);
+static int first_chars(struct regex *, unsigned int, int);
+static unsigned int regex_cache_hash(struct SEE_string *, int);
 
 /*------------------------------------------------------------
  * charclass
@@ -495,6 +523,9 @@ regex_new(recontext)
 	regex->ccalloc = 0;
 	regex->cclen = 0;
 	regex->flags = 0;
+	regex->firstvalid = 0;
+	regex->salen = 0;
+	regex->samask = NULL;
 	return regex;
 }
 
@@ -549,6 +580,19 @@ code_insert(recontext, pos, n)
  * and not dependendent on absolute addresses.
  */
 
+/* Hash a pattern source and its flags into a regex cache slot */
+static unsigned int
+regex_cache_hash(source, flags)
+	struct SEE_string *source;
+	int flags;
+{
+	unsigned int i, h = flags;
+
+	for (i = 0; i < source->length; i++)
+		h = h * 31 + source->data[i];
+	return h % REGEX_CACHE_SIZE;
+}
+
 /* parse a source pattern, and return a filled-in regex structure */
 struct regex *
 SEE_regex_parse(interp, source, flags)
@@ -558,6 +602,20 @@ SEE_regex_parse(interp, source, flags)
 {
 	struct recontext *recontext;
 	struct regex *regex;
+	struct regex_cache *cache;
+	struct regex_cache_entry *entry;
+
+	/* Return the previously compiled regex, if any */
+	cache = (struct regex_cache *)interp->regex_cache;
+	if (!cache) {
+		cache = SEE_NEW(interp, struct regex_cache);
+		memset(cache, 0, sizeof *cache);
+		interp->regex_cache = cache;
+	}
+	entry = &cache->entry[regex_cache_hash(source, flags)];
+	if (entry->regex && entry->flags == flags &&
+	    SEE_string_cmp(entry->source, source) == 0)
+		return entry->regex;
 
 	recontext = SEE_NEW(interp, struct recontext);
 	recontext->interpreter = interp;
@@ -594,6 +652,11 @@ SEE_regex_parse(interp, source, flags)
 	}
 #endif
 
+	/* Remember the regex; the source is copied as it may be growable */
+	entry->source = SEE_string_dup(interp, source);
+	entry->flags = flags;
+	entry->regex = regex;
+
 	return regex;
 }
 
@@ -1778,19 +1841,177 @@ SEE_regex_match(interp, regex, text, index, capture_ret)
 	return success;
 }
 
+/*
+ * Bit-parallel (shift-and) matcher for patterns that are a plain
+ * sequence of up to 32 character classes, eg /feat\./i or /[()]/g.
+ * Bit k of the state is set if the last k+1 characters matched the
+ * first k+1 classes, so each text character costs one shift and one
+ * mask lookup, independent of the pattern length.
+ * Returns 1 on a match, 0 if there is none and -1 if the text contains
+ * surrogates; the caller then has to use the p-code instead.
+ */
+static int
+shiftand_run(interp, regex, text, start, capture_ret)
+	struct SEE_interpreter *interp;
+	struct regex *regex;
+	struct SEE_string *text;
+	unsigned int start;
+	struct capture *capture_ret;
+{
+	SEE_uint32_t state = 0, mask, hit;
+	SEE_unicode_t ch;
+	unsigned int i;
+	int k;
+
+	hit = (SEE_uint32_t)1 << (regex->salen - 1);
+	for (i = start; i < text->length; i++) {
+	    ch = text->data[i];
+	    if ((ch & 0xf800) == 0xd800)
+		return -1;
+	    ch = Canonicalize(regex, ch);
+	    if (ch < 0x100)
+		mask = regex->samask[ch];
+	    else {
+		mask = 0;
+		for (k = 0; k < regex->salen; k++)
+		    if (cc_contains(regex->cc[CODE_MAKEI(regex->code,
+			1 + k * (1 + CODE_SZI))], ch))
+			mask |= (SEE_uint32_t)1 << k;
+	    }
+	    state = ((state << 1) | 1) & mask;
+	    if (state & hit) {
+		capture_ret[0].start = i + 1 - regex->salen;
+		capture_ret[0].end = i + 1;
+		return 1;
+	    }
+	}
+	return 0;
+}
+
+/*
+ * Searches for the first match of the regex in the text at or after
+ * index, like calling SEE_regex_match() for each index up to and
+ * including text->length, but skipping positions that cannot start
+ * a match. Returns true if a match was found.
+ */
+int
+SEE_regex_search(interp, regex, text, index, capture_ret)
+	struct SEE_interpreter *interp;
+	struct regex *regex;
+	struct SEE_string *text;
+	unsigned int index;
+	struct capture *capture_ret;
+{
+	SEE_unicode_t ch;
+	int result;
+
+	if (regex->salen) {
+	    result = shiftand_run(interp, regex, text, index, capture_ret);
+	    if (result >= 0)
+		return result;
+	}
+
+	for (; index <= text->length; index++) {
+	    if (regex->firstvalid) {
+		/* each alternative has to consume a character first */
+		if (index == text->length)
+		    return 0;
+		ch = Canonicalize(regex, text->data[index]);
+		if (ch < 0x100 &&
+		    !(regex->firstmap[ch >> 3] & (1 << (ch & 7))))
+		    continue;
+	    }
+	    if (SEE_regex_match(interp, regex, text, index, capture_ret))
+		return 1;
+	}
+	return 0;
+}
+
 /*------------------------------------------------------------
  * optimizer
  */
 
+/*
+ * Adds the characters below 256 that may start a match from addr to
+ * regex->firstmap. Returns false if a match from addr may begin
+ * without consuming a character (or if we are not sure about it).
+ */
+static int
+first_chars(regex, addr, depth)
+	struct regex *regex;
+	unsigned int addr;
+	int depth;
+{
+	struct charclassrange *r;
+	SEE_unicode_t ch;
+
+	while (depth++ < 32 && addr < regex->codelen) {
+	    switch (regex->code[addr]) {
+	    case OP_CHAR:
+		for (r = regex->cc[CODE_MAKEI(regex->code, addr + 1)]->ranges;
+		     r && r->lo < 0x100; r = r->next)
+		    for (ch = r->lo; ch < r->hi && ch < 0x100; ch++)
+			regex->firstmap[ch >> 3] |= 1 << (ch & 7);
+		return 1;
+	    case OP_START:	case OP_END:	case OP_MARK:
+	    case OP_ZERO:
+		addr += 1 + CODE_SZI;
+		break;
+	    case OP_UNDEF:
+		addr += 1 + 2 * CODE_SZI;
+		break;
+	    case OP_GOTO:
+		addr = CODE_MAKEA(regex->code, addr + 1);
+		break;
+	    case OP_GF:		case OP_NF:
+		if (!first_chars(regex, CODE_MAKEA(regex->code, addr + 1),
+		    depth))
+		    return 0;
+		addr += 1 + CODE_SZA;
+		break;
+	    default:
+		return 0;
+	    }
+	}
+	return 0;
+}
+
 static void
 optimize_regex(interp, regex)
 	struct SEE_interpreter *interp;
 	struct regex *regex;
 {
+	int i, k, n;
+	SEE_unicode_t ch;
+
+	/*
+	 * A sequence of character classes without any groups is
+	 * matched bit-parallel. This covers the literal patterns
+	 * typically used for replacing in tags.
+	 */
+	n = 0;
+	for (i = 0; i < regex->codelen && regex->code[i] == OP_CHAR;
+	     i += 1 + CODE_SZI)
+		n++;
+	if (regex->ncaptures == 1 && n > 0 && n <= 32 &&
+	    i == regex->codelen - 1 && regex->code[i] == OP_SUCCEED)
+	{
+	    regex->samask = SEE_NEW_STRING_ARRAY(interp, SEE_uint32_t, 0x100);
+	    for (ch = 0; ch < 0x100; ch++) {
+		regex->samask[ch] = 0;
+		for (k = 0; k < n; k++)
+		    if (cc_contains(regex->cc[CODE_MAKEI(regex->code,
+			1 + k * (1 + CODE_SZI))], ch))
+			regex->samask[ch] |= (SEE_uint32_t)1 << k;
+	    }
+	    regex->salen = n;
+	}
+
 	/*
-	 * (nothing here yet)
-	 *
-	 * possible optimisations include branch short-cuts,
-	 * and compiling the p-code to native machine instructions.
+	 * For all other patterns, collect the possible first characters
+	 * so that SEE_regex_search() can skip hopeless start positions
+	 * without entering the backtracking matcher.
 	 */
+	memset(regex->firstmap, 0, sizeof regex->firstmap);
+	regex->firstvalid = first_chars(regex, 0, 0);
 }
@@ -72,6 +72,7 @@ struct SEE_interpreter {
 
 	void **module_private;		/* private pointers for each module */
 	void *intern_tab;		/* interned string table */
+	void *regex_cache;		/* compiled regex cache (regex.c) */
 	unsigned int random_seed;	/* used by Math.random() */
 	const char *locale;		/* current locale (may be NULL) */
 	int recursion_limit;		/* -1 means don't care */
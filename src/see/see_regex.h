@@ -25,6 +25,9 @@ int SEE_regex_get_flags(struct regex *regex);
 int SEE_regex_match(struct SEE_interpreter *interp, 
 	struct regex *regex, struct SEE_string *text, 
 	unsigned int start, struct capture *captures);
+int SEE_regex_search(struct SEE_interpreter *interp, 
+	struct regex *regex, struct SEE_string *text, 
+	unsigned int start, struct capture *captures);
 
 /* defined in obj_RegExp.c to wrap RegExp objects: */
 int SEE_is_RegExp(struct SEE_object *regexp);
@@ -72,7 +72,25 @@ IMPLEMENT_FUNCTION(database, construct)
 IMPLEMENT_FUNCTION(database, openQuery)
 {
 	database_object* dbo = toDatabase(interpr_, this_);
-	RETURN_BOOL( dbo->sql->Query(ARG_STRING(0)) );
+	wxString query = ARG_STRING(0);
+	wxSqltDb* db = dbo->db? dbo->db : wxSqltDb::GetDefault();
+	db->ConfigFlush(); // scripts may read the config table
+	bool ret = dbo->sql->Query(query);
+
+	if( !query.Strip(wxString::both).Upper().StartsWith(wxT("SELECT")) )
+	{
+		// scripts may modify the config table ...
+		db->ConfigForget();
+
+		// ... and the tracks table of the jukebox file
+		if( dbo->db == NULL )
+		{
+			g_mainFrame->m_libraryModule->m_trackIndex.Invalidate();
+			g_mainFrame->m_libraryModule->m_advSearchCache.Invalidate();
+		}
+	}
+
+	RETURN_BOOL( ret );
 }
 
 
@@ -117,6 +135,217 @@ IMPLEMENT_FUNCTION(database, getField)
 }
 
 
+IMPLEMENT_FUNCTION(database, prepare)
+{
+	database_object* dbo = toDatabase(interpr_, this_);
+	RETURN_BOOL( dbo->sql->Prepare(ARG_STRING(0)) );
+}
+
+
+IMPLEMENT_FUNCTION(database, execute)
+{
+	database_object* dbo = toDatabase(interpr_, this_);
+
+	// bind the given arguments to the placeholders of the prepared statement;
+	// strings are converted to UTF-8 directly, without going through wxString
+	dbo->sql->Reset();
+	for( int i = 0; i < argc_; i++ )
+	{
+		bool ok;
+		switch( SEE_VALUE_GET_TYPE(argv_[i]) )
+		{
+			case SEE_UNDEFINED:
+			case SEE_NULL:
+				ok = dbo->sql->BindNull(i+1);
+				break;
+
+			case SEE_BOOLEAN:
+				ok = dbo->sql->Bind(i+1, (long)(argv_[i]->u.boolean? 1 : 0));
+				break;
+
+			case SEE_NUMBER:
+			{
+				double d = argv_[i]->u.number;
+				if( d > -2147483648.0 && d < 2147483648.0 && d == (double)(long)d )
+					ok = dbo->sql->Bind(i+1, (long)d);
+				else
+					ok = dbo->sql->Bind(i+1, d);
+				break;
+			}
+
+			default:
+			{
+				SEE_value strValue;
+				SEE_ToString(interpr_, argv_[i], &strValue);
+				SEE_size_t bytes = SEE_string_utf8_size(interpr_, strValue.u.string);
+				char* utf8 = (char*)SEE_malloc_string(interpr_, bytes+1);
+				SEE_string_toutf8(interpr_, utf8, bytes+1, strValue.u.string);
+				ok = dbo->sql->Bind(i+1, utf8, (int)bytes);
+				break;
+			}
+		}
+
+		if( !ok )
+		{
+			RETURN_FALSE;
+			return;
+		}
+	}
+
+	RETURN_BOOL( dbo->sql->Execute() );
+}
+
+
+static SEE_string* Utf8ToSeeString(SEE_interpreter* interpr, const char* src__, int bytes)
+{
+	// convert UTF-8 as returned by sqlite directly to a SEE string; invalid
+	// sequences (we stored ISO 8859-1 in very old versions) are taken as ISO 8859-1
+	const unsigned char* src = (const unsigned char*)src__;
+	SEE_string*     dest = SEE_string_new(interpr, bytes); // UTF-16 never needs more units than UTF-8 bytes
+	SEE_char_t*     destPtr = dest->data;
+	int             i = 0;
+	unsigned long   ch;
+
+	while( i < bytes )
+	{
+		ch = src[i];
+		if( ch >= 0xC0 && ch < 0xE0 && i+1 < bytes && (src[i+1]&0xC0)==0x80 )
+		{
+			ch = ((ch&0x1F)<<6) | (src[i+1]&0x3F);
+			i += 2;
+		}
+		else if( ch >= 0xE0 && ch < 0xF0 && i+2 < bytes && (src[i+1]&0xC0)==0x80 && (src[i+2]&0xC0)==0x80 )
+		{
+			ch = ((ch&0x0F)<<12) | ((src[i+1]&0x3F)<<6) | (src[i+2]&0x3F);
+			i += 3;
+		}
+		else if( ch >= 0xF0 && ch < 0xF8 && i+3 < bytes && (src[i+1]&0xC0)==0x80 && (src[i+2]&0xC0)==0x80 && (src[i+3]&0xC0)==0x80 )
+		{
+			ch = ((ch&0x07)<<18) | ((src[i+1]&0x3F)<<12) | ((src[i+2]&0x3F)<<6) | (src[i+3]&0x3F);
+			i += 4;
+		}
+		else
+		{
+			i++;
+		}
+
+		if( ch >= 0x10000 )
+		{
+			ch -= 0x10000;
+			*destPtr++ = (SEE_char_t)(0xD800 | (ch>>10));
+			*destPtr++ = (SEE_char_t)(0xDC00 | (ch&0x3FF));
+		}
+		else
+		{
+			*destPtr++ = (SEE_char_t)ch;
+		}
+	}
+
+	dest->length = destPtr - dest->data;
+	return dest;
+}
+
+
+static void GetFieldValue(SEE_interpreter* interpr, wxSqlt* sql, int field, SEE_value* res)
+{
+	// unlike getField(), numeric columns are returned as numbers here
+	switch( sql->GetType(field) )
+	{
+		case SQLITE_NULL:
+			SEE_SET_UNDEFINED(res);
+			break;
+
+		case SQLITE_INTEGER:
+		case SQLITE_FLOAT:
+			SEE_SET_NUMBER(res, sql->GetDouble(field));
+			break;
+
+		default:
+		{
+			int bytes;
+			const char* utf8 = sql->GetUtf8Ptr(field, &bytes);
+			SEE_SET_STRING(res, Utf8ToSeeString(interpr, utf8? utf8 : "", utf8? bytes : 0));
+			break;
+		}
+	}
+}
+
+
+static SEE_object* NewSeeArray(SEE_interpreter* interpr)
+{
+	SEE_value temp;
+	_SEE_OBJECT_CONSTRUCT(interpr, interpr->Array, interpr->Array, 0, NULL, &temp);
+	return temp.u.object;
+}
+
+
+IMPLEMENT_FUNCTION(database, fetchAll)
+{
+	// returns all remaining records as an array of rows, each row is an array of fields
+	database_object* dbo = toDatabase(interpr_, this_);
+	wxSqlt*     sql = dbo->sql;
+	SEE_object* rows = NewSeeArray(interpr_);
+	SEE_value   temp;
+	long        maxRows = ARG_LONG_OR_DEF(0, 0);
+	long        rowCount = 0;
+
+	while( (maxRows <= 0 || rowCount < maxRows) && sql->Next() )
+	{
+		SEE_object* row = NewSeeArray(interpr_);
+		int f, fieldCount = sql->GetFieldCount();
+		for( f = 0; f < fieldCount; f++ )
+		{
+			GetFieldValue(interpr_, sql, f, &temp);
+			SEE_Array_push(interpr_, row, &temp);
+		}
+
+		SEE_SET_OBJECT(&temp, row);
+		SEE_Array_push(interpr_, rows, &temp);
+		rowCount++;
+	}
+
+	RETURN_OBJECT( rows );
+}
+
+
+IMPLEMENT_FUNCTION(database, fetchColumns)
+{
+	// returns all remaining records as an array of columns, each column is an array of values
+	database_object* dbo = toDatabase(interpr_, this_);
+	wxSqlt*     sql = dbo->sql;
+	SEE_object* cols = NewSeeArray(interpr_);
+	SEE_object** colArrays = NULL;
+	SEE_value   temp;
+	int         f, fieldCount = 0;
+	long        maxRows = ARG_LONG_OR_DEF(0, 0);
+	long        rowCount = 0;
+
+	while( (maxRows <= 0 || rowCount < maxRows) && sql->Next() )
+	{
+		if( colArrays == NULL )
+		{
+			fieldCount = sql->GetFieldCount();
+			colArrays = (SEE_object**)SEE_malloc(interpr_, sizeof(SEE_object*) * (fieldCount+1));
+			for( f = 0; f < fieldCount; f++ )
+			{
+				colArrays[f] = NewSeeArray(interpr_);
+				SEE_SET_OBJECT(&temp, colArrays[f]);
+				SEE_Array_push(interpr_, cols, &temp);
+			}
+		}
+
+		for( f = 0; f < fieldCount; f++ )
+		{
+			GetFieldValue(interpr_, sql, f, &temp);
+			SEE_Array_push(interpr_, colArrays[f], &temp);
+		}
+		rowCount++;
+	}
+
+	RETURN_OBJECT( cols );
+}
+
+
 IMPLEMENT_FUNCTION(database, closeQuery)
 {
 	database_object* dbo = toDatabase(interpr_, this_);
@@ -202,6 +431,10 @@ void SjSee::Database_init()
 	PUT_FUNC(m_Database_prototype, database, getFieldCount, 0);
 	PUT_FUNC(m_Database_prototype, database, getField, 0);
 	PUT_FUNC(m_Database_prototype, database, closeQuery, 0);
+	PUT_FUNC(m_Database_prototype, database, prepare, 0);
+	PUT_FUNC(m_Database_prototype, database, execute, 0);
+	PUT_FUNC(m_Database_prototype, database, fetchAll, 0);
+	PUT_FUNC(m_Database_prototype, database, fetchColumns, 0);
 	PUT_FUNC(m_Database_prototype, database, getFile, 0);
 
 	// create the "Database" object
@@ -215,6 +215,17 @@ IMPLEMENT_FUNCTION(player, removeAll)
 }
 
 
+/*******************************************************************************
+ * dspProfile, getDspStats()
+ ******************************************************************************/
+
+
+IMPLEMENT_FUNCTION(player, getDspStats)
+{
+	RETURN_STRING( g_mainFrame->m_player.m_dspProfiler.GetStats() );
+}
+
+
 /*******************************************************************************
  * Properties
  ******************************************************************************/
@@ -236,6 +247,7 @@ IMPLEMENT_HASPROPERTY(player)
 	 || VAL_PROPERTY( stopAfterEachTrack )
 	 || VAL_PROPERTY( removePlayed )
 	 || VAL_PROPERTY( avoidBoredom )
+	 || VAL_PROPERTY( dspProfile )
 	)
 	{
 		RETURN_HAS;
@@ -310,6 +322,10 @@ IMPLEMENT_GET(player)
 		queueFlags &= SJ_QUEUEF_BOREDOM_TRACKS|SJ_QUEUEF_BOREDOM_ARTISTS;
 		RETURN_LONG( queueFlags );
 	}
+	else if( VAL_PROPERTY( dspProfile ) )
+	{
+		RETURN_BOOL( g_mainFrame->m_player.m_dspProfiler.IsEnabled() );
+	}
 	else
 	{
 		RETURN_GET_DEFAULTS;
@@ -381,6 +397,10 @@ IMPLEMENT_PUT(player)
 		queueFlags |= VAL_LONG;
 		g_mainFrame->m_player.m_queue.SetQueueFlags(queueFlags, b1, b2);
 	}
+	else if( VAL_PROPERTY( dspProfile ) )
+	{
+		g_mainFrame->m_player.m_dspProfiler.Enable( VAL_BOOL );
+	}
 	else
 	{
 		DO_PUT_DEFAULTS;
@@ -456,6 +476,8 @@ void SjSee::Player_init()
 	PUT_FUNC(m_Player_prototype, player, removeAtPos,       0);
 	PUT_FUNC(m_Player_prototype, player, removeAll,         0);
 
+	PUT_FUNC(m_Player_prototype, player, getDspStats,       0);
+
 	// create the "Player" object
 	SEE_object* Player = (SEE_object *)SEE_malloc(m_interpr, sizeof(SEE_native));
 
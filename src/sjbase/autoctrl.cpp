@@ -429,6 +429,27 @@ void SjAutoCtrl::OnOneSecondTimer()
 
 		g_mainFrame->m_player.OneSecondTimer();
 
+		// automatic control: write pending playback statistics?
+		//////////////////////////////////////////////////////////////////////////////////////////////
+
+		if( g_mainFrame->m_libraryModule->IsPendingDataDue(thisTimestamp)
+		 && !g_mainFrame->m_mainApp->IsInShutdown()
+		 && !SjBusyInfo::InYield() )
+		{
+			g_mainFrame->m_libraryModule->SavePendingData();
+		}
+
+		// automatic control: write changed settings?
+		//////////////////////////////////////////////////////////////////////////////////////////////
+
+		wxSqltDb* db = wxSqltDb::GetDefault();
+		if( db && db->HasConfigPending()
+		 && !g_mainFrame->m_mainApp->IsInShutdown()
+		 && !SjBusyInfo::InYield() )
+		{
+			db->ConfigFlush();
+		}
+
 		// automatic control: do cleanup temp?
 		//////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -930,16 +951,14 @@ int SjAutoCtrl::IsCurrTrackCloseToEnd(long headroomMs) // returns 0, 1 or -1 for
 
 wxString SjAutoCtrl::GetAutoPlayUrl()
 {
-	wxArrayLong trackIdsArray;
-	long        trackIdsCount = 0;
+	SjIdSet     trackIds;
 
-	// get an array of available track IDs
-	//////////////////////////////////////
+	// get the available track IDs
+	//////////////////////////////
 
 	{
 		// collect the track IDs to ignore
-		SjLLHash ignoreIdsHash;
-		long     ignoreIdsCount = 0;
+		SjIdSet ignoreIds;
 		if( m_flags & SJ_AUTOCTRL_AUTOPLAY_IGNORE )
 		{
 			SjAdvSearch advSearch = g_advSearchModule->GetSearchById(m_autoPlayMusicSelIgnoreId);
@@ -951,12 +970,10 @@ wxString SjAutoCtrl::GetAutoPlayUrl()
 			}
 
 			wxString dummySelectSql;
-			advSearch.GetAsSql(&ignoreIdsHash, dummySelectSql);
-			ignoreIdsCount = ignoreIdsHash.GetCount();
+			advSearch.GetAsSql(&ignoreIds, dummySelectSql);
 		}
 
 		// collect the possible track IDs
-		SjLLHash trackIdsHash;
 		if( m_autoPlayMusicSelId == 0 )
 		{
 			// get the IDs currently in view - this is
@@ -964,7 +981,7 @@ wxString SjAutoCtrl::GetAutoPlayUrl()
 			//      - a simple search,
 			//      - an adv. plus a simple search
 			//      - all tracks
-			g_mainFrame->m_libraryModule->GetIdsInView(&trackIdsHash, TRUE/*ignoreSimpleSearchIfNull*/,
+			g_mainFrame->m_libraryModule->GetIdsInView(&trackIds, TRUE/*ignoreSimpleSearchIfNull*/,
 			        TRUE/*ignoreAdvSearchIfNull*/);
 		}
 		else
@@ -983,24 +1000,16 @@ wxString SjAutoCtrl::GetAutoPlayUrl()
 
 			// get all track IDs in this adv. search
 			wxString dummySelectSql;
-			advSearch.GetAsSql(&trackIdsHash, dummySelectSql);
+			advSearch.GetAsSql(&trackIds, dummySelectSql);
 		}
 
-		// convert hash to array
-		long tempTrackId;
-		long maxTrackIdsCount = trackIdsHash.GetCount(); if( maxTrackIdsCount < 16 ) maxTrackIdsCount = 16;
-		trackIdsArray.Alloc(maxTrackIdsCount);
-		SjHashIterator iterator;
-		while( (trackIdsHash.Iterate(iterator, &tempTrackId)) )
+		// remove the track IDs to ignore
+		if( ignoreIds.GetCount() )
 		{
-			if( ignoreIdsCount==0L || ignoreIdsHash.Lookup(tempTrackId)==0L )
-			{
-				trackIdsArray.Add(tempTrackId);
-				trackIdsCount++;
-			}
+			trackIds.AndNot(ignoreIds);
 		}
 
-		if( trackIdsCount <= 0 )
+		if( trackIds.GetCount() <= 0 )
 		{
 			// there are no tracks in this music selection; however, DO NOT
 			// disable auto-play therefore as the music selection may be dynamic
@@ -1020,11 +1029,10 @@ wxString SjAutoCtrl::GetAutoPlayUrl()
 	long selectedTrackId = 0;
 	for( int iterations = 0; iterations < MAX_ITERATIONS; iterations++ )
 	{
-		long testIndex = SjTools::Rand(trackIdsCount);
-		wxASSERT( testIndex >= 0 && testIndex < trackIdsCount);
-		wxASSERT( trackIdsCount <= (long)trackIdsArray.GetCount() );
+		long testIndex = SjTools::Rand(trackIds.GetCount());
+		wxASSERT( testIndex >= 0 && testIndex < trackIds.GetCount() );
 
-		selectedTrackId = trackIdsArray[testIndex];
+		trackIds.Select(testIndex, &selectedTrackId);
 
 		if( m_autoPlayedTrackIds.Index(selectedTrackId)==wxNOT_FOUND )
 		{
@@ -1038,11 +1046,10 @@ wxString SjAutoCtrl::GetAutoPlayUrl()
 				break; // okay, fine track found
 		}
 
-		// remove the test index from trackIdsArray
-		trackIdsCount--;
-		if( trackIdsCount <= 0 )
+		// remove the tested ID from the available IDs
+		if( trackIds.GetCount() <= 1 )
 			break; // nothing found, nevertheless, use selectedTrackId
-		trackIdsArray[testIndex] = trackIdsArray[trackIdsCount /*one substracted above!*/];
+		trackIds.Remove(selectedTrackId);
 	}
 
 	// done, add the track to the internal cache that avoids playing the same tracks too often
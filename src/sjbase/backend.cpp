@@ -51,6 +51,7 @@ wxString SjBackend::GetName() const
 {
 	     if(m_id==SJBE_ID_STDOUTPUT )  { return "stdoutput";  }
 	else if(m_id==SJBE_ID_PRELISTEN )  { return "prelisten";  }
+	else if(m_id==SJBE_ID_HEADLESS  )  { return "headless";   }
 	else                               { return "unknown";    }
 }
 
@@ -69,6 +70,7 @@ SjBackendStream::SjBackendStream(const wxString& url, SjBackend* backend, SjBack
 	m_cbp.backend      = backend;
 	m_cbp.stream       = this;
 	m_userdata         = userdata;
+	m_prerolled        = false;
 
 	// we keep a list of all streams created on the backend; may be useful for the implementations
 	backend->m_allStreams.Add(this);
@@ -96,3 +98,15 @@ SjBackendStream::~SjBackendStream()
 	}
 }
 
+
+void SjBackendStream::StartPrerolled()
+{
+	wxASSERT( wxThread::IsMain() );
+
+	if( m_prerolled )
+	{
+		m_prerolled = false;
+		m_cbp.startingTime = wxDateTime::Now().GetAsDOS(); // the stream was created some time before
+		OnStartPrerolled();
+	}
+}
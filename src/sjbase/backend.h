@@ -38,7 +38,8 @@ class SjBackendUserdata;
 enum SjBackendId
 {
 	SJBE_ID_STDOUTPUT  = 0,
-	SJBE_ID_PRELISTEN  = 1
+	SJBE_ID_PRELISTEN  = 1,
+	SJBE_ID_HEADLESS   = 2  // used instead of SJBE_ID_STDOUTPUT if there is no audio device; the backend should decode as fast as possible
 };
 
 
@@ -96,6 +97,13 @@ public:
 	virtual void             SetDeviceState   (SjBackendState state) = 0;
 	virtual void             SetDeviceVol     (double gain) = 0; // 0.0 - 1.0, only called on opened devices
 
+	// Optional: PrerollStream() creates a stream that is opened and buffered but waits
+	// until SjBackendStream::StartPrerolled() is called. Prerolled streams do not count for
+	// GetDeviceState() and are not affected by SetDeviceState().  PrerollStream() must
+	// not block; it is only called if CanPreroll() returns true.
+	virtual bool             CanPreroll       () const { return false; }
+	virtual SjBackendStream* PrerollStream    (const wxString& url, SjBackendCallback*, SjBackendUserdata*) { return NULL; }
+
 	// higher-level functions
 	bool                     IsDeviceOpened   () const { return (GetDeviceState()!=SJBE_STATE_CLOSED); }
 	SjBackendId              GetId            () const { return m_id; };
@@ -118,10 +126,17 @@ protected:                   SjBackendStream  (const wxString& url, SjBackend* b
 public: virtual              ~SjBackendStream ();
 	virtual void             GetTime          (long& totalMs, long& elapsedMs) = 0; // -1=unknown
 	virtual void             SeekAbs          (long ms) = 0;
+	virtual bool             HasErrors        () const { return false; } // TRUE if decoding failed; SJBE_MSG_END_OF_STREAM may be sent for errors, too
+protected:
+	virtual void             OnStartPrerolled () {} // only called for streams created by PrerollStream()
+	bool                     m_prerolled;
 
+public:
 	// higher-level functions
 	wxString                 GetUrl           () const { return m_url; }
 	uint32_t                 GetStartingTime  () const { return m_cbp.startingTime; }
+	bool                     IsPrerolled      () const { return m_prerolled; }
+	void                     StartPrerolled   ();
 
 	// these fields may be used by user for any purposes; must _not_ be used by derived classes!
 	SjBackendUserdata*       m_userdata;
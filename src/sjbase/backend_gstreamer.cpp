@@ -49,6 +49,17 @@
 #define NANOSEC_TO_MILLISEC_DIVISOR    1000000L
 
 
+void SjGstreamerBackendStream::release_hold(bool drop)
+{
+	wxMutexLocker locker(m_holdMutex);
+	if( m_holding ) {
+		m_holding  = false;
+		m_holdDrop = drop;
+		m_holdCond.Broadcast();
+	}
+}
+
+
 void SjGstreamerBackendStream::set_pipeline_state(GstState s)
 {
 	if( !m_pipeline ) {
@@ -109,6 +120,7 @@ gboolean on_bus_message(GstBus* bus, GstMessage* msg, gpointer userdata)
 				g_free(debug);
 				g_error_free(error);
 
+				stream->m_errorReceived = true; // do not reuse the pipeline
 				prepareNext = true;
 			}
 			break;
@@ -162,8 +174,9 @@ void on_pad_added(GstElement* decodebin, GstPad* newSourcePad, gpointer userdata
 
 	if( isVideoPad )
 	{
-		// create video sink and connect the pad to it
-		if( stream->m_backend->WantsVideo() )
+		// create video sink and connect the pad to it; prerolled streams do not get a video sink
+		// as this would open the video window before the stream is played - the player will recreate the stream.
+		if( stream->m_backend->WantsVideo() && !stream->IsPrerolled() )
 		{
 			GError* error = NULL;
 			GstElement* videosink = gst_parse_bin_from_description(stream->m_backend->m_iniVideoPipeline, true, &error);
@@ -184,6 +197,7 @@ void on_pad_added(GstElement* decodebin, GstPad* newSourcePad, gpointer userdata
 			}
 
 			gst_element_sync_state_with_parent(videosink);
+			stream->m_videoSinkAdded = true;
 		}
 	}
 	else
@@ -235,6 +249,18 @@ GstPadProbeReturn on_pad_data(GstPad* pad, GstPadProbeInfo* info, gpointer userd
 		}
 	}
 
+	// a prerolled stream waits here until it is started or deleted, see release_hold();
+	// this way, the first buffer is not processed with outdated fading or equalizer settings
+	{
+		wxMutexLocker locker(stream->m_holdMutex);
+		while( stream->m_holding ) {
+			stream->m_holdCond.Wait();
+		}
+		if( stream->m_holdDrop ) {
+			return GST_PAD_PROBE_DROP;
+		}
+	}
+
 	// forward the buffer to the given callback
 	GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
 	buffer = gst_buffer_make_writable(buffer);
@@ -268,12 +294,14 @@ SjGstreamerBackend::SjGstreamerBackend(SjBackendId id)
 	//     audioecho delay=500000000 intensity=0.6 feedback=0.4 ! autoaudiosink
 	//     pulsesink
 	//     filesink location=/tmp/raw
+	//     fakesink sync=false          (default for the headless backend: no device, no clock, decode as fast as possible)
 	#define AUDIOPIPELINE_ININAME "gstreamer/"+GetName()+"AudioPipeline"
-	#define AUDIOPIPELINE_DEFAULT "autoaudiosink"
+	#define AUDIOPIPELINE_DEFAULT (GetId()==SJBE_ID_HEADLESS? "fakesink sync=false" : "autoaudiosink")
 	#define VIDEOPIPELINE_ININAME "gstreamer/"+GetName()+"VideoPipeline"
 	#define VIDEOPIPELINE_DEFAULT "autovideosink"
 	wxConfigBase* c = g_tools->m_config;
 	m_iniAudioPipeline = c->Read(AUDIOPIPELINE_ININAME, AUDIOPIPELINE_DEFAULT);
+	m_iniPipelinePool  = c->Read("gstreamer/pipelinePool", SJ_GST_DEF_PIPELINE_POOL);
 	if( WantsVideo() ) {
 		m_iniVideoPipeline = c->Read(VIDEOPIPELINE_ININAME, VIDEOPIPELINE_DEFAULT);
 	}
@@ -305,9 +333,18 @@ void SjGstreamerBackend::GetLittleOptions(SjArrayLittleOption& lo)
 
 SjBackendStream* SjGstreamerBackend::CreateStream(const wxString& uri, long seekMs, SjBackendCallback* cb, SjBackendUserdata* userdata)
 {
-	SjGstreamerBackendStream* stream = new SjGstreamerBackendStream(uri, this, cb, userdata);
-	if( stream == NULL ) { return NULL; }
+	return CreateStream__(uri, seekMs, cb, userdata, false);
+}
+
+
+SjBackendStream* SjGstreamerBackend::PrerollStream(const wxString& uri, SjBackendCallback* cb, SjBackendUserdata* userdata)
+{
+	return CreateStream__(uri, 0, cb, userdata, true);
+}
 
+
+GstElement* SjGstreamerBackend::CreatePipeline()
+{
 	/*
 	              .--> audioconvert --> capsfilter --> (X) volume -> audiosink
 	decodebin --> |                                     :
@@ -316,10 +353,10 @@ SjBackendStream* SjGstreamerBackend::CreateStream(const wxString& uri, long seek
 	*/
 
 	// create objects
-	// NB: is is the far faster part, on my computer creating the pipeline takes 4 ms while starting the stream takes 40 ms -
-	// if there are no other problems on recreating the pipeline on every call, there is no need to change this - esp. as there are some advantages as easier cleaning up, different samplerates etc.
+	// NB: creating the pipeline takes about 4 ms on my computer while starting the stream takes 40 ms; however,
+	// the audio device is opened and closed with each pipeline, so we keep some pipelines in a pool, see ReleasePipeline()
 	GError* error = NULL;
-	stream->m_pipeline       = gst_pipeline_new        (                 "sjPlayer"    );
+	GstElement* pipeline     = gst_pipeline_new        (                 "sjPlayer"    );
 	GstElement* decodebin    = gst_element_factory_make("uridecodebin",  "sjSource"    );
 	GstElement* audioconvert = gst_element_factory_make("audioconvert",  "sjAudioEntry");
 	GstElement* capsfilter   = gst_element_factory_make("capsfilter",    NULL          );
@@ -330,24 +367,22 @@ SjBackendStream* SjGstreamerBackend::CreateStream(const wxString& uri, long seek
 		wxLogError("GStreamer Error: %s. Please check the audio configuration at Settings/Advanced.", errormessageWxStr.c_str());
 		g_error_free(error);
 	} // no "return", no "else" - it may be possible, the pipeline is created even on errors, see http://gstreamer.freedesktop.org/data/doc/gstreamer/head/gstreamer/html/gstreamer-GstParse.html#gst-parse-launch
-	if( !stream->m_pipeline || !decodebin || !audioconvert || !capsfilter || !volume || !audiosink ) {
+	if( !pipeline || !decodebin || !audioconvert || !capsfilter || !volume || !audiosink ) {
 		wxLogError("GStreamer error: Cannot create objects.");
-		delete stream;
+		if( pipeline ) { gst_object_unref(GST_OBJECT(pipeline)); }
 		return NULL; // error
 	}
 
 	// create pipeline
-	gst_bin_add_many(GST_BIN(stream->m_pipeline), decodebin, audioconvert, capsfilter, volume, audiosink, NULL); // NULL marks end of list
+	gst_bin_add_many(GST_BIN(pipeline), decodebin, audioconvert, capsfilter, volume, audiosink, NULL); // NULL marks end of list
 	gst_element_link_many(audioconvert, capsfilter, volume, audiosink, NULL);
-	g_signal_connect(decodebin, "pad-added", G_CALLBACK(on_pad_added), stream /*userdata*/);
 
-	// add a message handler
-	GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(stream->m_pipeline));
-		stream->m_bus_watch_id = gst_bus_add_watch(bus, on_bus_message, stream /*userdata*/);
-		gst_bus_set_sync_handler(bus, on_bus_sync_handler, stream /*userdata*/, NULL);
+	// the sync handler does not depend on the stream, so it is set only once per pipeline
+	GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline));
+		gst_bus_set_sync_handler(bus, on_bus_sync_handler, NULL, NULL);
 	gst_object_unref(bus);
 
-	// setup capsfilter and dsp callback
+	// setup capsfilter
 	GstCaps* caps = gst_caps_new_simple("audio/x-raw",
 				"format", G_TYPE_STRING, "F32LE",       // or S16LE, U8, ...
 				"layout", G_TYPE_STRING, "interleaved", // LRLRLRLRLRLRLR ...
@@ -357,24 +392,150 @@ SjBackendStream* SjGstreamerBackend::CreateStream(const wxString& uri, long seek
 		 g_object_set(G_OBJECT(capsfilter), "caps", caps, NULL);
 	gst_caps_unref(caps);
 
-	GstPad* pad = gst_element_get_static_pad(volume, "sink"); // sink/src is defined from the view of within the element: elements receive data on their sink pads and generate data on their source pads.
-		gulong probeid = gst_pad_add_probe(pad,
-			(GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER),
-			on_pad_data, (gpointer)stream/*userdata*/, NULL);
-		if( probeid==0 ) {
-			wxLogError("GStreamer Error: Cannot add probe callback.");
+	return pipeline;
+}
+
+
+GstElement* SjGstreamerBackend::TakePipeline()
+{
+	// the pool is flushed if the pipeline was changed in the settings meanwhile
+	if( m_poolAudioPipeline != m_iniAudioPipeline ) {
+		FlushPipelinePool();
+	}
+
+	size_t cnt = m_pipelinePool.GetCount();
+	if( cnt == 0 ) {
+		return NULL;
+	}
+
+	GstElement* pipeline = (GstElement*)m_pipelinePool.Item(cnt-1);
+	m_pipelinePool.RemoveAt(cnt-1);
+	return pipeline;
+}
+
+
+void SjGstreamerBackend::ReleasePipeline(SjGstreamerBackendStream* stream)
+{
+	// stop the pipeline; this also stops the streaming threads, so there are no more callbacks for the stream
+	stream->set_pipeline_state(GST_STATE_READY);
+
+	// disconnect the pipeline from the stream
+	g_source_remove(stream->m_bus_watch_id);
+	stream->m_bus_watch_id = 0;
+
+	GstElement* decodebin = gst_bin_get_by_name(GST_BIN(stream->m_pipeline), "sjSource");
+	if( decodebin ) {
+		g_signal_handlers_disconnect_by_data(decodebin, stream);
+		gst_object_unref(decodebin);
+	}
+
+	GstElement* volume = gst_bin_get_by_name(GST_BIN(stream->m_pipeline), "sjVolume");
+	if( volume ) {
+		GstPad* pad = gst_element_get_static_pad(volume, "sink");
+			if( stream->m_probe_id ) { gst_pad_remove_probe(pad, stream->m_probe_id); }
+		gst_object_unref(pad);
+		g_object_set(G_OBJECT(volume), "volume", (gdouble)1.0, NULL); // as for new pipelines
+		gst_object_unref(volume);
+	}
+	stream->m_probe_id = 0;
+
+	// keep the pipeline for the next stream?
+	// pipelines with a video sink or with errors are not reused, the audio device is released when the device is closed.
+	if( m_poolAudioPipeline != m_iniAudioPipeline ) {
+		FlushPipelinePool();
+		m_poolAudioPipeline = m_iniAudioPipeline;
+	}
+
+	if( m_pipelinePool.GetCount() < (size_t)m_iniPipelinePool
+	 && !stream->m_videoSinkAdded
+	 && !stream->m_errorReceived
+	 && stream->m_audioPipeline == m_iniAudioPipeline )
+	{
+		// drop old messages as EOS, they must not be sent to the next stream
+		GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(stream->m_pipeline));
+			gst_bus_set_flushing(bus, TRUE);
+			gst_bus_set_flushing(bus, FALSE);
+		gst_object_unref(bus);
+
+		m_pipelinePool.Add(stream->m_pipeline);
+	}
+	else
+	{
+		gst_element_set_state(stream->m_pipeline, GST_STATE_NULL);
+		gst_object_unref(GST_OBJECT(stream->m_pipeline));
+	}
+
+	stream->m_pipeline = NULL;
+}
+
+
+void SjGstreamerBackend::FlushPipelinePool()
+{
+	size_t i, iCnt = m_pipelinePool.GetCount();
+	for( i = 0; i < iCnt; i++ )
+	{
+		GstElement* pipeline = (GstElement*)m_pipelinePool.Item(i);
+		gst_element_set_state(pipeline, GST_STATE_NULL);
+		gst_object_unref(GST_OBJECT(pipeline));
+	}
+	m_pipelinePool.Clear();
+}
+
+
+SjBackendStream* SjGstreamerBackend::CreateStream__(const wxString& uri, long seekMs, SjBackendCallback* cb, SjBackendUserdata* userdata, bool preroll)
+{
+	SjGstreamerBackendStream* stream = new SjGstreamerBackendStream(uri, this, cb, userdata);
+	if( stream == NULL ) { return NULL; }
+
+	// reuse a pipeline from the pool or create a new one
+	stream->m_audioPipeline = m_iniAudioPipeline;
+	stream->m_pipeline = TakePipeline();
+	if( stream->m_pipeline == NULL ) {
+		stream->m_pipeline = CreatePipeline();
+		if( stream->m_pipeline == NULL ) {
+			delete stream;
+			return NULL; // error
 		}
-	gst_object_unref(pad);
+	}
+
+	// connect the pipeline to the stream
+	GstElement* decodebin = gst_bin_get_by_name(GST_BIN(stream->m_pipeline), "sjSource");
+	if( decodebin ) {
+		g_signal_connect(decodebin, "pad-added", G_CALLBACK(on_pad_added), stream /*userdata*/);
+		WXSTRING_TO_GST(uri);
+		g_object_set(G_OBJECT(decodebin), "uri", uriGstStr, NULL /*NULL marks end of list*/);
+		gst_object_unref(decodebin);
+	}
+
+	GstBus* bus = gst_pipeline_get_bus(GST_PIPELINE(stream->m_pipeline));
+		stream->m_bus_watch_id = gst_bus_add_watch(bus, on_bus_message, stream /*userdata*/);
+	gst_object_unref(bus);
+
+	GstElement* volume = gst_bin_get_by_name(GST_BIN(stream->m_pipeline), "sjVolume");
+	if( volume ) {
+		GstPad* pad = gst_element_get_static_pad(volume, "sink"); // sink/src is defined from the view of within the element: elements receive data on their sink pads and generate data on their source pads.
+			stream->m_probe_id = gst_pad_add_probe(pad,
+				(GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER),
+				on_pad_data, (gpointer)stream/*userdata*/, NULL);
+			if( stream->m_probe_id==0 ) {
+				wxLogError("GStreamer Error: Cannot add probe callback.");
+			}
+		gst_object_unref(pad);
+		gst_object_unref(volume);
+	}
 
 	// open stream
+	stream->m_prerolled = preroll;
+	stream->m_holding   = preroll;
 	stream->set_pipeline_state(GST_STATE_READY);
 
-		GstElement* source = gst_bin_get_by_name(GST_BIN(stream->m_pipeline), "sjSource");
-		if( source )
-		{
-			WXSTRING_TO_GST(uri);
-			g_object_set(G_OBJECT(source), "uri", uriGstStr, NULL /*NULL marks end of list*/);
-		}
+	if( preroll )
+	{
+		// go to PAUSED: the source is opened and the first buffer is decoded and held before the DSP;
+		// we do not wait for this as opening may take a while eg. on network shares, see OnStartPrerolled()
+		gst_element_set_state(stream->m_pipeline, GST_STATE_PAUSED);
+		return stream;
+	}
 
 	stream->set_pipeline_state(GST_STATE_PLAYING);
 
@@ -391,14 +552,15 @@ SjBackendStream* SjGstreamerBackend::CreateStream(const wxString& uri, long seek
 SjBackendState SjGstreamerBackend::GetDeviceState() const
 {
 	const wxArrayPtrVoid& allStreams = GetAllStreams();
-	size_t i, iCnt = allStreams.GetCount();
-	if( iCnt == 0 ) {
-		return SJBE_STATE_CLOSED;
-	}
-
+	size_t i, iCnt = allStreams.GetCount(), openedCnt = 0;
 	for( i = 0; i < iCnt; i++ )
 	{
 		SjGstreamerBackendStream* stream = (SjGstreamerBackendStream*)allStreams.Item(i);
+		if( stream->IsPrerolled() ) {
+			continue; // not yet started, the state may also be in change
+		}
+		openedCnt++;
+
 		GstState state;
 		if( gst_element_get_state(stream->m_pipeline, &state, NULL, 3000*MILLISEC_TO_NANOSEC_FACTOR /*wait max. 3 seconds*/) != GST_STATE_CHANGE_SUCCESS ) {
 			return SJBE_STATE_PLAYING; // we assume, a stream is coming very soon
@@ -408,14 +570,15 @@ SjBackendState SjGstreamerBackend::GetDeviceState() const
 		}
 	}
 
-	return SJBE_STATE_PAUSED;
+	return openedCnt? SJBE_STATE_PAUSED : SJBE_STATE_CLOSED;
 }
 
 
 void SjGstreamerBackend::SetDeviceState(SjBackendState state)
 {
 	if( state == SJBE_STATE_CLOSED ) {
-		return; // if there are no streams on the device, it is closed, nothing special to do here
+		FlushPipelinePool(); // if there are no streams on the device, it is closed, we only release the pooled pipelines
+		return;
 	}
 
 	const wxArrayPtrVoid& allStreams = GetAllStreams();
@@ -423,6 +586,9 @@ void SjGstreamerBackend::SetDeviceState(SjBackendState state)
 	for( i = 0; i < iCnt; i++ )
 	{
 		SjGstreamerBackendStream* stream = (SjGstreamerBackendStream*)allStreams.Item(i);
+		if( stream->IsPrerolled() ) {
+			continue; // stays paused until OnStartPrerolled()
+		}
 
 		stream->set_pipeline_state(state==SJBE_STATE_PLAYING? GST_STATE_PLAYING : GST_STATE_PAUSED);
 	}
@@ -471,13 +637,21 @@ void SjGstreamerBackendStream::SeekAbs(long seekMs)
 }
 
 
+void SjGstreamerBackendStream::OnStartPrerolled()
+{
+	// let the held buffer pass the DSP, the player has set up fading and equalizer just before;
+	// the pipeline completes PAUSED then. if the source is still opening, we wait as CreateStream() would do
+	release_hold(false);
+	set_pipeline_state(GST_STATE_PLAYING);
+}
+
+
 SjGstreamerBackendStream::~SjGstreamerBackendStream()
 {
-	set_pipeline_state(GST_STATE_NULL);
-	gst_object_unref(GST_OBJECT(m_pipeline));
-	m_pipeline = NULL;
-	g_source_remove(m_bus_watch_id);
-	m_bus_watch_id = 0;
+	release_hold(true); // otherwise, the streaming thread cannot be stopped
+	if( m_pipeline ) {
+		m_backend->ReleasePipeline(this);
+	}
 }
 
 
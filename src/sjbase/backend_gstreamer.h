@@ -41,17 +41,33 @@ class SjGstreamerBackend : public SjBackend
 {
 public:
 	                 SjGstreamerBackend  (SjBackendId);
-	                 ~SjGstreamerBackend () { SetDeviceState(SJBE_STATE_CLOSED); }
+	                 ~SjGstreamerBackend () { SetDeviceState(SJBE_STATE_CLOSED); /*this also flushes the pool*/ }
 	void             GetLittleOptions    (SjArrayLittleOption&);
 	SjBackendStream* CreateStream        (const wxString& url, long seekMs, SjBackendCallback*, SjBackendUserdata* userdata);
 	SjBackendState   GetDeviceState      () const;
 	void             SetDeviceState      (SjBackendState);
 	void             SetDeviceVol        (double gain);
+	bool             CanPreroll          () const { return true; }
+	SjBackendStream* PrerollStream       (const wxString& url, SjBackendCallback*, SjBackendUserdata* userdata);
 
 protected:
+	SjBackendStream* CreateStream__      (const wxString& url, long seekMs, SjBackendCallback*, SjBackendUserdata* userdata, bool preroll);
 	wxString         m_iniAudioPipeline;
 	wxString         m_iniVideoPipeline;
+
+	// pipelines of deleted streams are kept in READY state and reused for the next streams;
+	// this avoids building the pipeline and opening the audio device for every track.
+	#define          SJ_GST_DEF_PIPELINE_POOL 2L
+	long             m_iniPipelinePool;     // max. number of pooled pipelines, 0=no pooling
+	wxArrayPtrVoid   m_pipelinePool;        // GstElement* in READY state
+	wxString         m_poolAudioPipeline;   // m_iniAudioPipeline the pooled pipelines were created with
+	GstElement*      CreatePipeline      ();
+	GstElement*      TakePipeline        ();
+	void             ReleasePipeline     (SjGstreamerBackendStream*);
+	void             FlushPipelinePool   ();
+
 	friend void      on_pad_added        (GstElement*, GstPad*, gpointer);
+	friend class     SjGstreamerBackendStream;
 };
 
 
@@ -61,25 +77,45 @@ public:
 						~SjGstreamerBackendStream ();
     void                GetTime                   (long& totalMs, long& elapsedMs); // -1=unknown
     void                SeekAbs                   (long ms);
+    bool                HasErrors                 () const { return m_errorReceived; }
 
 protected:
+	void                OnStartPrerolled          ();
+
 	SjGstreamerBackendStream(const wxString& url, SjGstreamerBackend* backend, SjBackendCallback* cb, SjBackendUserdata* userdata)
-		: SjBackendStream(url, backend, cb, userdata)
+		: SjBackendStream(url, backend, cb, userdata), m_holdCond(m_holdMutex)
     {
 		m_backend      = backend;
 		m_pipeline     = NULL;
 		m_bus_watch_id = 0;
+		m_probe_id     = 0;
 		m_capsChecked  = false;
 		m_eosSend      = false;
+		m_errorReceived  = false;
+		m_videoSinkAdded = false;
+		m_holding      = false;
+		m_holdDrop     = false;
     }
 
 	GstElement*         m_pipeline;
+	wxString            m_audioPipeline;    // the m_iniAudioPipeline used for m_pipeline
 	guint               m_bus_watch_id;
+	gulong              m_probe_id;
+	bool                m_errorReceived;
+	bool                m_videoSinkAdded;
 	SjGstreamerBackend* m_backend;
 	bool                m_capsChecked;
 	bool                m_eosSend;
 	void                set_pipeline_state  (GstState s);
 
+	// prerolled streams hold the first buffer in on_pad_data() until they're started,
+	// so that the DSP callback sees the buffer with the fading and equalizer settings valid then
+	wxMutex             m_holdMutex;
+	wxCondition         m_holdCond;
+	bool                m_holding;          // protected by m_holdMutex
+	bool                m_holdDrop;         // set if the stream is deleted before it was started
+	void                release_hold        (bool drop);
+
 	friend class             SjGstreamerBackend;
 	friend void              on_pad_added  (GstElement*, GstPad*, gpointer);
 	friend GstPadProbeReturn on_pad_data   (GstPad*, GstPadProbeInfo*, gpointer);
@@ -85,7 +85,7 @@ void SjXineBackend::GetLittleOptions(SjArrayLittleOption& lo)
 	}
 
 	#define DEVICE_ININAME "xine/"+GetName()+"device"
-	#define DEVICE_DEFAULT "auto"
+	#define DEVICE_DEFAULT (GetId()==SJBE_ID_HEADLESS? "none" : "auto") // xine's "none" driver plays without device, however, in realtime
 	lo.Add(new SjLittleReplayEnum( _("Device"), options,
 						&m_iniDevice, DEVICE_DEFAULT, DEVICE_ININAME, SJ_ICON_MODULE));
 }
@@ -79,6 +79,7 @@
 #include <sjbase/compileoptions.h>
 #include <sjtools/sqlt.h>
 #include <sjtools/types.h>
+#include <sjtools/stallwatch.h>
 #include <sjbase/ids.h>
 #include <sjtools/normalise.h>
 #include <sjtools/dialog.h>
@@ -89,12 +90,14 @@
 #include <sjtools/ext_list.h>
 #include <sjtools/wavework.h>
 #include <sjbase/search.h>
+#include <sjbase/trackindex.h>
 #include <sjbase/playlist.h>
 #include <sjbase/skin.h>
 #include <sjtools/littleoption.h>
 #include <sjmodules/modulebase.h>
 #include <sjmodules/fx/eq_param.h>
 #include <sjmodules/fx/eq_preset_factory.h>
+#include <sjtools/dspprofiler.h>
 #include <sjbase/queue.h>
 #include <sjbase/player.h>
 #include <sjbase/mainapp.h>
@@ -0,0 +1,610 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2016 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    benchmark.cpp
+ * Authors: Björn Petersen
+ * Purpose: Timing the hot paths on a synthetic library
+ *
+ ******************************************************************************/
+
+
+#include <sjbase/base.h>
+#include <sjbase/benchmark.h>
+#include <sjtools/imgop.h>
+#include <sjtools/volumecalc.h>
+#include <sjtools/volumefade.h>
+#include <sjmodules/fx/eq_equalizer.h>
+#include <chrono>
+
+
+#define SJ_DEF_BENCH_TRACKS     10000L
+#define BENCH_TRACKS_PER_ALBUM  10
+#define BENCH_ALBUMS_PER_ARTIST 3
+#define BENCH_STUB_SECONDS      180     // the duration written to the FLAC and Ogg headers
+#define BENCH_SHUFFLE_STEPS     2000
+#define BENCH_DSP_SECONDS       60
+#define BENCH_IMAGE_COUNT       20
+#define BENCH_SEARCH_TIMEOUT_MS 60000
+
+
+static const wxChar* s_genres[] = { wxT("Rock"), wxT("Pop"), wxT("Jazz"), wxT("Blues"), wxT("Classical"), wxT("Electronic"), wxT("Folk"), wxT("Soul") };
+#define BENCH_GENRES (int)(sizeof(s_genres)/sizeof(s_genres[0]))
+
+
+SjBenchmark::SjBenchmark(const wxString& dir)
+{
+	wxFileName fn(dir, wxT(""));
+	fn.Normalize();
+	m_dir         = fn.GetPath(wxPATH_GET_VOLUME|wxPATH_GET_SEPARATOR);
+	m_musicDir    = m_dir + wxT("music");
+	m_trackCount  = g_tools->m_config->Read(wxT("bench/tracks"), SJ_DEF_BENCH_TRACKS);
+	m_stepStartMs = 0;
+}
+
+
+void SjBenchmark::Run()
+{
+	wxASSERT( wxThread::IsMain() );
+
+	// the benchmark adds its music folder and tracks to the jukebox, so we refuse to touch
+	// the jukebox of the user; silverjuke-bench uses a separate jukebox file in the directory
+	wxFileName dbFile(g_tools->m_dbFile);
+	dbFile.Normalize();
+	if( !dbFile.GetFullPath().StartsWith(m_dir) )
+	{
+		wxLogError(wxT("Benchmark: The jukebox file must be located in %s, use --jukebox or the silverjuke-bench script."), m_dir.c_str());
+		return;
+	}
+
+	wxLogInfo(wxT("Benchmark: %i tracks in %s"), (int)m_trackCount, m_dir.c_str());
+
+	if( GenerateLibrary() && BenchScan() )
+	{
+		BenchCombine();
+		BenchSimpleSearch(false);
+		BenchSimpleSearch(true);
+		BenchAdvSearch();
+		BenchColumns();
+		BenchShuffle();
+	}
+
+	BenchDsp();
+	BenchImages();
+
+	WriteResults();
+}
+
+
+double SjBenchmark::GetMs()
+{
+	// a monotonic clock, the wall clock may be adjusted while a step runs
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void SjBenchmark::EndStep(const wxString& name, long count)
+{
+	double ms = GetMs() - m_stepStartMs;
+	m_results.Add(wxString::Format(wxT("{\"name\":\"%s\",\"ms\":%.3f,\"count\":%i,\"perSecond\":%.1f}"),
+	                               name.c_str(), ms, (int)count, ms>0.0? (double)count*1000.0/ms : 0.0));
+	wxLogInfo(wxT("Benchmark: %s: %.1f ms for %i"), name.c_str(), ms, (int)count);
+}
+
+
+/*******************************************************************************
+ * Generating the synthetic library
+ ******************************************************************************/
+
+
+static void AddBE16(wxMemoryBuffer& b, uint32_t v) { b.AppendByte((char)(v>>8)); b.AppendByte((char)v); }
+static void AddBE24(wxMemoryBuffer& b, uint32_t v) { b.AppendByte((char)(v>>16)); AddBE16(b, v); }
+static void AddBE32(wxMemoryBuffer& b, uint32_t v) { AddBE16(b, v>>16); AddBE16(b, v); }
+static void AddLE32(wxMemoryBuffer& b, uint32_t v) { for( int i = 0; i < 4; i++ ) { b.AppendByte((char)(v>>(i*8))); } }
+static void AddLE64(wxMemoryBuffer& b, uint64_t v) { AddLE32(b, (uint32_t)v); AddLE32(b, (uint32_t)(v>>32)); }
+static void AddBytes(wxMemoryBuffer& b, const char* s, size_t len) { b.AppendData(s, len); }
+static void AddZeros(wxMemoryBuffer& b, size_t len) { while( len-- ) { b.AppendByte(0); } }
+
+
+class SjBenchmarkTrack
+{
+public:
+	wxString m_artist, m_album, m_title, m_genre;
+	long     m_year, m_trackNr;
+};
+
+
+static void AddId3Frame(wxMemoryBuffer& b, const char* id, const wxString& text)
+{
+	// ID3v2.3 text frame in ISO-8859-1
+	wxCharBuffer t = text.mb_str(wxConvISO8859_1);
+	size_t len = strlen(t.data());
+	AddBytes(b, id, 4);
+	AddBE32(b, len+1);
+	AddZeros(b, 3); // flags, encoding
+	AddBytes(b, t.data(), len);
+}
+
+
+static void CreateMp3(wxMemoryBuffer& b, const SjBenchmarkTrack& t)
+{
+	wxMemoryBuffer frames;
+	AddId3Frame(frames, "TPE1", t.m_artist);
+	AddId3Frame(frames, "TALB", t.m_album);
+	AddId3Frame(frames, "TIT2", t.m_title);
+	AddId3Frame(frames, "TCON", t.m_genre);
+	AddId3Frame(frames, "TYER", wxString::Format(wxT("%i"), (int)t.m_year));
+	AddId3Frame(frames, "TRCK", wxString::Format(wxT("%i"), (int)t.m_trackNr));
+
+	uint32_t size = frames.GetDataLen(); // syncsafe
+	AddBytes(b, "ID3\x03\x00\x00", 6);
+	b.AppendByte((char)((size>>21)&0x7F)); b.AppendByte((char)((size>>14)&0x7F));
+	b.AppendByte((char)((size>> 7)&0x7F)); b.AppendByte((char)( size     &0x7F));
+	b.AppendData(frames.GetData(), frames.GetDataLen());
+
+	// some silent frames, MPEG-1 Layer III, 128 kbit/s, 44.1 kHz, 417 bytes each
+	for( int i = 0; i < 4; i++ )
+	{
+		AddBytes(b, "\xFF\xFB\x90\x00", 4);
+		AddZeros(b, 413);
+	}
+}
+
+
+static void AddVorbisComments(wxMemoryBuffer& b, const SjBenchmarkTrack& t)
+{
+	wxArrayString c;
+	c.Add(wxT("ARTIST=") + t.m_artist);
+	c.Add(wxT("ALBUM=") + t.m_album);
+	c.Add(wxT("TITLE=") + t.m_title);
+	c.Add(wxT("GENRE=") + t.m_genre);
+	c.Add(wxString::Format(wxT("DATE=%i"), (int)t.m_year));
+	c.Add(wxString::Format(wxT("TRACKNUMBER=%i"), (int)t.m_trackNr));
+
+	static const char vendor[] = "Silverjuke benchmark";
+	AddLE32(b, strlen(vendor));
+	AddBytes(b, vendor, strlen(vendor));
+	AddLE32(b, c.GetCount());
+	for( size_t i = 0; i < c.GetCount(); i++ )
+	{
+		wxCharBuffer utf8 = c[i].mb_str(wxConvUTF8);
+		AddLE32(b, strlen(utf8.data()));
+		AddBytes(b, utf8.data(), strlen(utf8.data()));
+	}
+}
+
+
+static void CreateFlac(wxMemoryBuffer& b, const SjBenchmarkTrack& t)
+{
+	AddBytes(b, "fLaC", 4);
+
+	// STREAMINFO: block sizes, frame sizes, 44.1 kHz, 2 channels, 16 bit, samples, MD5
+	b.AppendByte(0x00);
+	AddBE24(b, 34);
+	AddBE16(b, 4096);
+	AddBE16(b, 4096);
+	AddBE24(b, 0);
+	AddBE24(b, 0);
+	uint64_t v = ((uint64_t)44100<<44) | ((uint64_t)(2-1)<<41) | ((uint64_t)(16-1)<<36) | (uint64_t)44100*BENCH_STUB_SECONDS;
+	AddBE32(b, (uint32_t)(v>>32));
+	AddBE32(b, (uint32_t)v);
+	AddZeros(b, 16);
+
+	// VORBIS_COMMENT, last metadata block
+	wxMemoryBuffer comments;
+	AddVorbisComments(comments, t);
+	b.AppendByte((char)0x84);
+	AddBE24(b, comments.GetDataLen());
+	b.AppendData(comments.GetData(), comments.GetDataLen());
+}
+
+
+static uint32_t OggCrc(const unsigned char* data, size_t len)
+{
+	static uint32_t s_table[256];
+	static bool     s_tableInitialized = false;
+	if( !s_tableInitialized )
+	{
+		for( uint32_t i = 0; i < 256; i++ )
+		{
+			uint32_t r = i << 24;
+			for( int j = 0; j < 8; j++ ) {
+				r = (r & 0x80000000UL)? ((r << 1) ^ 0x04C11DB7UL) : (r << 1);
+			}
+			s_table[i] = r;
+		}
+		s_tableInitialized = true;
+	}
+
+	uint32_t crc = 0;
+	for( size_t i = 0; i < len; i++ ) {
+		crc = (crc << 8) ^ s_table[((crc >> 24) & 0xFF) ^ data[i]];
+	}
+	return crc;
+}
+
+
+static void AddOggPage(wxMemoryBuffer& b, int headerType, uint64_t granule, uint32_t seq,
+                       const wxMemoryBuffer& packet1, const wxMemoryBuffer* packet2 = NULL)
+{
+	wxMemoryBuffer lacing;
+	const wxMemoryBuffer* packets[2] = { &packet1, packet2 };
+	for( int p = 0; p < 2 && packets[p]; p++ )
+	{
+		size_t len = packets[p]->GetDataLen();
+		for( ; len >= 255; len -= 255 ) {
+			lacing.AppendByte((char)255);
+		}
+		lacing.AppendByte((char)len);
+	}
+
+	wxMemoryBuffer page;
+	AddBytes(page, "OggS", 4);
+	page.AppendByte(0);
+	page.AppendByte((char)headerType);
+	AddLE64(page, granule);
+	AddLE32(page, 0x536A);  // serial number
+	AddLE32(page, seq);
+	AddLE32(page, 0);       // CRC, set below
+	page.AppendByte((char)lacing.GetDataLen());
+	page.AppendData(lacing.GetData(), lacing.GetDataLen());
+	for( int p = 0; p < 2 && packets[p]; p++ ) {
+		page.AppendData(packets[p]->GetData(), packets[p]->GetDataLen());
+	}
+
+	unsigned char* data = (unsigned char*)page.GetData();
+	uint32_t crc = OggCrc(data, page.GetDataLen());
+	for( int i = 0; i < 4; i++ ) {
+		data[22+i] = (unsigned char)(crc>>(i*8));
+	}
+
+	b.AppendData(page.GetData(), page.GetDataLen());
+}
+
+
+static void CreateOgg(wxMemoryBuffer& b, const SjBenchmarkTrack& t)
+{
+	// identification header: version, 2 channels, 44.1 kHz, bitrates, block sizes, framing
+	wxMemoryBuffer ident;
+	AddBytes(ident, "\x01vorbis", 7);
+	AddLE32(ident, 0);
+	ident.AppendByte(2);
+	AddLE32(ident, 44100);
+	AddLE32(ident, 0);
+	AddLE32(ident, 128000);
+	AddLE32(ident, 0);
+	ident.AppendByte((char)0xB8);
+	ident.AppendByte(1);
+
+	wxMemoryBuffer comment;
+	AddBytes(comment, "\x03vorbis", 7);
+	AddVorbisComments(comment, t);
+	comment.AppendByte(1);
+
+	// the setup header is not needed for reading the tags; we just add an empty one
+	wxMemoryBuffer setup;
+	AddBytes(setup, "\x05vorbis", 7);
+	AddZeros(setup, 8);
+
+	wxMemoryBuffer audio;
+	AddZeros(audio, 1);
+
+	AddOggPage(b, 0x02/*BOS*/, 0, 0, ident);
+	AddOggPage(b, 0x00, 0, 1, comment, &setup);
+	AddOggPage(b, 0x04/*EOS*/, (uint64_t)44100*BENCH_STUB_SECONDS, 2, audio);
+}
+
+
+bool SjBenchmark::GenerateLibrary()
+{
+	StartStep();
+
+	long trackIndex;
+	for( trackIndex = 0; trackIndex < m_trackCount; trackIndex++ )
+	{
+		long albumIndex  = trackIndex / BENCH_TRACKS_PER_ALBUM;
+		long artistIndex = albumIndex / BENCH_ALBUMS_PER_ARTIST;
+
+		SjBenchmarkTrack t;
+		t.m_artist  = wxString::Format(wxT("Artist %i"), (int)artistIndex);
+		t.m_album   = wxString::Format(wxT("Album %i"), (int)albumIndex);
+		t.m_title   = wxString::Format(wxT("Title %i"), (int)trackIndex);
+		t.m_genre   = s_genres[artistIndex % BENCH_GENRES];
+		t.m_year    = 1960 + (albumIndex % 60);
+		t.m_trackNr = (trackIndex % BENCH_TRACKS_PER_ALBUM) + 1;
+
+		// one format per album
+		wxMemoryBuffer content;
+		wxString ext;
+		switch( albumIndex % 3 )
+		{
+			case 0:  CreateMp3 (content, t); ext = wxT("mp3");  break;
+			case 1:  CreateOgg (content, t); ext = wxT("ogg");  break;
+			default: CreateFlac(content, t); ext = wxT("flac"); break;
+		}
+
+		wxFileName fn(m_musicDir, wxString::Format(wxT("%02i %s.%s"), (int)t.m_trackNr, t.m_title.c_str(), ext.c_str()));
+		fn.AppendDir(t.m_artist);
+		fn.AppendDir(t.m_album);
+		if( !fn.DirExists() && !fn.Mkdir(0777, wxPATH_MKDIR_FULL) )
+		{
+			wxLogError(_("Cannot write \"%s\"."), fn.GetPath().c_str());
+			return false;
+		}
+
+		// existing files are kept, so that a repeated benchmark in the same directory
+		// does not need to create them again; the jukebox file is created anew by
+		// silverjuke-bench, so the scan is always a full scan
+		if( !fn.FileExists() )
+		{
+			wxFile file;
+			if( !file.Create(fn.GetFullPath(), true) || file.Write(content.GetData(), content.GetDataLen()) != content.GetDataLen() )
+			{
+				wxLogError(_("Cannot write \"%s\"."), fn.GetFullPath().c_str());
+				return false;
+			}
+		}
+	}
+
+	EndStep(wxT("generate"), trackIndex);
+	return true;
+}
+
+
+/*******************************************************************************
+ * Library steps
+ ******************************************************************************/
+
+
+bool SjBenchmark::BenchScan()
+{
+	SjScannerModule* folderScanner = (SjScannerModule*)g_mainFrame->m_moduleSystem.FindModuleByFile(wxT("memory:folderscanner.lib"));
+	if( folderScanner == NULL )
+	{
+		return false;
+	}
+	folderScanner->AddUrl(m_musicDir);
+
+	StartStep();
+	g_mainFrame->UpdateIndex(g_mainFrame, true/*deepUpdate*/);
+	EndStep(wxT("scan"), g_mainFrame->m_libraryModule->GetUnmaskedTrackCount());
+	return true;
+}
+
+
+void SjBenchmark::BenchCombine()
+{
+	StartStep();
+	g_mainFrame->m_libraryModule->CombineTracksToAlbums();
+	EndStep(wxT("combine"), g_mainFrame->m_libraryModule->GetUnmaskedColCount());
+
+	g_mainFrame->m_browser->ReloadColumnMixer();
+}
+
+
+void SjBenchmark::BenchSimpleSearch(bool async)
+{
+	// "simplesearch" measures the synchronous search in the main thread as used eg. by
+	// the search button, "simplesearchasync" the search thread as used while typing,
+	// including the time until the results are applied on IDO_SEARCHDONE
+	static const wxChar* words[] = { wxT("artist 1"), wxT("album 2"), wxT("title 33"), wxT("rock"), wxT("19"), wxT("notfound") };
+	long count = 0, results = 0;
+
+	StartStep();
+	for( int round = 0; round < 5; round++ )
+	{
+		for( int i = 0; i < (int)(sizeof(words)/sizeof(words[0])); i++ )
+		{
+			g_mainFrame->SetSearch(SJ_SETSEARCH_SETSIMPLE|SJ_SETSEARCH_NOAUTOHISTORYADD|(async? SJ_SETSEARCH_ASYNC : 0), words[i]);
+			if( async )
+			{
+				double timeoutMs = GetMs() + BENCH_SEARCH_TIMEOUT_MS;
+				while( g_mainFrame->IsSearchPending() && GetMs() < timeoutMs )
+				{
+					wxTheApp->Yield(true);
+					wxMilliSleep(1);
+				}
+			}
+			results += g_mainFrame->GetSearchStat()->m_totalResultCount;
+			g_mainFrame->SetSearch(SJ_SETSEARCH_CLEARSIMPLE|SJ_SETSEARCH_NOAUTOHISTORYADD);
+			count++;
+		}
+	}
+	EndStep(async? wxT("simplesearchasync") : wxT("simplesearch"), count);
+}
+
+
+void SjBenchmark::BenchAdvSearch()
+{
+	SjAdvSearch byYear;
+	byYear.Init(wxT("Benchmark by year"));
+	byYear.AddRule(SJ_FIELD_YEAR, SJ_FIELDOP_IS_IN_RANGE, wxT("1970"), wxT("1979"));
+
+	SjAdvSearch byGenre;
+	byGenre.Init(wxT("Benchmark by genre"));
+	byGenre.AddRule(SJ_FIELD_GENRENAME, SJ_FIELDOP_IS_EQUAL_TO, s_genres[0]);
+
+	long count = 0;
+	StartStep();
+	for( int round = 0; round < 5; round++ )
+	{
+		g_mainFrame->SetSearch(SJ_SETSEARCH_SETADV|SJ_SETSEARCH_NOAUTOHISTORYADD, wxT(""), &byYear);
+		g_mainFrame->SetSearch(SJ_SETSEARCH_SETADV|SJ_SETSEARCH_NOAUTOHISTORYADD, wxT(""), &byGenre);
+		count += 2;
+	}
+	g_mainFrame->SetSearch(SJ_SETSEARCH_CLEARADV|SJ_SETSEARCH_NOAUTOHISTORYADD);
+	EndStep(wxT("advsearch"), count);
+}
+
+
+void SjBenchmark::BenchColumns()
+{
+	SjLibraryModule* library = g_mainFrame->m_libraryModule;
+	long colCount = library->GetUnmaskedColCount();
+
+	StartStep();
+	for( long i = 0; i < colCount; i++ )
+	{
+		SjCol* col = library->GetUnmaskedCol(i);
+		if( col ) {
+			delete col;
+		}
+	}
+	EndStep(wxT("columns"), colCount);
+}
+
+
+void SjBenchmark::BenchShuffle()
+{
+	wxArrayString urls;
+	{
+		wxSqlt sql;
+		sql.Query(wxT("SELECT url FROM tracks;"));
+		while( sql.Next() ) {
+			urls.Add(sql.GetString(0));
+		}
+	}
+	if( urls.IsEmpty() ) {
+		return;
+	}
+
+	// we use a separate queue, the player is not touched
+	SjQueue queue;
+	queue.Init();
+
+	StartStep();
+	queue.Enqueue(urls, -1, true/*verified*/, NULL, 0);
+	EndStep(wxT("enqueue"), urls.GetCount());
+
+	queue.SetShuffle(true);
+	queue.SetCurrPos(0);
+
+	long steps = 0;
+	StartStep();
+	while( steps < BENCH_SHUFFLE_STEPS )
+	{
+		long pos = queue.GetNextPos(0);
+		if( pos < 0 ) {
+			break;
+		}
+		queue.SetCurrPos(pos);
+		steps++;
+	}
+	EndStep(wxT("shuffle"), steps);
+}
+
+
+/*******************************************************************************
+ * Other steps
+ ******************************************************************************/
+
+
+void SjBenchmark::BenchDsp()
+{
+	// the chain as used in SjPlayer_BackendCallback(), with all stages active; count is in seconds of audio
+	#define DSP_SAMPLERATE  44100
+	#define DSP_CHANNELS    2
+	#define DSP_FLOATS      4096
+	float* source = new float[DSP_FLOATS];
+	float* buffer = new float[DSP_FLOATS];
+	for( int i = 0; i < DSP_FLOATS; i++ ) {
+		source[i] = (float)((i/DSP_CHANNELS)%100) / 100.0F - 0.5F; // a sawtooth of 441 Hz
+	}
+
+	SjVolumeCalc volumeCalc;
+	SjEqualizer  equalizer;
+	SjVolumeFade volumeFade;
+
+	SjEqParam eqParam;
+	for( int b = 0; b < SJ_EQ_BANDS; b++ ) {
+		eqParam.m_bandDb[b] = (b%2)? 6.0F : -6.0F;
+	}
+	equalizer.SetParam(true, eqParam);
+	volumeFade.SetVolume(1.0F);
+	volumeFade.SlideVolume(0.0F, BENCH_DSP_SECONDS*1000);
+
+	long chunks = (long)BENCH_DSP_SECONDS * DSP_SAMPLERATE * DSP_CHANNELS / DSP_FLOATS;
+	long bytes = DSP_FLOATS * sizeof(float);
+
+	StartStep();
+	for( long c = 0; c < chunks; c++ )
+	{
+		memcpy(buffer, source, bytes);
+		volumeCalc.AddBuffer(buffer, bytes, DSP_SAMPLERATE, DSP_CHANNELS);
+		volumeCalc.AdjustBuffer(buffer, bytes, SJ_AV_DEF_DESIRED_VOLUME, SJ_AV_DEF_MAX_GAIN);
+		equalizer.AdjustBuffer(buffer, bytes, DSP_SAMPLERATE, DSP_CHANNELS);
+		volumeFade.AdjustBuffer(buffer, bytes, DSP_SAMPLERATE, DSP_CHANNELS);
+		SjApplyVolume(buffer, bytes, 0.8F);
+	}
+	EndStep(wxT("dsp"), BENCH_DSP_SECONDS);
+
+	delete [] source;
+	delete [] buffer;
+}
+
+
+void SjBenchmark::BenchImages()
+{
+	// a typical cover scaled down to the size of the album view
+	wxImage image(1024, 1024);
+	unsigned char* data = image.GetData();
+	for( int y = 0; y < 1024; y++ )
+	{
+		for( int x = 0; x < 1024; x++, data += 3 )
+		{
+			data[0] = (unsigned char)x;
+			data[1] = (unsigned char)y;
+			data[2] = (unsigned char)(x^y);
+		}
+	}
+
+	StartStep();
+	for( int i = 0; i < BENCH_IMAGE_COUNT; i++ )
+	{
+		wxImage copy = image.Copy();
+		SjImgOp::DoResize(copy, 200, 200, SJ_IMGOP_SMOOTH);
+	}
+	EndStep(wxT("imagescale"), BENCH_IMAGE_COUNT);
+}
+
+
+bool SjBenchmark::WriteResults()
+{
+	wxString content = wxString::Format(wxT("{\n\"version\":\"%i.%i.%i\",\n\"date\":\"%s\",\n\"tracks\":%i,\n\"results\":[\n"),
+	                                    SJ_VERSION_MAJOR, SJ_VERSION_MINOR, SJ_VERSION_REVISION,
+	                                    wxDateTime::Now().FormatISOCombined().c_str(), (int)m_trackCount);
+	for( size_t i = 0; i < m_results.GetCount(); i++ )
+	{
+		content += m_results[i];
+		content += (i < m_results.GetCount()-1)? wxT(",\n") : wxT("\n");
+	}
+	content += wxT("]\n}\n");
+
+	wxString fileName = m_dir + wxT("bench.json");
+	wxFile file;
+	if( !file.Create(fileName, true/*overwrite*/) || !file.Write(content, wxConvUTF8) )
+	{
+		wxLogError(_("Cannot write \"%s\"."), fileName.c_str());
+		return false;
+	}
+
+	wxLogInfo(wxT("Benchmark: results written to %s"), fileName.c_str());
+	return true;
+}
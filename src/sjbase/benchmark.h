@@ -0,0 +1,75 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2016 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    benchmark.h
+ * Authors: Björn Petersen
+ * Purpose: Timing the hot paths on a synthetic library
+ *
+ ******************************************************************************/
+
+
+#ifndef __SJ_BENCHMARK_H__
+#define __SJ_BENCHMARK_H__
+
+
+// SjBenchmark is started by the command line option --bench=DIR, normally
+// through the silverjuke-bench script which also uses a separate
+// configuration and jukebox file in DIR.  The benchmark is not run if the
+// jukebox file is not located in DIR.
+//
+// The benchmark creates a synthetic library of tagged MP3, Ogg Vorbis and
+// FLAC stubs in DIR/music, times some hot paths (scanning, combining albums,
+// searching, creating columns, shuffling, the DSP chain and image scaling) and
+// writes the results as JSON to DIR/bench.json.  The number of tracks is
+// read from bench/tracks.
+class SjBenchmark
+{
+public:
+	                SjBenchmark         (const wxString& dir);
+	void            Run                 ();
+
+private:
+	wxString        m_dir;
+	wxString        m_musicDir;
+	long            m_trackCount;
+	wxArrayString   m_results;
+	double          m_stepStartMs;
+
+	// timing, each result is a JSON object
+	static double   GetMs               ();
+	void            StartStep           () { m_stepStartMs = GetMs(); }
+	void            EndStep             (const wxString& name, long count);
+
+	// the steps
+	bool            GenerateLibrary     ();
+	bool            BenchScan           ();
+	void            BenchCombine        ();
+	void            BenchSimpleSearch   (bool async);
+	void            BenchAdvSearch      ();
+	void            BenchColumns        ();
+	void            BenchShuffle        ();
+	void            BenchDsp            ();
+	void            BenchImages         ();
+	bool            WriteResults        ();
+};
+
+
+#endif // __SJ_BENCHMARK_H__
@@ -179,6 +179,8 @@ long SjColumnMixer::DelInsSelection(bool delPressed)
 
 SjSearchStat SjColumnMixer::SetSearch(const SjSearch& search, bool deepSearch)
 {
+	SJ_STALL_SCOPE("SjColumnMixer::SetSearch");
+
 	// we're assuming, the search has really changed -- the caller
 	// (currently only SjMainFrame::PerformSearch() should check this
 
@@ -198,6 +200,39 @@ SjSearchStat SjColumnMixer::SetSearch(const SjSearch& search, bool deepSearch)
 }
 
 
+
+bool SjColumnMixer::StartSearch(const SjSearch& search)
+{
+	// only the library can search in a thread; if there are other modules,
+	// the caller should use SetSearch() as all modules must change together
+	if( m_moduleCount != 1 || m_modules[0] != m_libraryModule )
+	{
+		return FALSE;
+	}
+
+	return ((SjLibraryModule*)m_libraryModule)->StartSearch(search);
+}
+
+
+bool SjColumnMixer::FinishSearch(SjSearchStat& retStat)
+{
+	if( m_moduleCount != 1 || m_modules[0] != m_libraryModule
+	 || !((SjLibraryModule*)m_libraryModule)->FinishSearch(retStat) )
+	{
+		return FALSE; // the search is superseded or the modules have changed
+	}
+
+	SetColCount__();
+
+	return TRUE;
+}
+
+
+bool SjColumnMixer::IsSearchPending() const
+{
+	return m_libraryModule && ((SjLibraryModule*)m_libraryModule)->IsSearchPending();
+}
+
 void SjColumnMixer::SetColCount__()
 {
 	m_maskedColCount = 0;
@@ -58,6 +58,9 @@ public:
 
 	// search handling
 	SjSearchStat    SetSearch           (const SjSearch&, bool deepSearch);
+	bool            StartSearch         (const SjSearch&); // if TRUE is returned, call FinishSearch() on IDO_SEARCHDONE
+	bool            FinishSearch        (SjSearchStat&);
+	bool            IsSearchPending     () const;
 	static wxString GetAzDescr          (int targetIdOrChar);
 
 	// column- and cover-view handling, a retrieved SjCol object that is no longer needed should be deleted
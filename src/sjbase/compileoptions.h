@@ -81,6 +81,18 @@
 #define SJ_DEF_SQLITE_CACHE_BYTES 0x100000L
 #endif
 
+#ifndef SJ_DEF_SQLITE_WAL
+#define SJ_DEF_SQLITE_WAL 1L        // 1=write-ahead log, readers in other threads are not blocked by writing
+#endif
+
+#ifndef SJ_DEF_SQLITE_MMAP_BYTES
+#define SJ_DEF_SQLITE_MMAP_BYTES 0x4000000L
+#endif
+
+#ifndef SJ_DEF_SQLITE_READERS
+#define SJ_DEF_SQLITE_READERS 4L    // max. number of read-only connections for other threads
+#endif
+
 #ifndef SJ_DEF_IMGTHREAD_CACHE_BYTES
 #define SJ_DEF_IMGTHREAD_CACHE_BYTES 0x800000L
 #endif
@@ -320,6 +320,7 @@ bool SjMainApp::OnInit()
 		// environment settings
 		{ wxCMD_LINE_SWITCH, NULL, wxT_2("skiperrors"),  wxT_2("Do not show startup errors") },
 		{ wxCMD_LINE_SWITCH, NULL, wxT_2("minimize"),    wxT_2("Start minimized") },
+		{ wxCMD_LINE_SWITCH, NULL, wxT_2("headless"),    wxT_2("Play without audio device as fast as possible") },
 		{ wxCMD_LINE_OPTION, NULL, wxT_2("kioskrect"),   wxT_2("Where to show the kiosk: DISPLAY|X,Y,W,H[,clipmouse]") },
 		{ wxCMD_LINE_OPTION, NULL, wxT_2("visrect"),     wxT_2("Where to show the video screen: DISPLAY|X,Y,W,H") },
 		{ wxCMD_LINE_OPTION, NULL, wxT_2("blackrect"),   wxT_2("Add black areas: DISPLAY|X,Y,W,H[;DISPLAY,X,Y,W,H;...]") },
@@ -327,6 +328,7 @@ bool SjMainApp::OnInit()
 		{ wxCMD_LINE_OPTION, NULL, wxT_2("ini"),         wxT_2("Set the configuration file to use") },
 		{ wxCMD_LINE_OPTION, NULL, wxT_2("jukebox"),     wxT_2("Set the jukebox file to use") },
 		{ wxCMD_LINE_OPTION, NULL, wxT_2("temp"),        wxT_2("Set the temporary directory to use") },
+		{ wxCMD_LINE_OPTION, NULL, wxT_2("bench"),       wxT_2("Create a synthetic library in the given directory, run the benchmark and exit") },
 		// addional parameters
 		{ wxCMD_LINE_PARAM,  NULL, NULL,                 wxT_2("File(s)"),  wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL|wxCMD_LINE_PARAM_MULTIPLE },
 		{ wxCMD_LINE_NONE }
@@ -345,6 +347,10 @@ bool SjMainApp::OnInit()
 	// create tools to use, the tools are deleted if SjMainFrame is deleted
 	g_tools = new SjTools;
 
+	// watch the main thread for stalls, if desired
+	SjStallWatch::Init(g_tools->m_config->Read(wxT("main/stallWatchdog"), 0L),
+	                   wxFileName(SjTools::GetUserAppDataDir(), wxT("stalltrace.json")).GetFullPath());
+
 	// create the server name
 	wxString serviceName;
 	#ifndef __WXMSW__
@@ -472,6 +478,13 @@ bool SjMainApp::OnInit()
 }
 
 
+void SjMainApp::HandleEvent(wxEvtHandler* handler, wxEventFunction func, wxEvent& event) const
+{
+	SjStallScope scope(event);
+	wxApp::HandleEvent(handler, func, event);
+}
+
+
 void SjMainApp::SetIsInShutdown()
 {
 	s_isInShutdown = TRUE;
@@ -512,6 +525,10 @@ int SjMainApp::OnExit()
 		s_cmdLine = NULL;
 	}
 
+	/* stop the stall watchdog and write the trace
+	 */
+	SjStallWatch::Exit();
+
 	/* remove our error logger
 	*/
 	delete s_logGui;
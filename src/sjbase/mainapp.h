@@ -56,6 +56,9 @@ public:
 	static void     DoShutdownEtc       (SjShutdownEtc, long restoreOrgVol=-1);
 	static wxCmdLineParser* s_cmdLine;
 
+	// all event handlers go through this function, used by SjStallWatch
+	void            HandleEvent         (wxEvtHandler*, wxEventFunction, wxEvent&) const;
+
 private:
 	static bool     s_isInShutdown;
 	void            OnActivate          (wxActivateEvent&);
@@ -28,6 +28,7 @@
 
 #include <sjbase/base.h>
 #include <sjbase/browser.h>
+#include <sjbase/benchmark.h>
 #include <sjtools/imgthread.h>
 #include <sjtools/testdrive.h>
 #include <sjtools/console.h>
@@ -282,6 +283,8 @@ void SjMainFrame::SetAbsMainVol(long v)
 
 bool SjMainFrame::UpdateIndex(wxWindow* parent, bool deepUpdate)
 {
+	SJ_STALL_SCOPE("SjMainFrame::UpdateIndex");
+
 	bool ret = TRUE;
 	static bool inUpdate = FALSE;
 
@@ -1052,6 +1055,11 @@ SjMainFrame::SjMainFrame(SjMainApp* mainApp, int id, long skinFlags, const wxPoi
 	SetWorkspaceWindow(m_browser);
 
 	m_inPerformingSearch = FALSE;
+	m_asyncSearchDoneDeferred = FALSE;
+	m_asyncSearchFlags = 0;
+	m_asyncSearchColumnGuidViewOffset = 0;
+	m_asyncSearchGatherStatistics = FALSE;
+	m_asyncSearchStartTime = 0;
 
 	m_simpleSearchInputFromUser = FALSE;
 
@@ -1335,6 +1343,13 @@ SjMainFrame::SjMainFrame(SjMainApp* mainApp, int id, long skinFlags, const wxPoi
 		g_mainFrame->GetEventHandler()->QueueEvent(new wxCommandEvent(wxEVT_COMMAND_MENU_SELECTED, IDT_UPDATE_INDEX));
 	}
 
+	/* run the benchmark? (this exits Silverjuke when done)
+	 */
+	if( SjMainApp::s_cmdLine->Found(wxT("bench")) )
+	{
+		g_mainFrame->GetEventHandler()->QueueEvent(new wxCommandEvent(wxEVT_COMMAND_MENU_SELECTED, IDO_BENCHMARK));
+	}
+
 	/* start the timer - this should be VERY last as the timer
 	 * is used eg. to start a playback
 	 */
@@ -1473,6 +1488,8 @@ BEGIN_EVENT_TABLE(SjMainFrame, SjSkinWindow)
 	EVT_MENU_RANGE  (IDO_SCRIPT_MENU00, IDO_SCRIPT_MENU99,      SjMainFrame::OnFwdToSkin     )
 	EVT_MENU_RANGE  (IDO_SCRIPTCONFIG_MENU00, IDO_SCRIPTCONFIG_MENU99, SjMainFrame::OnFwdToSkin )
 	EVT_MENU        (IDO_CONSOLE,                               SjMainFrame::OnFwdToSkin     )
+	EVT_MENU        (IDO_BENCHMARK,                             SjMainFrame::OnFwdToSkin     )
+	EVT_MENU        (IDO_SEARCHDONE,                            SjMainFrame::OnFwdToSkin     )
 	EVT_MENU_RANGE  (IDM_FIRST, IDM_LAST,                       SjMainFrame::OnFwdToSkin     )
 	EVT_MENU        (IDO_BROWSER_RELOAD_VIEW,                   SjMainFrame::OnFwdToSkin     )
 	EVT_MENU        (IDO_DEBUGSKIN_RELOAD,                      SjMainFrame::OnFwdToSkin     )
@@ -1796,6 +1813,37 @@ void SjMainFrame::OnSkinTargetEvent(int targetId, SjSkinValue& value, long accel
 				SjLogGui::OpenManually();
 				break;
 
+			case IDO_SEARCHDONE:
+				if( m_inPerformingSearch )
+				{
+					m_asyncSearchDoneDeferred = TRUE; // handled at the end of SetSearch()
+				}
+				else
+				{
+					SjSearchStat stat;
+					if( m_columnMixer.FinishSearch(stat) )
+					{
+						m_inPerformingSearch = TRUE;
+						SetSearchDone(m_asyncSearchFlags, stat,
+						              m_asyncSearchColumnGuid, m_asyncSearchColumnGuidViewOffset,
+						              m_asyncSearchGatherStatistics, m_asyncSearchStartTime);
+						m_inPerformingSearch = FALSE;
+					}
+				}
+				break;
+
+			case IDO_BENCHMARK:
+				{
+					wxString benchDir;
+					if( SjMainApp::s_cmdLine->Found(wxT("bench"), &benchDir) )
+					{
+						SjBenchmark benchmark(benchDir);
+						benchmark.Run();
+					}
+					SjMainApp::DoShutdownEtc(SJ_SHUTDOWN_EXIT_SILVERJUKE);
+				}
+				break;
+
 			case IDT_TOGGLE_KIOSK:
 				g_kioskModule->ToggleRequest(SJ_KIOSKF_EXIT_KEY);
 				break;
@@ -2834,7 +2882,7 @@ void SjMainFrame::OnSimpleSearchInput(wxCommandEvent& event)
 			{
 				// undelayed search
 				SetSearch(SJ_SETSEARCH_SETSIMPLE|
-				          SJ_SETSEARCH_NOTEXTCTRLUPDATE, text);
+				          SJ_SETSEARCH_NOTEXTCTRLUPDATE|SJ_SETSEARCH_ASYNC, text);
 			}
 
 			inSearchInput = FALSE;
@@ -2844,7 +2892,7 @@ void SjMainFrame::OnSimpleSearchInput(wxCommandEvent& event)
 void SjMainFrame::OnSimpleSearchInputTimer(wxTimerEvent& event)
 {
 	SetSearch(SJ_SETSEARCH_SETSIMPLE|
-	          SJ_SETSEARCH_NOTEXTCTRLUPDATE|SJ_SETSEARCH_NOAUTOHISTORYADD, m_simpleSearchDelayedText);
+	          SJ_SETSEARCH_NOTEXTCTRLUPDATE|SJ_SETSEARCH_NOAUTOHISTORYADD|SJ_SETSEARCH_ASYNC, m_simpleSearchDelayedText);
 }
 
 
@@ -2888,6 +2936,8 @@ void SjMainFrame::UpdateSearchInfo(long numTracksRemoved)
 
 void SjMainFrame::SetSearch(long flags, const wxString& newSimpleSearch, const SjAdvSearch* newAdvSearch)
 {
+	SJ_STALL_SCOPE("SjMainFrame::SetSearch");
+
 	// This function may only be called from the main thread.
 	wxASSERT( wxThread::IsMain() );
 
@@ -2989,6 +3039,11 @@ void SjMainFrame::SetSearch(long flags, const wxString& newSimpleSearch, const S
 			// show hourglass if previous searches take a long time or
 			// if this is one of the first two searches (which will take
 			// longer; btw m_allSearchCount starts with 1)
+			if( flags&SJ_SETSEARCH_ASYNC )
+			{
+				useHourglass = FALSE; // the search is probably done in a thread, see below
+			}
+
 			if( useHourglass )
 			{
 				::wxBeginBusyCursor();
@@ -3019,65 +3074,22 @@ void SjMainFrame::SetSearch(long flags, const wxString& newSimpleSearch, const S
 				columnGuid = m_browser->GetFirstSelectedOrVisiblePos(columnGuidViewOffset);
 			}
 
-			// do the search
-			{
-				SjSearchStat stat = m_columnMixer.SetSearch(m_search, deepSearch);
-				m_searchStat.m_totalResultCount = stat.m_totalResultCount;
-				if( flags&(SJ_SETSEARCH_SETADV|SJ_SETSEARCH_CLEARADV) )
-				{
-					m_searchStat.m_advResultCount = stat.m_advResultCount;
-					m_searchStat.m_mbytes = stat.m_mbytes;
-					m_searchStat.m_seconds = stat.m_seconds;
-				}
-			}
-
-			// set skin values (should be done before updating the browser
-			// as the browser uses the text from the search information)
-			SjSkinValue v;
-			v.value = m_search.IsSet()? 1 : 0;
-			SetSkinTargetValue(IDT_SEARCH_BUTTON, v);
-			UpdateSearchInfo(0);
-
-			// update the browser
-			m_browser->ReloadColumnMixer(false);
-			if(  !m_search.m_simple.IsSet()
-			 && (!columnGuid.IsEmpty() || !m_searchLastColumnGuid.IsEmpty())  )
-			{
-				if( !columnGuid.IsEmpty() )
-				{
-					m_browser->GotoPos(columnGuid, columnGuidViewOffset);
-				}
-				else
-				{
-					m_browser->GotoPos(m_searchLastColumnGuid, m_searchLastColumnGuidViewOffset);
-				}
-			}
-
-			GotDisplayInputFromUser();
-
-			// remember the row to use after an unsuccessful search or after ending the search
-			if( !m_search.IsSet() || m_searchStat.m_totalResultCount )
+			// do the search; if possible, simple searches typed by the user are done in the
+			// search thread of the library and the browser is updated on IDO_SEARCHDONE
+			if( (flags&SJ_SETSEARCH_ASYNC) && !deepSearch && m_columnMixer.StartSearch(m_search) )
 			{
-				m_searchLastColumnGuidViewOffset = 0;
-				m_searchLastColumnGuid = m_browser->GetFirstSelectedOrVisiblePos(m_searchLastColumnGuidViewOffset);
+				m_asyncSearchFlags                  = flags;
+				m_asyncSearchColumnGuid             = columnGuid;
+				m_asyncSearchColumnGuidViewOffset   = columnGuidViewOffset;
+				m_asyncSearchGatherStatistics       = gatherStatistics;
+				m_asyncSearchStartTime              = thisSearchTime;
 			}
-
-			// gather statistics for finding out the search delay
-			thisSearchTime = SjTools::GetMsTicks() - thisSearchTime;
-			wxLogDebug(wxT("%i ms needed for the query"), (int)thisSearchTime);
-			if( gatherStatistics )
+			else
 			{
-				m_allSearchCount++;
-				m_allSearchMs += m_allSearchCount>3? thisSearchTime : SJ_SEARCH_DELAY_MS;
-				// use default values for the first two
-				// searches as the real times are not
-				// representive as nothing is cached yet
-				// (m_allSearchCount starts with "1")
+				SjSearchStat stat = m_columnMixer.SetSearch(m_search, deepSearch);
+				SetSearchDone(flags, stat, columnGuid, columnGuidViewOffset, gatherStatistics, thisSearchTime);
 			}
 
-			// inform all modules about the new search
-			m_moduleSystem.BroadcastMsg(IDMODMSG_SEARCH_CHANGED);
-
 			// clear hourglass if set before
 			if( useHourglass )
 			{
@@ -3086,10 +3098,79 @@ void SjMainFrame::SetSearch(long flags, const wxString& newSimpleSearch, const S
 		}
 
 		m_inPerformingSearch = FALSE;
+
+		// results of an asynchronous search that came in while we were busy
+		if( m_asyncSearchDoneDeferred )
+		{
+			m_asyncSearchDoneDeferred = FALSE;
+			GetEventHandler()->QueueEvent(new wxCommandEvent(wxEVT_COMMAND_MENU_SELECTED, IDO_SEARCHDONE));
+		}
 	}
 }
 
 
+void SjMainFrame::SetSearchDone(long flags, const SjSearchStat& stat,
+                                const wxString& columnGuid, long columnGuidViewOffset,
+                                bool gatherStatistics, unsigned long startTime)
+{
+	// the second part of SetSearch(), called directly or on IDO_SEARCHDONE
+	m_searchStat.m_totalResultCount = stat.m_totalResultCount;
+	if( flags&(SJ_SETSEARCH_SETADV|SJ_SETSEARCH_CLEARADV) )
+	{
+		m_searchStat.m_advResultCount = stat.m_advResultCount;
+		m_searchStat.m_mbytes = stat.m_mbytes;
+		m_searchStat.m_seconds = stat.m_seconds;
+	}
+
+	// set skin values (should be done before updating the browser
+	// as the browser uses the text from the search information)
+	SjSkinValue v;
+	v.value = m_search.IsSet()? 1 : 0;
+	SetSkinTargetValue(IDT_SEARCH_BUTTON, v);
+	UpdateSearchInfo(0);
+
+	// update the browser
+	m_browser->ReloadColumnMixer(false);
+	if(  !m_search.m_simple.IsSet()
+	 && (!columnGuid.IsEmpty() || !m_searchLastColumnGuid.IsEmpty())  )
+	{
+		if( !columnGuid.IsEmpty() )
+		{
+			m_browser->GotoPos(columnGuid, columnGuidViewOffset);
+		}
+		else
+		{
+			m_browser->GotoPos(m_searchLastColumnGuid, m_searchLastColumnGuidViewOffset);
+		}
+	}
+
+	GotDisplayInputFromUser();
+
+	// remember the row to use after an unsuccessful search or after ending the search
+	if( !m_search.IsSet() || m_searchStat.m_totalResultCount )
+	{
+		m_searchLastColumnGuidViewOffset = 0;
+		m_searchLastColumnGuid = m_browser->GetFirstSelectedOrVisiblePos(m_searchLastColumnGuidViewOffset);
+	}
+
+	// gather statistics for finding out the search delay
+	unsigned long thisSearchTime = SjTools::GetMsTicks() - startTime;
+	wxLogDebug(wxT("%i ms needed for the query"), (int)thisSearchTime);
+	if( gatherStatistics )
+	{
+		m_allSearchCount++;
+		m_allSearchMs += m_allSearchCount>3? thisSearchTime : SJ_SEARCH_DELAY_MS;
+		// use default values for the first two
+		// searches as the real times are not
+		// representive as nothing is cached yet
+		// (m_allSearchCount starts with "1")
+	}
+
+	// inform all modules about the new search
+	m_moduleSystem.BroadcastMsg(IDMODMSG_SEARCH_CHANGED);
+}
+
+
 void SjMainFrame::OnSearchHistory(wxCommandEvent& event)
 {
 	int index = event.GetId() - IDO_SEARCHHISTORY00;
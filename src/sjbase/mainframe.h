@@ -145,9 +145,11 @@ public:
 	#define         SJ_SETSEARCH_SETADV             0x08
 	#define         SJ_SETSEARCH_NOTEXTCTRLUPDATE   0x10
 	#define         SJ_SETSEARCH_NOAUTOHISTORYADD   0x20
+	#define         SJ_SETSEARCH_ASYNC              0x40 // simple searches may be done in a thread
 	void            SetSearch           (long flags, const wxString& newSimpleSearch=wxEmptyString, const SjAdvSearch* newAdvSearch=NULL);
 	const SjSearch* GetSearch           () const { return &m_search; }
 	const SjSearchStat* GetSearchStat   () const { return &m_searchStat; }
+	bool            IsSearchPending     () const { return m_columnMixer.IsSearchPending(); } // TRUE until the results of an asynchronous search are applied
 	void            EndOneSearch        () { SetSearch(m_search.m_simple.IsSet()? SJ_SETSEARCH_CLEARSIMPLE : SJ_SETSEARCH_CLEARADV); }
 	void            EndAllSearch        () { SetSearch(SJ_SETSEARCH_CLEARADV|SJ_SETSEARCH_CLEARSIMPLE); }
 	void            EndSimpleSearch     () { SetSearch(SJ_SETSEARCH_CLEARSIMPLE); }
@@ -283,6 +285,15 @@ private:
 	long            m_searchLastColumnGuidViewOffset;
 	SjAdvSearch     m_tempSearch;
 
+	// context of a search started by SjColumnMixer::StartSearch(), used on IDO_SEARCHDONE
+	void            SetSearchDone       (long flags, const SjSearchStat&, const wxString& columnGuid, long columnGuidViewOffset, bool gatherStatistics, unsigned long startTime);
+	bool            m_asyncSearchDoneDeferred; // IDO_SEARCHDONE received while m_inPerformingSearch was set
+	long            m_asyncSearchFlags;
+	wxString        m_asyncSearchColumnGuid;
+	long            m_asyncSearchColumnGuidViewOffset;
+	bool            m_asyncSearchGatherStatistics;
+	unsigned long   m_asyncSearchStartTime;
+
 	// Zoom and Font Settings
 public:
 	#define         SJ_ZOOM_MIN     0
@@ -68,6 +68,7 @@
 #define THREAD_END_OF_STREAM_A       (IDPLAYER_FIRST+0)
 #define THREAD_AUTO_DELETE           (IDPLAYER_FIRST+1)
 #define THREAD_PRELISTEN_END         (IDPLAYER_FIRST+2)
+#define THREAD_ANALYSER_END          (IDPLAYER_FIRST+3)
 
 
 SjPlayerModule::SjPlayerModule(SjInterfaceBase* interf)
@@ -149,6 +150,8 @@ SjPlayer::SjPlayer()
 
 	m_backend               = NULL;
 	m_streamA               = NULL;
+	m_prerollStream         = NULL;
+	m_prerollMs             = SJ_DEF_PREROLL_MS;
 	m_useSysVol             = SJ_SYSVOL_DEFAULT;
 
 	m_prelistenBackend      = NULL;
@@ -156,6 +159,14 @@ SjPlayer::SjPlayer()
 	m_prelistenDest         = SJ_PL_DEFAULT;
 	m_prelistenGain         = 1.0F;
 	m_prelistenUseSysVol    = SJ_SYSVOL_DEFAULT;
+
+	m_analyserBackend       = NULL;
+	m_analyserStreamCnt     = 0;
+	m_analyserIdleTimestamp = 0;
+	for( int i = 0; i < SJ_ANALYSER_MAX_STREAMS; i++ ) {
+		m_analyserStreams[i] = NULL;
+		m_analyserStartTimestamp[i] = 0;
+	}
 }
 
 
@@ -168,7 +179,9 @@ void SjPlayer::Init()
 	m_isInitialized = true;
 	m_queue.Init();
 
-	m_backend = new BACKEND_CLASSNAME(SJBE_ID_STDOUTPUT);
+	// the headless backend decodes through the whole DSP chain without audio device, eg. for benchmarks and tests on build machines
+	bool headless = (SjMainApp::s_cmdLine->Found(wxT("headless")) || g_tools->m_config->Read(wxT("player/headless"), 0L)!=0);
+	m_backend = new BACKEND_CLASSNAME(headless? SJBE_ID_HEADLESS : SJBE_ID_STDOUTPUT);
 	m_prelistenBackend = new BACKEND_CLASSNAME(SJBE_ID_PRELISTEN);
 
 	// load settings
@@ -185,6 +198,7 @@ void SjPlayer::Init()
 	m_manCrossfadeMs            =c->Read("player/crossfadeManMs",      SJ_DEF_CROSSFADE_MS);
 	m_crossfadeOffsetEndMs      =c->Read("player/crossfadeOffsetEndMs",SJ_DEF_CROSSFADE_OFFSET_END_MS);
 	SetOnlyFadeOut              (c->Read("player/onlyFadeOut",         0L/*defaults to off*/)!=0);
+	m_prerollMs                 =c->Read("player/prerollMs",           SJ_DEF_PREROLL_MS);
 
 	StopAfterEachTrack          (c->Read("player/stopAfterEachTrack",  0L)!=0);
 
@@ -200,6 +214,15 @@ void SjPlayer::Init()
 	m_prelistenUseSysVol        =c->Read("player/prelistenUseSysVol",  SJ_SYSVOL_DEFAULT);
 	m_prelistenMixQuiet         = (float)c->Read("player/prelistenMixQuiet", (long)(SJ_DEF_PL_MIX_QUIET*1000.0F)) / 1000.0F;
 	m_prelistenEqPreset         = c->Read("player/prelistenEqPreset",  "");
+
+	m_dspProfiler.Enable        (c->Read("player/dspProfile",          0L)!=0);
+
+	// the background analysis decodes the whole library, so it must be enabled explicitly
+	m_analyserStreamCnt         = c->Read("player/autovolAnalyse",     0L);
+	if( m_analyserStreamCnt > SJ_ANALYSER_MAX_STREAMS ) { m_analyserStreamCnt = SJ_ANALYSER_MAX_STREAMS; }
+	if( m_analyserStreamCnt > 0 ) {
+		m_analyserBackend = new BACKEND_CLASSNAME(SJBE_ID_HEADLESS);
+	}
 }
 
 
@@ -258,8 +281,18 @@ void SjPlayer::Exit()
 		// SaveSettings() should be called by the caller, if needed
 		m_isInitialized = false;
 
+		DeleteStream(&m_prerollStream, 0);
 		DeleteStream(&m_streamA, 0);
 
+		for( int i = 0; i < SJ_ANALYSER_MAX_STREAMS; i++ ) {
+			DeleteStream(&m_analyserStreams[i], 0); // results not yet written are lost, the tracks are just analysed again
+		}
+		if( m_analyserBackend )
+		{
+			delete m_analyserBackend;
+			m_analyserBackend = NULL;
+		}
+
 		if( m_backend )
 		{
 			delete m_backend;
@@ -492,9 +525,12 @@ public:
 	{
 		m_player               = player;
 		m_isPrelistenStream    = isPrelistenStream;
+		m_isAnalyserStream     = false;
+		m_analyserStartMs      = 0;
 		m_onCreateFadeMs       = onCreateFadeMs;
 		m_onCreateFadeDestGain = onCreateFadeDestGain;
 		m_isVideo              = false;
+		m_prerollEos           = false;
 		m_realMs               = 0;
 		m_autoDelete           = false; // if set, the stream is deleted on EOS or if fading is done
 		m_autoDeleteSend       = false;
@@ -503,7 +539,10 @@ public:
 	float         m_onCreateFadeDestGain;
 	SjPlayer*     m_player;
 	bool          m_isPrelistenStream;
+	bool          m_isAnalyserStream;   // only m_volumeCalc and m_realMs are used, see SjPlayer::UpdateAnalyser()
+	unsigned long m_analyserStartMs;
 	bool          m_isVideo;
+	bool          m_prerollEos;
 	long          m_realMs;
 	SjVolumeCalc  m_volumeCalc;
 	SjVolumeFade  m_volumeFade;
@@ -515,6 +554,18 @@ public:
 };
 
 
+static inline void SjPlayer_ProfileStage(SjDspProfiler& profiler, bool profile, int stage, int64_t& profileLast)
+{
+	// adds the time since the previous stage to the profiler, if enabled
+	if( profile )
+	{
+		int64_t profileNow = SjDspProfiler::GetUsTicks();
+		profiler.AddStage(stage, profileNow-profileLast);
+		profileLast = profileNow;
+	}
+}
+
+
 void SjPlayer_BackendCallback(SjBackendCallbackParam* cbp)
 {
 	// TAKE CARE: this function is called while processing the audio data,
@@ -530,6 +581,42 @@ void SjPlayer_BackendCallback(SjBackendCallbackParam* cbp)
 	int                samplerate = cbp->samplerate;
 	int                channels   = cbp->channels;
 
+	if( userdata->m_isAnalyserStream )
+	{
+		/* Background analysis: just calculate the volume
+		***********************************************************************/
+
+		if( cbp->msg == SJBE_MSG_DSP )
+		{
+			if( buffer != NULL && bytes > 0 && samplerate > 0 && channels > 0 ) {
+				userdata->m_volumeCalc.AddBuffer(buffer, bytes, samplerate, channels);
+				userdata->m_realMs += (long)(((double)bytes / (sizeof(float)*channels) * 1000.0) / samplerate);
+
+				// low priority: we're in the decoder thread and limit the speed, so that the analysis
+				// does not take a whole CPU core (we do not change the thread priority as GStreamer reuses its threads)
+				#define ANALYSER_MAX_SPEED 40 // x realtime
+				unsigned long thisMs = SjTools::GetMsTicks();
+				if( userdata->m_analyserStartMs == 0 ) {
+					userdata->m_analyserStartMs = thisMs;
+				}
+				long aheadMs = userdata->m_realMs/ANALYSER_MAX_SPEED - (long)(thisMs-userdata->m_analyserStartMs);
+				if( aheadMs > 0 ) {
+					wxMilliSleep(aheadMs > 100? 100 : aheadMs);
+				}
+			}
+		}
+		else if( cbp->msg == SJBE_MSG_END_OF_STREAM )
+		{
+			player->SendSignalToMainThread(THREAD_ANALYSER_END, (uintptr_t)stream);
+		}
+		else if( cbp->msg == SJBE_MSG_DESTROY_USERDATA )
+		{
+			delete userdata;
+			stream->m_userdata = NULL;
+		}
+		return;
+	}
+
 	if( cbp->msg == SJBE_MSG_DSP )
 	{
 		/* DSP
@@ -537,8 +624,15 @@ void SjPlayer_BackendCallback(SjBackendCallbackParam* cbp)
 
 		if( buffer != NULL && bytes > 0 )
 		{
+			// measure the stages, if desired
+			SjDspProfiler& profiler = player->m_dspProfiler;
+			bool           profile = profiler.IsEnabled();
+			int64_t        profileStart = 0, profileLast = 0;
+			if( profile ) { profileStart = profileLast = SjDspProfiler::GetUsTicks(); }
+
 			// calculate the volume - we do this ALWAYS, if autovol is enabled or not
 			userdata->m_volumeCalc.AddBuffer(buffer, bytes, samplerate, channels);
+			SjPlayer_ProfileStage(profiler, profile, SJ_DSP_VOLCALC, profileLast);
 
 			// apply the calulated gain, if desired
 			if( player->m_avEnabled )
@@ -548,17 +642,20 @@ void SjPlayer_BackendCallback(SjBackendCallbackParam* cbp)
 				if( stream == player->m_streamA ) {
 					player->m_avCalculatedGain = userdata->m_volumeCalc.GetGain();
 				}
+				SjPlayer_ProfileStage(profiler, profile, SJ_DSP_AUTOVOL, profileLast);
 			}
 
 			// equalizer - after volumeCalc, otherwise, volumeCalc would calculate the volume depending on the eq settings
 			// do not check for m_eqEnabled here, this state is forwarded to the corresponsing equalizer object, if needed
 			userdata->m_equalizer.AdjustBuffer(buffer, bytes, samplerate, channels);
+			SjPlayer_ProfileStage(profiler, profile, SJ_DSP_EQUALIZER, profileLast);
 
 			// forward the data to the visualisation -
 			// we do this after autovol, equalizers etc. so that these changes become visible eg. in the spectrum analyzer
 			if( g_visModule->IsVisStarted() && stream == player->m_streamA /*this also excludes prelistening*/ )
 			{
 				g_visModule->AddVisData(buffer, bytes);
+				SjPlayer_ProfileStage(profiler, profile, SJ_DSP_VIS, profileLast);
 			}
 
 			// apply optional fadings, eg. for crossfading
@@ -571,6 +668,7 @@ void SjPlayer_BackendCallback(SjBackendCallbackParam* cbp)
 					}
 				userdata->m_autoDeleteCritical.Leave();
 			}
+			SjPlayer_ProfileStage(profiler, profile, SJ_DSP_FADE, profileLast);
 
 			// finally, after the visualisation, apply the main volume and mixdown channels, if appropriate ...
 			if( !userdata->m_isPrelistenStream )
@@ -597,6 +695,12 @@ void SjPlayer_BackendCallback(SjBackendCallbackParam* cbp)
 
 				SjApplyVolume(buffer, bytes, player->m_prelistenGain);
 			}
+			SjPlayer_ProfileStage(profiler, profile, SJ_DSP_MIXDOWN, profileLast);
+
+			// check the deadline: processing should take much less time than playing the buffer
+			if( profile && samplerate > 0 && channels > 0 ) {
+				profiler.AddBuffer(profileLast-profileStart, (int64_t)bytes*1000000 / ((int64_t)sizeof(float)*channels*samplerate));
+			}
 		}
 	}
 	else if( cbp->msg == SJBE_MSG_CREATE )
@@ -636,7 +740,11 @@ void SjPlayer_BackendCallback(SjBackendCallbackParam* cbp)
 		/* Video detected
 		***********************************************************************/
 
-		if( !userdata->m_isVideo && !userdata->m_isPrelistenStream )
+		if( stream->IsPrerolled() )
+		{
+			userdata->m_isVideo = true; // just remember, the prerolled stream is not used for videos, see CreateStream()
+		}
+		else if( !userdata->m_isVideo && !userdata->m_isPrelistenStream )
 		{
 			userdata->m_isVideo = true;
 			player->SendSignalToMainThread(IDMODMSG_VIDEO_DETECTED);
@@ -647,6 +755,13 @@ void SjPlayer_BackendCallback(SjBackendCallbackParam* cbp)
 		/* End of stream
 		***********************************************************************/
 
+		// prerolled stream already at the end (or failed)? this is checked when the stream is needed
+		if( stream->IsPrerolled() )
+		{
+			userdata->m_prerollEos = true;
+			return;
+		}
+
 		// auto delete stream?
 		bool sendEos = true;
 		userdata->m_autoDeleteCritical.Enter();
@@ -680,7 +795,9 @@ void SjPlayer_BackendCallback(SjBackendCallbackParam* cbp)
 
 		wxASSERT( wxThread::IsMain() );
 
-		player->SaveGatheredInfo(stream->GetUrl(), stream->GetStartingTime(), &userdata->m_volumeCalc, userdata->m_realMs);
+		if( !stream->IsPrerolled() ) { // a stream that was never started is not worth a playback statistic
+			player->SaveGatheredInfo(stream->GetUrl(), stream->GetStartingTime(), &userdata->m_volumeCalc, userdata->m_realMs);
+		}
 
 		delete userdata;
 		stream->m_userdata = NULL;
@@ -693,7 +810,7 @@ void SjPlayer_BackendCallback(SjBackendCallbackParam* cbp)
  ******************************************************************************/
 
 
-SjBackendStream* SjPlayer::CreateStream(const wxString& url, bool createPrelistenStream, long explicitSeekMs, long fadeMs)
+SjBackendStream* SjPlayer::CreateStream(const wxString& url, bool createPrelistenStream, long explicitSeekMs, long fadeMs, bool preroll)
 {
 	float fadeDest = 1.0;
 	if( !createPrelistenStream && m_prelistenStream && m_prelistenDest == SJ_PL_MIX ) {
@@ -701,6 +818,34 @@ SjBackendStream* SjPlayer::CreateStream(const wxString& url, bool createPreliste
 		fadeDest = m_prelistenMixQuiet;
 	}
 
+	// use the prerolled stream, if it is the one we need; any other stream makes it useless
+	if( m_prerollStream && !createPrelistenStream && !preroll )
+	{
+		SjBackendStream*   stream = m_prerollStream;
+		SjBackendUserdata* ud     = stream->m_userdata;
+		m_prerollStream = NULL;
+
+		if( explicitSeekMs <= 0 && ud && !ud->m_prerollEos && !ud->m_isVideo && stream->GetUrl() == url )
+		{
+			// the fading and the equalizer may have changed since the stream was created;
+			// the backend holds the first buffer before the DSP until StartPrerolled(), so there is
+			// no concurrent access to the userdata and the new settings apply from the first sample on
+			if( fadeMs ) {
+				ud->m_volumeFade.SetVolume(0.0);
+				ud->m_volumeFade.SlideVolume(fadeDest, fadeMs);
+			}
+			else {
+				ud->m_volumeFade.SetVolume(1.0);
+			}
+			ud->m_equalizer.SetParam(m_eqEnabled, m_eqParam);
+
+			stream->StartPrerolled();
+			return stream;
+		}
+
+		DeleteStream(&stream, 0);
+	}
+
 	SjBackendUserdata* userdata = new SjBackendUserdata(this, createPrelistenStream, fadeMs, fadeDest);
 	if( userdata == NULL ) {
 		return NULL;
@@ -713,7 +858,10 @@ SjBackendStream* SjPlayer::CreateStream(const wxString& url, bool createPreliste
 
 	// create the stream
 	SjBackendStream* stream;
-	if( createPrelistenStream && m_prelistenDest == SJ_PL_OWNOUTPUT ) {
+	if( preroll ) {
+		stream = m_backend->PrerollStream(url, SjPlayer_BackendCallback, userdata);
+	}
+	else if( createPrelistenStream && m_prelistenDest == SJ_PL_OWNOUTPUT ) {
 		stream = m_prelistenBackend->CreateStream(url, startThisMs, SjPlayer_BackendCallback, userdata);
 	}
 	else {
@@ -839,6 +987,11 @@ void SjPlayer::Stop(bool stopVisIfPlaying, bool keepPrelisten)
 		m_streamA = NULL;
 	}
 
+	if( m_prerollStream ) {
+		delete m_prerollStream;
+		m_prerollStream = NULL;
+	}
+
 	if( m_prelistenStream && !keepPrelisten ) {
 		delete m_prelistenStream; // may lay on m_backend or m_prelistenBackend
 		m_prelistenStream = NULL;
@@ -1150,8 +1303,150 @@ void SjPlayer::GetPrelistenInfo(wxString& url, long& totalMs, long& elapsedMs, l
 }
 
 
+void SjPlayer::UpdatePreroll()
+{
+	// find out the track that will be played next - if it is time to open it
+	wxString nextUrl;
+	if( m_prerollMs > 0 && m_backend && m_backend->CanPreroll()
+	 && m_streamA && m_streamA->m_userdata && !m_streamA->m_userdata->m_isVideo
+	 && !m_stopAfterThisTrack && !m_stopAfterEachTrack )
+	{
+		long totalMs = -1, elapsedMs = -1;
+		m_streamA->GetTime(totalMs, elapsedMs);
+
+		long startNextMs = totalMs;
+		if( m_autoCrossfade && totalMs >= m_autoCrossfadeMs*2 ) { startNextMs -= m_autoCrossfadeMs+m_crossfadeOffsetEndMs; }
+
+		if( totalMs > 0 && elapsedMs >= 0 && elapsedMs >= startNextMs-m_prerollMs )
+		{
+			long nextQueuePos = m_queue.GetNextPos(SJ_PREVNEXT_REGARD_REPEAT|SJ_PREVNEXT_LOOKUP_ONLY);
+			if( nextQueuePos != -1 )
+			{
+				nextUrl = m_queue.GetUrlByPos(nextQueuePos);
+				if( m_failedUrls.Index(nextUrl) != wxNOT_FOUND ) {
+					nextUrl.Clear();
+				}
+			}
+		}
+	}
+
+	// drop a prerolled stream that is no longer needed, eg. the queue was changed
+	if( m_prerollStream && m_prerollStream->GetUrl() != nextUrl ) {
+		DeleteStream(&m_prerollStream, 0);
+	}
+
+	// preroll the next track; the fading is checked again when the stream is started
+	if( m_prerollStream == NULL && !nextUrl.IsEmpty() ) {
+		m_prerollStream = CreateStream(nextUrl, false, 0, (m_autoCrossfade && !m_onlyFadeOut)? m_autoCrossfadeMs : 0, true);
+	}
+}
+
+
+void SjPlayer::UpdateAnalyser()
+{
+	// start analysing the next tracks; the streams are decoded as fast as possible, normally, they end
+	// long before the next timer call, see THREAD_ANALYSER_END
+	if( m_analyserBackend == NULL || SjMainApp::IsInShutdown() ) {
+		return;
+	}
+
+	#define ANALYSER_TIMEOUT_MS  (30*60*1000) // a stream that does not end at all
+	#define ANALYSER_IDLE_MS     (10*60*1000) // check for new tracks when there was nothing to do
+	#define ANALYSER_BATCH_CNT   32
+	unsigned long thisTimestamp = SjTools::GetMsTicks();
+	int i, running = 0;
+	for( i = 0; i < m_analyserStreamCnt; i++ )
+	{
+		if( m_analyserStreams[i] && thisTimestamp > m_analyserStartTimestamp[i]+ANALYSER_TIMEOUT_MS ) {
+			AnalyserStreamDone(i, false);
+		}
+		if( m_analyserStreams[i] ) {
+			running++;
+		}
+	}
+
+	// get the next tracks to analyse; as the library does not know about running streams, this is only done if all streams are done
+	if( m_analyserTodo.IsEmpty() )
+	{
+		if( running > 0 || thisTimestamp < m_analyserIdleTimestamp+ANALYSER_IDLE_MS ) {
+			return;
+		}
+
+		FlushAnalyser();
+		g_mainFrame->m_libraryModule->GetUnanalysedUrls(m_analyserTodo, ANALYSER_BATCH_CNT);
+		if( m_analyserTodo.IsEmpty() ) {
+			m_analyserIdleTimestamp = thisTimestamp;
+			return;
+		}
+		m_analyserIdleTimestamp = 0;
+	}
+
+	// start the streams
+	for( i = 0; i < m_analyserStreamCnt && !m_analyserTodo.IsEmpty(); i++ )
+	{
+		if( m_analyserStreams[i] == NULL )
+		{
+			wxString url = m_analyserTodo[0];
+			m_analyserTodo.RemoveAt(0);
+
+			SjBackendUserdata* userdata = new SjBackendUserdata(this, false, 0, 1.0);
+			userdata->m_isAnalyserStream = true;
+			m_analyserStreams[i] = m_analyserBackend->CreateStream(url, 0, SjPlayer_BackendCallback, userdata);
+			m_analyserStartTimestamp[i] = thisTimestamp;
+			if( m_analyserStreams[i] == NULL ) {
+				m_analyserDoneUrls.Add(url);
+				m_analyserDoneGains.Add(-1); // do not try again
+			}
+		}
+	}
+}
+
+
+void SjPlayer::AnalyserStreamDone(int slot, bool eos)
+{
+	SjBackendStream* stream = m_analyserStreams[slot];
+	if( stream == NULL || stream->m_userdata == NULL ) {
+		return;
+	}
+
+	// the gain is saved if the whole stream was decoded; very short tracks and errors result in "cannot be analysed"
+	// (the end of the stream is also signalled after errors, so a partly decoded track must not be taken as complete)
+	SjVolumeCalc* volumeCalc = &stream->m_userdata->m_volumeCalc;
+	long gain = -1;
+	if( eos && !stream->HasErrors() && volumeCalc->IsGainWorthSaving() && stream->m_userdata->m_realMs > 0 ) {
+		gain = ::SjGain2Long(volumeCalc->GetGain());
+	}
+	m_analyserDoneUrls.Add(stream->GetUrl());
+	m_analyserDoneGains.Add(gain);
+
+	DeleteStream(&m_analyserStreams[slot], 0);
+
+	if( m_analyserDoneUrls.GetCount() >= ANALYSER_BATCH_CNT ) {
+		FlushAnalyser();
+	}
+}
+
+
+void SjPlayer::FlushAnalyser()
+{
+	// write the results in one transaction
+	if( m_analyserDoneUrls.IsEmpty() || SjMainApp::IsInShutdown() ) {
+		return;
+	}
+
+	g_mainFrame->m_libraryModule->SetAnalysedAutoVol(m_analyserDoneUrls, m_analyserDoneGains);
+	wxLogInfo("%i track(s) analysed for auto volume"/*n/t*/, (int)m_analyserDoneUrls.GetCount());
+
+	m_analyserDoneUrls.Clear();
+	m_analyserDoneGains.Clear();
+}
+
+
 void SjPlayer::OneSecondTimer()
 {
+	UpdatePreroll();
+	UpdateAnalyser();
+
 	if( !m_autoCrossfade || m_streamA == NULL || m_streamA->m_userdata == NULL ) {
 		return; // crossfading and silence detection disabled OR no stream
 	}
@@ -1286,6 +1581,19 @@ void SjPlayer::ReceiveSignal(int signal, uintptr_t extraLong)
 			g_mainFrame->UpdateDisplay();
 		}
 	}
+	else if( signal == THREAD_ANALYSER_END )
+	{
+		// a track is analysed, continue with the next one at once
+		for( int i = 0; i < SJ_ANALYSER_MAX_STREAMS; i++ )
+		{
+			if( m_analyserStreams[i] && m_analyserStreams[i] == (SjBackendStream*)extraLong )
+			{
+				AnalyserStreamDone(i, true);
+				UpdateAnalyser();
+				break;
+			}
+		}
+	}
 	else if( signal == THREAD_AUTO_DELETE )
 	{
 		// just delete the given stream - the message is needed as we cannot do this from a working thread
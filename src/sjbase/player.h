@@ -149,6 +149,9 @@ public:
 	long            m_crossfadeOffsetEndMs;
 	long            m_manCrossfadeMs;
 
+	// Measuring the audio callback, see SjPlayer_BackendCallback()
+	SjDspProfiler   m_dspProfiler;
+
 	void            OneSecondTimer      ();
 
 	// The IDP_* messages posted to the main module should
@@ -160,9 +163,15 @@ private:
 	// The player's backend, normally selected by a define as SJ_USE_GSTREAMER or SJ_USE_XINE
 	SjBackend*       m_backend;
 	SjBackendStream* m_streamA;
-	SjBackendStream* CreateStream       (const wxString& url, bool createPrelistenStream, long seekMs, long fadeMs);
+	SjBackendStream* CreateStream       (const wxString& url, bool createPrelistenStream, long seekMs, long fadeMs, bool preroll=false);
 	void             DeleteStream       (SjBackendStream**, long fadeMs); // the given pointer must not be used by the caller after using this function!
 
+	// preroll: the next track is opened some seconds before it is needed, CreateStream() just starts it then
+	#define          SJ_DEF_PREROLL_MS  10000L
+	long             m_prerollMs;       // 0=disabled
+	SjBackendStream* m_prerollStream;
+	void             UpdatePreroll      ();
+
 	#define          SJ_SYSVOL_DONTUSE  0
 	#define          SJ_SYSVOL_USE      1
 	#define          SJ_SYSVOL_ONLYINIT 2
@@ -187,6 +196,20 @@ private:
 	// the trash
 	wxArrayPtrVoid   m_trashedStreams;
 
+	// background analysis of the autovol gain of tracks never played; the tracks are decoded by the headless backend
+	#define          SJ_ANALYSER_MAX_STREAMS 8
+	long             m_analyserStreamCnt;   // number of tracks analysed at the same time, 0=disabled
+	SjBackend*       m_analyserBackend;
+	SjBackendStream* m_analyserStreams[SJ_ANALYSER_MAX_STREAMS];
+	unsigned long    m_analyserStartTimestamp[SJ_ANALYSER_MAX_STREAMS];
+	wxArrayString    m_analyserTodo;
+	wxArrayString    m_analyserDoneUrls;    // results not yet written to the library
+	wxArrayLong      m_analyserDoneGains;
+	unsigned long    m_analyserIdleTimestamp;
+	void             UpdateAnalyser     ();
+	void             AnalyserStreamDone (int slot, bool eos);
+	void             FlushAnalyser      ();
+
 	// tools
 	void            SendSignalToMainThread(int id, uintptr_t extraLong=0) const;
 	void            SaveGatheredInfo    (const wxString& url, unsigned long startingTime, SjVolumeCalc*, long realDecodedBytes);
@@ -473,11 +473,11 @@ void SjRule::AddToInclExcl(const wxString& idsToAdd)
 }
 
 
-void SjRule::AddToInclExcl(SjLLHash* ids)
+void SjRule::AddToInclExcl(const SjIdSet* ids)
 {
 	wxString strToAdd;
 	long id;
-	SjHashIterator iterator;
+	SjIdSetIterator iterator;
 	while( ids->Iterate(iterator, &id) )
 	{
 		strToAdd.Printf(wxT("%i"), (int)id);
@@ -491,11 +491,11 @@ void SjRule::AddToInclExcl(SjLLHash* ids)
 
 
 
-void SjRule::RemoveFromInclExcl(SjLLHash* ids)
+void SjRule::RemoveFromInclExcl(const SjIdSet* ids)
 {
 	wxString strToRemove;
 	long id;
-	SjHashIterator iterator;
+	SjIdSetIterator iterator;
 	while( ids->Iterate(iterator, &id) )
 	{
 		strToRemove.Printf(wxT(",%i,"), (int)id);
@@ -1016,7 +1016,7 @@ bool SjAdvSearch::IsEqualTo(const SjAdvSearch& o) const
 }
 
 
-long SjAdvSearch::IncludeExclude(SjLLHash* ids, int action)
+long SjAdvSearch::IncludeExclude(const SjIdSet* ids, int action)
 {
 	// "action" values:
 	// +1   -   add "ids" to the first SJ_PSEUDOFIELD_INCLUDE, merge other includes to the first one, remove "ids" from all SJ_PSEUDOFIELD_EXCLUDE
@@ -1251,7 +1251,33 @@ bool LimitValues::Set(int fieldIndex, long max__, long multiplier)
 }
 
 
-SjSearchStat SjAdvSearch::GetAsSql(SjLLHash* retHash, wxString& retSql) const
+SjSearchStat SjAdvSearch::GetAsSql(SjIdSet* retIds, wxString& retSql) const
+{
+	SjSearchStat stat;
+
+	// the results of saved searches are cached, see SjAdvSearchCache
+	SjAdvSearchCache* cache = NULL;
+	if( m_id && IsSet() && g_mainFrame && g_mainFrame->m_libraryModule )
+	{
+		cache = &g_mainFrame->m_libraryModule->m_advSearchCache;
+		if( cache->Lookup(*this, retIds, stat, retSql) )
+		{
+			return stat;
+		}
+	}
+
+	stat = GetAsSql__(retIds, retSql);
+
+	if( cache )
+	{
+		cache->Add(*this, *retIds, stat, retSql);
+	}
+
+	return stat;
+}
+
+
+SjSearchStat SjAdvSearch::GetAsSql__(SjIdSet* retIds, wxString& retSql) const
 {
 	SjSearchStat stat;
 
@@ -1259,7 +1285,7 @@ SjSearchStat SjAdvSearch::GetAsSql(SjLLHash* retHash, wxString& retSql) const
 	// init the return values
 	//
 
-	retHash->Clear();
+	retIds->Clear();
 	if( !IsSet() )
 	{
 		retSql = wxT("(1)"); // no filter - select all
@@ -1267,6 +1293,21 @@ SjSearchStat SjAdvSearch::GetAsSql(SjLLHash* retHash, wxString& retSql) const
 		return stat;
 	}
 
+	//
+	// most searches can be done by the in-memory index of the library,
+	// if not, we continue with SQL below
+	//
+
+	if( g_mainFrame && g_mainFrame->m_libraryModule
+	 && g_mainFrame->m_libraryModule->m_trackIndex.Search(*this, retIds) )
+	{
+		stat.m_advResultCount = retIds->GetCount();
+		stat.m_mbytes = -1;
+		stat.m_seconds = -1;
+		retSql = stat.m_advResultCount>0? wxT("INFILTER(tracks.id)") : wxT("(0)");
+		return stat;
+	}
+
 	//
 	// go through all rules and collect the intermediate conditions
 	//
@@ -1513,7 +1554,7 @@ SjSearchStat SjAdvSearch::GetAsSql(SjLLHash* retHash, wxString& retSql) const
 				}
 
 				// add the track to the result
-				retHash->Insert(innerSql.GetLong(0), 1);
+				retIds->Insert(innerSql.GetLong(0));
 			}
 		}
 		else
@@ -1557,7 +1598,7 @@ SjSearchStat SjAdvSearch::GetAsSql(SjLLHash* retHash, wxString& retSql) const
 					}
 
 					// add the track to the result
-					retHash->Insert(innerSql.GetLong(0), 1);
+					retIds->Insert(innerSql.GetLong(0));
 				}
 			}
 		}
@@ -1567,7 +1608,7 @@ SjSearchStat SjAdvSearch::GetAsSql(SjLLHash* retHash, wxString& retSql) const
 	// done so far
 	//
 
-	stat.m_advResultCount = retHash->GetCount();
+	stat.m_advResultCount = retIds->GetCount();
 	if( limit[LIMIT_BYTES].IsSet() )
 	{
 		limit[LIMIT_BYTES].m_curr /= (1024*1024);
@@ -1595,9 +1636,9 @@ SjSearchStat SjAdvSearch::GetAsSql(SjLLHash* retHash, wxString& retSql) const
 	}
 	/*else if( stat.m_advResultCount < 500 )
 	{
-	    // not used as we modify the given hash
+	    // not used as we modify the given set
 	    // for easy filter manipulation
-	    retSql = "tracks.id IN("+ retHash->GetKeysAsString() +")";
+	    retSql = "tracks.id IN("+ retIds->GetKeysAsString() +")";
 	}
 	else */
 	{
@@ -1615,31 +1656,227 @@ wxString SjAdvSearch::GetRandomUrl() const
 		return ""; // advanced search not valid.
 	}
 
-	// get all hash IDs
-	SjLLHash trackIdsHash;
+	// get all track IDs
+	SjIdSet trackIds;
 	{
 		wxString dummySelectSql;
-		GetAsSql(&trackIdsHash, dummySelectSql);
-		if( trackIdsHash.GetCount()==0 ) {
+		GetAsSql(&trackIds, dummySelectSql);
+		if( trackIds.GetCount()==0 ) {
 			return ""; // no tracks at all.
 		}
 	}
 
 	// select a random track ID
-	long selectedTrackId;
+	long selectedTrackId = 0;
+	trackIds.Select(SjTools::Rand(trackIds.GetCount()), &selectedTrackId);
+
+	// get URL for this track ID, may be empty
+	return g_mainFrame->m_libraryModule->GetUrl(selectedTrackId);
+}
+
+
+/*******************************************************************************
+ * SjAdvSearchCache
+ ******************************************************************************/
+
+
+#define SJ_SEARCHDEP_NOW_       0x100L // relative to the current time, re-evaluated after a minute
+#define SJ_SEARCHDEP_TODAY_     0x200L // relative to the current day, re-evaluated at midnight
+#define SJ_ADVSEARCHCACHE_MAX   64
+
+
+class SjAdvSearchCacheEntry
+{
+public:
+	SjAdvSearch     m_search;
+	SjIdSet         m_ids;
+	SjSearchStat    m_stat;
+	wxString        m_sql;
+	long            m_deps;
+	long            m_validUntil; // 0 = valid until invalidated
+	unsigned long   m_lastUsed;
+};
+
+
+SjAdvSearchCache::SjAdvSearchCache()
+{
+	m_enabled = g_tools->m_config->Read(wxT("main/advSearchCache"), 1L)!=0;
+	m_lastUsed = 0;
+}
+
+
+void SjAdvSearchCache::Clear()
+{
+	long id;
+	SjAdvSearchCacheEntry* entry;
+	SjHashIterator iterator;
+	while( (entry=(SjAdvSearchCacheEntry*)m_entries.Iterate(iterator, &id)) )
 	{
-		long wantedIndex = SjTools::Rand(trackIdsHash.GetCount());
+		delete entry;
+	}
+	m_entries.Clear();
+}
+
+
+void SjAdvSearchCache::Invalidate(long deps)
+{
+	long id;
+	SjAdvSearchCacheEntry* entry;
+	SjHashIterator iterator;
+	while( (entry=(SjAdvSearchCacheEntry*)m_entries.Iterate(iterator, &id)) )
+	{
+		if( entry->m_deps & deps )
+		{
+			m_entries.Remove(id); // the iteration functionality allows us to remove the current element
+			delete entry;
+		}
+	}
+}
+
+
+long SjAdvSearchCache::GetDeps(const SjAdvSearch& search)
+{
+	// returns the SJ_SEARCHDEP_* flags the search depends on
+	// or -1 if the result of the search should not be cached
+	long    deps = 0;
+	size_t  r, rulesCount = search.m_rules.GetCount();
+	for( r = 0; r < rulesCount; r++ )
+	{
+		const SjRule& rule = search.m_rules[r];
+		SjField field = rule.m_field;
+		if( field == SJ_PSEUDOFIELD_SQL
+		 || field == SJ_PSEUDOFIELD_QUEUEPOS )
+		{
+			return -1; // may depend on anything
+		}
+		else if( field == SJ_PSEUDOFIELD_LIMIT )
+		{
+			long orderById; SjTools::ParseNumber(rule.m_value[1], &orderById);
+			if( orderById == SJ_PSEUDOFIELD_RANDOM )
+			{
+				return -1; // a new random selection is expected each time
+			}
+
+			// the limits use the fields databytes, playtimems and albumid
+			deps |= SJ_SEARCHDEP_TAGS;
+			if( rule.m_unit == SJ_UNIT_MINUTES || rule.m_unit == SJ_UNIT_HOURS )
+			{
+				deps |= SJ_SEARCHDEP_PLAYBACK;
+			}
+
+			field = (SjField)(orderById&~SJ_FIELDFLAG_DESC);
+		}
+		else if( rule.m_op == SJ_FIELDOP_IS_IN_THE_LAST || rule.m_op == SJ_FIELDOP_IS_NOT_IN_THE_LAST )
+		{
+			deps |= (rule.m_unit == SJ_UNIT_MINUTES || rule.m_unit == SJ_UNIT_HOURS)? SJ_SEARCHDEP_NOW_ : SJ_SEARCHDEP_TODAY_;
+		}
+		else if( SjRule::GetFieldType(field) == SJ_FIELDTYPE_DATE )
+		{
+			// dates as "today -7", "yesterday" or "now", see SjTools::ParseDate_()
+			for( int v = 0; v < 2; v++ )
+			{
+				wxString value = rule.m_value[v].Lower().Trim(FALSE);
+				if( value.StartsWith(wxT("now")) )
+				{
+					deps |= SJ_SEARCHDEP_NOW_;
+				}
+				else if( value.StartsWith(wxT("today")) || value.StartsWith(wxT("yesterday")) )
+				{
+					deps |= SJ_SEARCHDEP_TODAY_;
+				}
+			}
+		}
+
+		switch( field )
+		{
+			case SJ_FIELD_RATING:       deps |= SJ_SEARCHDEP_RATING;    break;
+			case SJ_FIELD_TIMESPLAYED:
+			case SJ_FIELD_LASTPLAYED:
+			case SJ_FIELD_AUTOVOL:
+			case SJ_FIELD_PLAYTIME:     deps |= SJ_SEARCHDEP_PLAYBACK;  break;
+			default:                    deps |= SJ_SEARCHDEP_TAGS;      break;
+		}
+	}
+
+	if( search.m_selectScope == SJ_SELECTSCOPE_ALBUMS )
+	{
+		deps |= SJ_SEARCHDEP_TAGS; // albumid
+	}
+
+	return deps;
+}
+
+
+bool SjAdvSearchCache::Lookup(const SjAdvSearch& search, SjIdSet* retIds, SjSearchStat& retStat, wxString& retSql)
+{
+	SjAdvSearchCacheEntry* entry = (SjAdvSearchCacheEntry*)m_entries.Lookup(search.m_id);
+	if( entry == NULL )
+	{
+		return FALSE;
+	}
+
+	if( entry->m_search != search // the search was edited meanwhile
+	 || (entry->m_validUntil && (long)wxDateTime::Now().GetTicks() >= entry->m_validUntil) )
+	{
+		m_entries.Remove(search.m_id);
+		delete entry;
+		return FALSE;
+	}
+
+	*retIds = entry->m_ids;
+	retStat = entry->m_stat;
+	retSql = entry->m_sql;
+	entry->m_lastUsed = ++m_lastUsed;
+	return TRUE;
+}
+
+
+void SjAdvSearchCache::Add(const SjAdvSearch& search, const SjIdSet& ids, const SjSearchStat& stat, const wxString& sql)
+{
+	long deps = GetDeps(search);
+	if( !m_enabled || deps == -1 )
+	{
+		return;
+	}
+
+	// remove an old result of the same search or, if the cache is full,
+	// the least recently used result
+	SjAdvSearchCacheEntry* entry = (SjAdvSearchCacheEntry*)m_entries.Remove(search.m_id);
+	if( entry == NULL && m_entries.GetCount() >= SJ_ADVSEARCHCACHE_MAX )
+	{
+		long id, oldestId = 0;
+		SjAdvSearchCacheEntry* oldest = NULL;
 		SjHashIterator iterator;
-		while( (trackIdsHash.Iterate(iterator, &selectedTrackId)) ) {
-			wantedIndex--;
-			if( wantedIndex < 0 ) {
-				break;
+		while( (entry=(SjAdvSearchCacheEntry*)m_entries.Iterate(iterator, &id)) )
+		{
+			if( oldest == NULL || entry->m_lastUsed < oldest->m_lastUsed )
+			{
+				oldest = entry;
+				oldestId = id;
 			}
 		}
+		entry = (SjAdvSearchCacheEntry*)m_entries.Remove(oldestId);
 	}
+	delete entry;
 
-	// get URL for this track ID, may be empty
-	return g_mainFrame->m_libraryModule->GetUrl(selectedTrackId);
+	// add the result
+	entry = new SjAdvSearchCacheEntry;
+	entry->m_search     = search;
+	entry->m_ids        = ids;
+	entry->m_stat       = stat;
+	entry->m_sql        = sql;
+	entry->m_deps       = deps;
+	entry->m_lastUsed   = ++m_lastUsed;
+	entry->m_validUntil = 0;
+	if( deps & SJ_SEARCHDEP_NOW_ )
+	{
+		entry->m_validUntil = (long)wxDateTime::Now().GetTicks() + 60;
+	}
+	else if( deps & SJ_SEARCHDEP_TODAY_ )
+	{
+		entry->m_validUntil = (long)(wxDateTime::Today() + wxDateSpan::Day()).GetTicks();
+	}
+	m_entries.Insert(search.m_id, entry);
 }
 
 
@@ -279,8 +279,8 @@ public:
 	// (internally, the IDs are stored in a string as ",123,456,78," (note the commas at start/end!)
 	long            GetInclExclCount    () const;
 	wxString        GetInclExclDescr    () const;
-	void            RemoveFromInclExcl  (SjLLHash* ids);
-	void            AddToInclExcl       (SjLLHash* ids);
+	void            RemoveFromInclExcl  (const SjIdSet* ids);
+	void            AddToInclExcl       (const SjIdSet* ids);
 	void            AddToInclExcl       (const wxString& idsToAdd);
 
 private:
@@ -298,6 +298,7 @@ private:
 
 	friend class    SjRuleControls;
 	friend class    SjAdvSearch;
+	friend class    SjTrackIndex;
 };
 
 
@@ -339,13 +340,13 @@ public:
 
 	// including/excluding IDs,
 	// returns the first changed rule or -1 if nothing is changed
-	long            IncludeExclude      (SjLLHash* ids, int action);
+	long            IncludeExclude      (const SjIdSet* ids, int action);
 
 	// Get the advanved search as simple conditions for an SQL statement.
-	// The given hash MAY be used in combination with the SQL-Function INFILTER()
-	// which queries the hash and must be provided by the caller.
+	// The given set MAY be used in combination with the SQL-Function INFILTER()
+	// which queries the set and must be provided by the caller.
 	// Normally, the function returns sth. like "(1)", "(0)" or "INFILTER(tracks.id)"
-	SjSearchStat    GetAsSql            (SjLLHash*, wxString&) const;
+	SjSearchStat    GetAsSql            (SjIdSet*, wxString&) const;
 
 	// Get concrete URLs
 	wxString        GetRandomUrl        () const;
@@ -369,9 +370,55 @@ private:
 
 	void            CopyFrom            (const SjAdvSearch& o);
 	bool            IsEqualTo           (const SjAdvSearch& o) const;
+	SjSearchStat    GetAsSql__          (SjIdSet*, wxString&) const;
 
 	friend class    SjAdvSearchDialog;
 	friend class    SjAdvSearchModule;
+	friend class    SjTrackIndex;
+	friend class    SjAdvSearchCache;
+};
+
+
+
+/*******************************************************************************
+ * SjAdvSearchCache
+ ******************************************************************************/
+
+
+
+// what may invalidate the result of an advanced search
+#define SJ_SEARCHDEP_TAGS       0x01L // any field not listed below
+#define SJ_SEARCHDEP_RATING     0x02L
+#define SJ_SEARCHDEP_PLAYBACK   0x04L // timesplayed, lastplayed, autovol, playtime
+#define SJ_SEARCHDEP_ALL        0xFFL
+
+
+
+class SjAdvSearchCacheEntry;
+
+
+
+class SjAdvSearchCache
+{
+public:
+	// The cache holds the results of the saved advanced searches; results
+	// are forgotten if a field the search depends on is modified; searches
+	// on relative dates are re-evaluated after a minute or at midnight.
+	                SjAdvSearchCache    ();
+	                ~SjAdvSearchCache   () { Clear(); }
+
+	// forget the results depending on the given SJ_SEARCHDEP_* flags
+	void            Invalidate          (long deps = SJ_SEARCHDEP_ALL);
+
+private:
+	SjLPHash        m_entries; // search ID -> SjAdvSearchCacheEntry
+	bool            m_enabled;
+	unsigned long   m_lastUsed;
+	void            Clear               ();
+	bool            Lookup              (const SjAdvSearch&, SjIdSet* retIds, SjSearchStat& retStat, wxString& retSql);
+	void            Add                 (const SjAdvSearch&, const SjIdSet& ids, const SjSearchStat& stat, const wxString& sql);
+	static long     GetDeps             (const SjAdvSearch&);
+	friend class    SjAdvSearch;
 };
 
 
@@ -0,0 +1,1017 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2016 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    trackindex.cpp
+ * Authors: Björn Petersen
+ * Purpose: Column store of the tracks table for advanced searches
+ *
+ ******************************************************************************/
+
+
+#include <sjbase/base.h>
+#include <sjbase/trackindex.h>
+#include <wx/tokenzr.h>
+
+
+/*******************************************************************************
+ * Columns
+ ******************************************************************************/
+
+
+static const SjField s_numFields[SJ_TI_NUM_COLS] =
+{
+	SJ_FIELD_TIMEADDED, SJ_FIELD_TIMEMODIFIED, SJ_FIELD_TIMESPLAYED, SJ_FIELD_LASTPLAYED,
+	SJ_FIELD_DATABYTES, SJ_FIELD_BITRATE, SJ_FIELD_SAMPLERATE, SJ_FIELD_CHANNELS,
+	SJ_FIELD_PLAYTIME, SJ_FIELD_AUTOVOL, SJ_FIELD_TRACKNR, SJ_FIELD_TRACKCOUNT,
+	SJ_FIELD_DISKNR, SJ_FIELD_DISKCOUNT, SJ_FIELD_BEATSPERMINUTE, SJ_FIELD_RATING,
+	SJ_FIELD_YEAR
+};
+
+
+static const SjField s_strFields[SJ_TI_STR_COLS] =
+{
+	SJ_FIELD_TRACKNAME, SJ_FIELD_LEADARTISTNAME, SJ_FIELD_ORGARTISTNAME, SJ_FIELD_COMPOSERNAME,
+	SJ_FIELD_ALBUMNAME, SJ_FIELD_GENRENAME, SJ_FIELD_GROUPNAME
+};
+
+
+int SjTrackIndex::GetNumCol(SjField field)
+{
+	for( int c = 0; c < SJ_TI_NUM_COLS; c++ )
+	{
+		if( s_numFields[c] == field ) { return c; }
+	}
+	return -1;
+}
+
+
+int SjTrackIndex::GetStrCol(SjField field)
+{
+	for( int c = 0; c < SJ_TI_STR_COLS; c++ )
+	{
+		if( s_strFields[c] == field ) { return c; }
+	}
+	return -1;
+}
+
+
+wxString SjTrackIndex::GetColsSql()
+{
+	wxString ret(wxT("id"));
+	int c;
+	for( c = 0; c < SJ_TI_NUM_COLS; c++ ) { ret += wxT(",") + SjRule::GetFieldDbName(s_numFields[c]); }
+	for( c = 0; c < SJ_TI_STR_COLS; c++ ) { ret += wxT(",") + SjRule::GetFieldDbName(s_strFields[c]); }
+	return ret;
+}
+
+
+/*******************************************************************************
+ * SjTrackIndexDict - the unique strings of a column, stored as UTF-8
+ ******************************************************************************/
+
+
+class SjTrackIndexDict
+{
+public:
+	SjTrackIndexDict()
+	{
+		m_pool = NULL;
+		m_poolUsed = 0;
+		m_poolAlloc = 0;
+		m_sorted = NULL;
+		m_sortedCount = 0;
+		m_sortedAlloc = 0;
+		m_sortedOk = FALSE;
+		sjhashInit(&m_lookup, SJHASH_BINARY, 1/*copyKey*/);
+	}
+
+	~SjTrackIndexDict()
+	{
+		sjhashClear(&m_lookup);
+		free(m_pool);
+		free(m_sorted);
+	}
+
+	long GetCount() const { return m_offsets.GetCount(); }
+	const char* Get(long code) const { return m_pool + m_offsets[code]; }
+
+	long Add(const char* utf8, int bytes)
+	{
+		// returns the code of the string, the string is added if it does not exist;
+		// the number of rows using the string is incremented
+		long code = (long)sjhashFind(&m_lookup, utf8, bytes+1/*incl. null-terminator*/);
+		if( code )
+		{
+			m_refs[code-1]++;
+			return code-1;
+		}
+
+		if( m_poolUsed+bytes+1 > m_poolAlloc )
+		{
+			m_poolAlloc = (m_poolUsed+bytes+1)*2;
+			m_pool = (char*)realloc(m_pool, m_poolAlloc);
+		}
+		memcpy(m_pool+m_poolUsed, utf8, bytes);
+		m_pool[m_poolUsed+bytes] = 0;
+		m_offsets.Add(m_poolUsed);
+		m_refs.Add(1);
+		m_poolUsed += bytes+1;
+
+		code = m_offsets.GetCount();
+		sjhashInsert(&m_lookup, utf8, bytes+1, (void*)code);
+
+		if( m_sortedOk )
+		{
+			AddSorted(code-1);
+		}
+
+		return code-1;
+	}
+
+	void Release(long code)
+	{
+		// strings no longer used are kept, they are just skipped by the name lookups
+		m_refs[code]--;
+	}
+
+	// the codes in case-insensitive order, built on first use and updated by Add()
+	bool Sort()
+	{
+		if( !m_sortedOk )
+		{
+			long count = GetCount(), code;
+			m_folded.Empty();
+			m_folded.Alloc(count);
+			for( code = 0; code < count; code++ )
+			{
+				m_folded.Add(wxString::FromUTF8(Get(code)).Lower());
+			}
+
+			m_sortedAlloc = count+64;
+			m_sorted = (long*)realloc(m_sorted, m_sortedAlloc*sizeof(long));
+			if( m_sorted == NULL )
+			{
+				return FALSE;
+			}
+			for( code = 0; code < count; code++ )
+			{
+				m_sorted[code] = code;
+			}
+			m_sortedCount = count;
+
+			s_sortingDict = this;
+			qsort(m_sorted, m_sortedCount, sizeof(long), CompareCodes);
+			s_sortingDict = NULL;
+
+			m_sortedOk = TRUE;
+		}
+		return TRUE;
+	}
+
+	long GetSortedCount() const { return m_sortedCount; }
+	long GetSorted(long i) const { return m_sorted[i]; }
+	const wxString& GetFolded(long code) const { return m_folded[code]; }
+	long GetRefs(long code) const { return m_refs[code]; }
+
+	long FindSorted(const wxString& folded) const
+	{
+		// returns the index of the first string not less than the given one
+		long lo = 0, hi = m_sortedCount, mid;
+		while( lo < hi )
+		{
+			mid = (lo+hi)/2;
+			if( m_folded[m_sorted[mid]].Cmp(folded) < 0 )
+				lo = mid+1;
+			else
+				hi = mid;
+		}
+		return lo;
+	}
+
+private:
+	char*           m_pool;
+	long            m_poolUsed;
+	long            m_poolAlloc;
+	wxArrayLong     m_offsets;
+	wxArrayLong     m_refs;   // number of rows using a code
+	sjhash          m_lookup; // UTF-8 -> code + 1
+
+	long*           m_sorted;
+	long            m_sortedCount;
+	long            m_sortedAlloc;
+	bool            m_sortedOk;
+	wxArrayString   m_folded; // code -> lower-case string, only valid if m_sortedOk is set
+
+	int Compare(long code1, long code2) const
+	{
+		// case-insensitive; only names that differ just in case are sorted by their bytes.
+		// this is not sqlite's BINARY order, where all upper-case names come first
+		int ret = m_folded[code1].Cmp(m_folded[code2]);
+		return ret? ret : strcmp(Get(code1), Get(code2));
+	}
+
+	static SjTrackIndexDict* s_sortingDict;
+	static int CompareCodes(const void* p1, const void* p2)
+	{
+		return s_sortingDict->Compare(*((long*)p1), *((long*)p2));
+	}
+
+	void AddSorted(long code)
+	{
+		m_folded.Add(wxString::FromUTF8(Get(code)).Lower());
+
+		if( m_sortedCount >= m_sortedAlloc )
+		{
+			long* newSorted = (long*)realloc(m_sorted, (m_sortedAlloc*2+64)*sizeof(long));
+			if( newSorted == NULL )
+			{
+				m_sortedOk = FALSE; // sort again on next use
+				return;
+			}
+			m_sorted = newSorted;
+			m_sortedAlloc = m_sortedAlloc*2+64;
+		}
+
+		long lo = 0, hi = m_sortedCount, mid;
+		while( lo < hi )
+		{
+			mid = (lo+hi)/2;
+			if( Compare(m_sorted[mid], code) < 0 )
+				lo = mid+1;
+			else
+				hi = mid;
+		}
+
+		memmove(&m_sorted[lo+1], &m_sorted[lo], (m_sortedCount-lo)*sizeof(long));
+		m_sorted[lo] = code;
+		m_sortedCount++;
+	}
+};
+
+
+SjTrackIndexDict* SjTrackIndexDict::s_sortingDict = NULL;
+
+
+/*******************************************************************************
+ * SjTrackIndexCond - the result of a condition in SQL's three-valued logic
+ ******************************************************************************/
+
+
+class SjTrackIndexCond
+{
+public:
+	// rows in m_true match the condition, rows in m_false do not; rows in
+	// none of them are NULL (unknown).  Unused bits are always zero.
+	SjTrackIndexCond(long rows)
+	{
+		m_rows  = rows;
+		m_words = (rows+31)/32;
+		m_true  = (uint32_t*)calloc(m_words+1, sizeof(uint32_t));
+		m_false = (uint32_t*)calloc(m_words+1, sizeof(uint32_t));
+	}
+
+	~SjTrackIndexCond()
+	{
+		free(m_true);
+		free(m_false);
+	}
+
+	void Clear()
+	{
+		// all rows are NULL
+		memset(m_true, 0, m_words*sizeof(uint32_t));
+		memset(m_false, 0, m_words*sizeof(uint32_t));
+	}
+
+	void SetAll(bool value)
+	{
+		Clear();
+		uint32_t* set = value? m_true : m_false;
+		if( m_words )
+		{
+			memset(set, 0xFF, m_words*sizeof(uint32_t));
+			if( m_rows&31 ) { set[m_words-1] = (1U<<(m_rows&31))-1; }
+		}
+	}
+
+	void Set(long row, bool value)
+	{
+		uint32_t bit = 1U<<(row&31);
+		(value? m_true : m_false)[row>>5] |= bit;
+		(value? m_false : m_true)[row>>5] &= ~bit;
+	}
+
+	bool IsTrue(long row) const { return (m_true[row>>5] & (1U<<(row&31)))!=0; }
+
+	void And(const SjTrackIndexCond& o)
+	{
+		for( long w = 0; w < m_words; w++ ) { m_true[w] &= o.m_true[w]; m_false[w] |= o.m_false[w]; }
+	}
+
+	void Or(const SjTrackIndexCond& o)
+	{
+		for( long w = 0; w < m_words; w++ ) { m_true[w] |= o.m_true[w]; m_false[w] &= o.m_false[w]; }
+	}
+
+	void Not()
+	{
+		uint32_t* temp = m_true; m_true = m_false; m_false = temp;
+	}
+
+private:
+	long            m_rows;
+	long            m_words;
+	uint32_t*       m_true;
+	uint32_t*       m_false;
+
+	                SjTrackIndexCond    (const SjTrackIndexCond&);
+	void            operator =          (const SjTrackIndexCond&);
+};
+
+
+/*******************************************************************************
+ * SjTrackIndex - loading
+ ******************************************************************************/
+
+
+SjTrackIndex::SjTrackIndex()
+{
+	m_enabled  = g_tools->m_config->Read(wxT("main/idxMemSearch"), 1L)!=0;
+	m_valid    = FALSE;
+	m_rowCount = 0;
+	m_ids      = NULL;
+	for( int c = 0; c < SJ_TI_NUM_COLS; c++ ) { m_num[c] = NULL; m_numOk[c] = FALSE; }
+	for( int c = 0; c < SJ_TI_STR_COLS; c++ ) { m_str[c] = NULL; m_dict[c] = NULL; }
+}
+
+
+SjTrackIndex::~SjTrackIndex()
+{
+	Clear();
+}
+
+
+void SjTrackIndex::Clear()
+{
+	free(m_ids);
+	m_ids = NULL;
+	for( int c = 0; c < SJ_TI_NUM_COLS; c++ ) { free(m_num[c]); m_num[c] = NULL; }
+	for( int c = 0; c < SJ_TI_STR_COLS; c++ ) { free(m_str[c]); m_str[c] = NULL; delete m_dict[c]; m_dict[c] = NULL; }
+	m_idToRow.Clear();
+	m_pendingIds.Clear();
+	m_pendingUrls.Clear();
+	m_rowCount = 0;
+	m_valid = FALSE;
+}
+
+
+void SjTrackIndex::ReadRow(wxSqlt& sql, long row, bool reread)
+{
+	// the fields are as returned by GetColsSql(); if reread is set, the row
+	// was read before and the old strings are released
+	int c, f = 1, bytes;
+	for( c = 0; c < SJ_TI_NUM_COLS; c++, f++ )
+	{
+		switch( sql.GetType(f) )
+		{
+			case SQLITE_NULL:
+				m_num[c][row] = SJ_TI_NULL;
+				break;
+
+			case SQLITE_INTEGER:
+				{
+					double d = sql.GetDouble(f);
+					if( d > (double)SJ_TI_NULL && d <= 2147483647.0 )
+					{
+						m_num[c][row] = (int32_t)sql.GetLong(f);
+						break;
+					}
+				}
+				// fall through, the value does not fit into the column
+
+			default:
+				// text or real numbers in numeric columns are compared differently by sqlite
+				m_num[c][row] = SJ_TI_NULL;
+				m_numOk[c] = FALSE;
+				break;
+		}
+	}
+
+	for( c = 0; c < SJ_TI_STR_COLS; c++, f++ )
+	{
+		if( reread && m_str[c][row] != -1 )
+		{
+			m_dict[c]->Release(m_str[c][row]);
+		}
+
+		if( sql.GetType(f) == SQLITE_NULL )
+		{
+			m_str[c][row] = -1;
+		}
+		else
+		{
+			const char* utf8 = sql.GetUtf8Ptr(f, &bytes);
+			m_str[c][row] = m_dict[c]->Add(utf8? utf8 : "", utf8? bytes : 0);
+		}
+	}
+}
+
+
+bool SjTrackIndex::Load()
+{
+	if( m_valid )
+	{
+		if( m_pendingIds.GetCount() == 0 && m_pendingUrls.IsEmpty() )
+		{
+			return TRUE; // up to date
+		}
+		else if( m_pendingIds.GetCount()+(long)m_pendingUrls.GetCount() < m_rowCount/16+64 && LoadPending() )
+		{
+			return TRUE; // few tracks changed
+		}
+	}
+
+	// (re-)load the complete index
+	SJ_STALL_SCOPE("SjTrackIndex::Load");
+	unsigned long startMs = SjTools::GetMsTicks();
+	Clear();
+
+	wxSqlt sql;
+	sql.Query(wxT("SELECT COUNT(*) FROM tracks;"));
+	long rowAlloc = sql.Next()? sql.GetLong(0) : 0;
+
+	m_ids = (int32_t*)malloc((rowAlloc+1)*sizeof(int32_t));
+	for( int c = 0; c < SJ_TI_NUM_COLS; c++ ) { m_num[c] = (int32_t*)malloc((rowAlloc+1)*sizeof(int32_t)); m_numOk[c] = TRUE; }
+	for( int c = 0; c < SJ_TI_STR_COLS; c++ ) { m_str[c] = (int32_t*)malloc((rowAlloc+1)*sizeof(int32_t)); m_dict[c] = new SjTrackIndexDict(); }
+
+	sql.Query(wxT("SELECT ") + GetColsSql() + wxT(" FROM tracks ORDER BY id;"));
+	while( sql.Next() )
+	{
+		if( m_rowCount >= rowAlloc )
+		{
+			Clear();
+			return FALSE; // the table has changed in between; should not happen
+		}
+
+		m_ids[m_rowCount] = sql.GetLong(0);
+		m_idToRow.Insert(m_ids[m_rowCount], m_rowCount+1);
+		ReadRow(sql, m_rowCount, FALSE);
+		m_rowCount++;
+	}
+
+	m_valid = TRUE;
+	wxLogDebug(wxT("%i tracks loaded to the search index in %i ms"), (int)m_rowCount, (int)(SjTools::GetMsTicks()-startMs));
+	return TRUE;
+}
+
+
+bool SjTrackIndex::LoadPending()
+{
+	// re-read the changed tracks; returns FALSE if tracks were added or deleted
+	wxSqlt sql;
+	long trackId, row;
+
+	SjIdSetIterator iterator;
+	while( m_pendingIds.Iterate(iterator, &trackId) )
+	{
+		row = m_idToRow.Lookup(trackId)-1;
+		sql.Query(wxT("SELECT ") + GetColsSql() + wxT(" FROM tracks WHERE id=") + sql.LParam(trackId) + wxT(";"));
+		if( row < 0 || !sql.Next() )
+		{
+			return FALSE;
+		}
+		ReadRow(sql, row, TRUE);
+	}
+	m_pendingIds.Clear();
+
+	size_t i, iCount = m_pendingUrls.GetCount();
+	for( i = 0; i < iCount; i++ )
+	{
+		sql.Query(wxT("SELECT ") + GetColsSql() + wxT(" FROM tracks WHERE url='") + sql.QParam(m_pendingUrls[i]) + wxT("';"));
+		while( sql.Next() )
+		{
+			row = m_idToRow.Lookup(sql.GetLong(0))-1;
+			if( row < 0 )
+			{
+				return FALSE;
+			}
+			ReadRow(sql, row, TRUE);
+		}
+	}
+	m_pendingUrls.Clear();
+
+	return TRUE;
+}
+
+
+/*******************************************************************************
+ * SjTrackIndex - names
+ ******************************************************************************/
+
+
+SjTrackIndexDict* SjTrackIndex::GetSortedDict(SjField field)
+{
+	wxASSERT( wxThread::IsMain() );
+
+	int col = GetStrCol(field);
+	if( !m_enabled || col < 0 || !Load() || !m_dict[col]->Sort() )
+	{
+		return NULL;
+	}
+
+	return m_dict[col];
+}
+
+
+bool SjTrackIndex::GetFirstName(SjField field, const wxString& prefix, wxString& ret)
+{
+	SjTrackIndexDict* dict = GetSortedDict(field);
+	if( dict == NULL )
+	{
+		return FALSE;
+	}
+
+	ret.Empty();
+
+	wxString folded = prefix.Lower();
+	long i, code, count = dict->GetSortedCount();
+	for( i = dict->FindSorted(folded); i < count; i++ )
+	{
+		code = dict->GetSorted(i);
+		if( !dict->GetFolded(code).StartsWith(folded) )
+		{
+			break; // no more names with this prefix
+		}
+
+		if( dict->GetRefs(code) > 0 )
+		{
+			ret = wxString::FromUTF8(dict->Get(code));
+			break;
+		}
+	}
+
+	return TRUE;
+}
+
+
+bool SjTrackIndex::GetNames(SjField field, wxArrayString& ret)
+{
+	SjTrackIndexDict* dict = GetSortedDict(field);
+	if( dict == NULL )
+	{
+		return FALSE;
+	}
+
+	wxString name;
+	long i, code, count = dict->GetSortedCount();
+	for( i = 0; i < count; i++ )
+	{
+		code = dict->GetSorted(i);
+		if( dict->GetRefs(code) > 0 )
+		{
+			name = wxString::FromUTF8(dict->Get(code));
+			name.Trim(TRUE);
+			name.Trim(FALSE);
+			if( !name.IsEmpty()
+			 && ret.Index(name) == wxNOT_FOUND )
+			{
+				ret.Add(name);
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+
+/*******************************************************************************
+ * SjTrackIndex - searching
+ ******************************************************************************/
+
+
+bool SjTrackIndex::Search(const SjAdvSearch& adv, SjIdSet* retIds)
+{
+	wxASSERT( wxThread::IsMain() );
+
+	// check the search, this is the same as in SjAdvSearch::GetAsSql()
+	if( !m_enabled
+	 || adv.m_selectScope != SJ_SELECTSCOPE_TRACKS )
+	{
+		return FALSE;
+	}
+
+	size_t r, rCount = adv.m_rules.GetCount();
+	for( r = 0; r < rCount; r++ )
+	{
+		if( adv.m_rules[r].m_field == SJ_PSEUDOFIELD_LIMIT )
+		{
+			return FALSE;
+		}
+	}
+
+	if( !Load() )
+	{
+		return FALSE;
+	}
+
+	// evaluate all rules and combine them as in SjAdvSearch::GetAsSql()
+	SjTrackIndexCond where(m_rowCount), incl(m_rowCount), excl(m_rowCount), ruleCond(m_rowCount);
+	bool whereSet = FALSE, inclSet = FALSE, exclSet = FALSE;
+	for( r = 0; r < rCount; r++ )
+	{
+		const SjRule& rule = adv.m_rules[r];
+		if( !EvalRule(rule, ruleCond) )
+		{
+			return FALSE;
+		}
+
+		if( rule.m_field == SJ_PSEUDOFIELD_INCLUDE )
+		{
+			if( inclSet ) { incl.Or(ruleCond); } else { incl.SetAll(FALSE); incl.Or(ruleCond); inclSet = TRUE; }
+		}
+		else if( rule.m_field == SJ_PSEUDOFIELD_EXCLUDE )
+		{
+			if( exclSet ) { excl.And(ruleCond); } else { excl.SetAll(TRUE); excl.And(ruleCond); exclSet = TRUE; }
+		}
+		else if( !whereSet )
+		{
+			where.SetAll(adv.m_selectOp==SJ_SELECTOP_ALL);
+			if( adv.m_selectOp==SJ_SELECTOP_ALL ) { where.And(ruleCond); } else { where.Or(ruleCond); }
+			whereSet = TRUE;
+		}
+		else
+		{
+			if( adv.m_selectOp==SJ_SELECTOP_ALL ) { where.And(ruleCond); } else { where.Or(ruleCond); }
+		}
+	}
+
+	if( inclSet )
+	{
+		if( whereSet ) { where.Or(incl); } else { where.SetAll(FALSE); where.Or(incl); whereSet = TRUE; }
+	}
+
+	if( exclSet )
+	{
+		if( whereSet ) { where.And(excl); } else { where.SetAll(TRUE); where.And(excl); whereSet = TRUE; }
+	}
+
+	if( !whereSet )
+	{
+		where.SetAll(TRUE); // no WHERE clause
+	}
+	else if( adv.m_selectOp == SJ_SELECTOP_NONE )
+	{
+		where.Not();
+	}
+
+	// collect the track IDs, the rows are sorted by the IDs, so they're
+	// just appended to the set
+	for( long row = 0; row < m_rowCount; row++ )
+	{
+		if( where.IsTrue(row) )
+		{
+			retIds->Insert(m_ids[row]);
+		}
+	}
+
+	return TRUE;
+}
+
+
+bool SjTrackIndex::EvalRule(const SjRule& rule, SjTrackIndexCond& ret)
+{
+	// this is the same as SjRule::GetAsSql()
+	switch( rule.m_field )
+	{
+		case SJ_PSEUDOFIELD_INCLUDE:
+		case SJ_PSEUDOFIELD_EXCLUDE:
+			if( rule.GetInclExclCount() == 0 )
+			{
+				ret.SetAll(rule.m_field == SJ_PSEUDOFIELD_EXCLUDE);
+			}
+			else
+			{
+				EvalIds(rule.m_value[0], ret);
+				if( rule.m_field == SJ_PSEUDOFIELD_EXCLUDE ) { ret.Not(); }
+			}
+			return TRUE;
+
+		case SJ_PSEUDOFIELD_TRACKARTISTALBUM:
+			{
+				SjTrackIndexCond temp(m_rowCount);
+				if( !EvalValue(rule.m_value[0], SJ_FIELD_TRACKNAME, rule.m_op, rule.m_unit, FALSE, FALSE, ret) ) { return FALSE; }
+				if( !EvalValue(rule.m_value[0], SJ_FIELD_LEADARTISTNAME, rule.m_op, rule.m_unit, FALSE, FALSE, temp) ) { return FALSE; }
+				ret.Or(temp);
+				if( !EvalValue(rule.m_value[0], SJ_FIELD_ALBUMNAME, rule.m_op, rule.m_unit, FALSE, FALSE, temp) ) { return FALSE; }
+				ret.Or(temp);
+			}
+			return TRUE;
+
+		case SJ_PSEUDOFIELD_LIMIT:
+		case SJ_PSEUDOFIELD_SQL:
+			return FALSE;
+
+		default:
+			if( rule.m_op == SJ_FIELDOP_IS_NOT_IN_RANGE || rule.m_op == SJ_FIELDOP_IS_IN_RANGE )
+			{
+				bool inRange = (rule.m_op == SJ_FIELDOP_IS_IN_RANGE);
+				SjTrackIndexCond temp(m_rowCount);
+				if( !EvalValue(rule.m_value[0], rule.m_field, inRange? SJ_FIELDOP_IS_GREATER_OR_EQUAL : SJ_FIELDOP_IS_LESS_THAN, rule.m_unit, FALSE, FALSE, ret) ) { return FALSE; }
+				if( !EvalValue(rule.m_value[1], rule.m_field, inRange? SJ_FIELDOP_IS_LESS_OR_EQUAL : SJ_FIELDOP_IS_GREATER_THAN, rule.m_unit, FALSE, FALSE, temp) ) { return FALSE; }
+				if( inRange ) { ret.And(temp); } else { ret.Or(temp); }
+				return TRUE;
+			}
+			return EvalValue(rule.m_value[0], rule.m_field, rule.m_op, rule.m_unit, TRUE/*force that the value is set, if needed*/, FALSE, ret);
+	}
+}
+
+
+bool SjTrackIndex::EvalValue(const wxString& value__, SjField field, SjFieldOp op, SjUnit unit,
+                             bool forceSet, bool recursiveCall, SjTrackIndexCond& ret)
+{
+	// this is the same as SjRule::GetAsSql(value, field, ...), however, instead
+	// of SQL, we evaluate the condition directly
+	wxString    value(value__);
+	long        fieldType = SjRule::GetFieldType(field);
+	long        longValue = 0;
+	bool        forceNumberSet = FALSE;
+	int         numCol = GetNumCol(field);
+	int         strCol = GetStrCol(field);
+
+	if( op == SJ_FIELDOP_IS_SET || op == SJ_FIELDOP_IS_UNSET )
+	{
+		// set/unset
+		op = (op==SJ_FIELDOP_IS_SET)? SJ_FIELDOP_IS_UNEQUAL_TO : SJ_FIELDOP_IS_EQUAL_TO;
+		if( strCol >= 0 ) { return EvalStr(strCol, op, wxT(""), ret); }
+		if( numCol >= 0 ) { return EvalNum(numCol, op, 0, FALSE, ret); }
+		return FALSE;
+	}
+	else if( strCol >= 0 )
+	{
+		// string, used as given
+		return EvalStr(strCol, op, value, ret);
+	}
+	else if( numCol < 0 || !m_numOk[numCol] )
+	{
+		// not in the index
+		return FALSE;
+	}
+	else if( field == SJ_FIELD_DATABYTES )
+	{
+		SjTools::ParseNumber(value, &longValue);
+		     if( unit == SJ_UNIT_KB ) { longValue *= 1024; }
+		else if( unit == SJ_UNIT_MB ) { longValue *= 1024*1024; }
+		else if( unit == SJ_UNIT_GB ) { longValue *= 1024*1024*1024; }
+		longValue = (int)longValue;
+		if( longValue != 0 ) { forceNumberSet = TRUE; }
+	}
+	else if( field == SJ_FIELD_YEAR )
+	{
+		SjTools::ParseYear(value, &longValue);
+		longValue = (int)longValue;
+		if( longValue != 0 ) { forceNumberSet = TRUE; }
+	}
+	else if( field == SJ_FIELD_PLAYTIME )
+	{
+		if( unit == SJ_UNIT_MINUTES )
+		{
+			SjTools::ParseTime(value, &longValue);
+		}
+		else
+		{
+			SjTools::ParseNumber(value, &longValue);
+		}
+		longValue = (int)(longValue*1000);
+		if( longValue != 0 ) { forceNumberSet = TRUE; }
+	}
+	else if(  fieldType == SJ_FIELDTYPE_DATE
+	      && (op==SJ_FIELDOP_IS_IN_THE_LAST || op==SJ_FIELDOP_IS_NOT_IN_THE_LAST) )
+	{
+		// convert relative date value to absolute value
+		SjTools::ParseNumber(value, &longValue);
+		op = op==SJ_FIELDOP_IS_IN_THE_LAST? SJ_FIELDOP_IS_GREATER_OR_EQUAL : SJ_FIELDOP_IS_LESS_THAN;
+		switch( unit )
+		{
+			case SJ_UNIT_MINUTES:   return EvalValue(wxString::Format(wxT("now -%i"), (int)longValue), field, op, unit, forceSet, TRUE, ret);
+			case SJ_UNIT_HOURS:     return EvalValue(wxString::Format(wxT("now -%i"), (int)longValue*60), field, op, unit, forceSet, TRUE, ret);
+			default:                return EvalValue(wxString::Format(wxT("today -%i"), (int)longValue), field, op, unit, forceSet, TRUE, ret);
+		}
+	}
+	else if( fieldType == SJ_FIELDTYPE_DATE )
+	{
+		// convert absolute date/time value to a timestamp as done by TIMESTAMP()
+		bool timeSet;
+		if( !SjTools::ParseDate_(value, !recursiveCall, NULL, &timeSet) )
+		{
+			return FALSE;
+		}
+
+		if( !timeSet )
+		{
+			if( op == SJ_FIELDOP_IS_EQUAL_TO || op == SJ_FIELDOP_IS_UNEQUAL_TO )
+			{
+				// convert a concrete date to a timespan
+				bool equal = (op == SJ_FIELDOP_IS_EQUAL_TO);
+				SjTrackIndexCond temp(m_rowCount);
+				if( !EvalValue(value, field, equal? SJ_FIELDOP_IS_GREATER_OR_EQUAL : SJ_FIELDOP_IS_LESS_THAN, unit, FALSE, TRUE, ret) ) { return FALSE; }
+				if( !EvalValue(value+wxT(" +1"), field, equal? SJ_FIELDOP_IS_LESS_THAN : SJ_FIELDOP_IS_GREATER_OR_EQUAL, unit, FALSE, TRUE, temp) ) { return FALSE; }
+				if( equal ) { ret.And(temp); } else { ret.Or(temp); }
+				return TRUE;
+			}
+			else if( op == SJ_FIELDOP_IS_LESS_OR_EQUAL || op == SJ_FIELDOP_IS_GREATER_THAN )
+			{
+				// move time to end of the day for "less or equal" or for "greater than"
+				value += wxT(" 23:59:59");
+			}
+		}
+
+		forceNumberSet = TRUE;
+
+		wxDateTime dateTime;
+		if( !SjTools::ParseDate_(value, FALSE, &dateTime) )
+		{
+			return FALSE; // TIMESTAMP() would fail
+		}
+		longValue = (int)dateTime.GetAsDOS();
+	}
+	else if( fieldType == SJ_FIELDTYPE_NUMBER )
+	{
+		SjTools::ParseNumber(value, &longValue);
+		longValue = (int)longValue;
+		if( longValue != 0 && field != SJ_FIELD_TIMESPLAYED ) { forceNumberSet = TRUE; }
+	}
+	else
+	{
+		return FALSE;
+	}
+
+	return EvalNum(numCol, op, longValue, (forceSet&&forceNumberSet), ret);
+}
+
+
+bool SjTrackIndex::EvalNum(int col, SjFieldOp op, long value__, bool forceNumberSet, SjTrackIndexCond& ret)
+{
+	// the same as SjRule::GetAsSql(field, op, forceNumberSet); comparisons
+	// with NULL are neither TRUE nor FALSE
+	if( !m_numOk[col] )
+	{
+		return FALSE;
+	}
+
+	const int32_t* v = m_num[col];
+	int32_t value = (int32_t)value__;
+	long row;
+
+	ret.Clear();
+	#define SJ_TI_SCAN(cond) \
+		for( row = 0; row < m_rowCount; row++ ) \
+		{ \
+			if( v[row] != SJ_TI_NULL ) { ret.Set(row, (cond)); } \
+		}
+
+	switch( op )
+	{
+		case SJ_FIELDOP_IS_EQUAL_TO:         SJ_TI_SCAN(v[row]==value); break;
+		case SJ_FIELDOP_IS_UNEQUAL_TO:       SJ_TI_SCAN(v[row]!=value); break;
+		case SJ_FIELDOP_IS_GREATER_THAN:     SJ_TI_SCAN(v[row]>value); break;
+		case SJ_FIELDOP_IS_GREATER_OR_EQUAL: SJ_TI_SCAN(v[row]>=value); break;
+		case SJ_FIELDOP_IS_LESS_THAN:        if( forceNumberSet ) { SJ_TI_SCAN(v[row]!=0 && v[row]<value); } else { SJ_TI_SCAN(v[row]<value); } break;
+		case SJ_FIELDOP_IS_LESS_OR_EQUAL:    if( forceNumberSet ) { SJ_TI_SCAN(v[row]!=0 && v[row]<=value); } else { SJ_TI_SCAN(v[row]<=value); } break;
+		default:                             return FALSE;
+	}
+
+	return TRUE;
+}
+
+
+static bool SjTrackIndexLike(const char* str, const char* pattern, size_t patternLen, SjFieldOp op)
+{
+	// the same as sqlite's LIKE: case-insensitive for ASCII characters only;
+	// the pattern is expected to be in lower case
+	size_t strLen = strlen(str), i, j;
+	if( strLen < patternLen )
+	{
+		return FALSE;
+	}
+
+	size_t first = 0, last = strLen-patternLen;
+	if( op == SJ_FIELDOP_STARTS_WITH ) { last = 0; }
+	if( op == SJ_FIELDOP_ENDS_WITH )   { first = last; }
+
+	for( i = first; i <= last; i++ )
+	{
+		for( j = 0; j < patternLen; j++ )
+		{
+			char c = str[i+j];
+			if( c >= 'A' && c <= 'Z' ) { c += 'a'-'A'; }
+			if( c != pattern[j] ) { break; }
+		}
+
+		if( j == patternLen )
+		{
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+
+bool SjTrackIndex::EvalStr(int col, SjFieldOp op, const wxString& value, SjTrackIndexCond& ret)
+{
+	// the same as SjRule::GetAsSql(field, op, forceNumberSet) for strings;
+	// we check every string in the dictionary once and scan the rows then
+	WXSTRING_TO_SQLITE3(value)
+	size_t valueLen = strlen(valueSqlite3Str);
+
+	bool negate = FALSE;
+	switch( op )
+	{
+		case SJ_FIELDOP_IS_UNEQUAL_TO:       negate = TRUE; op = SJ_FIELDOP_IS_EQUAL_TO; break;
+		case SJ_FIELDOP_DOES_NOT_CONTAIN:    negate = TRUE; op = SJ_FIELDOP_CONTAINS; break;
+		case SJ_FIELDOP_DOES_NOT_START_WITH: negate = TRUE; op = SJ_FIELDOP_STARTS_WITH; break;
+		case SJ_FIELDOP_DOES_NOT_END_WITH:   negate = TRUE; op = SJ_FIELDOP_ENDS_WITH; break;
+		case SJ_FIELDOP_IS_EQUAL_TO:
+		case SJ_FIELDOP_CONTAINS:
+		case SJ_FIELDOP_STARTS_WITH:
+		case SJ_FIELDOP_ENDS_WITH:           break;
+		default:                             return FALSE;
+	}
+
+	wxCharBuffer pattern(valueLen);
+	if( op != SJ_FIELDOP_IS_EQUAL_TO )
+	{
+		// LIKE: wildcards in the value are not supported
+		if( strchr(valueSqlite3Str, '%') || strchr(valueSqlite3Str, '_') )
+		{
+			return FALSE;
+		}
+
+		for( size_t i = 0; i <= valueLen; i++ )
+		{
+			char c = valueSqlite3Str[i];
+			if( c >= 'A' && c <= 'Z' ) { c += 'a'-'A'; }
+			pattern.data()[i] = c;
+		}
+	}
+
+	// check the dictionary
+	const SjTrackIndexDict* dict = m_dict[col];
+	long code, codeCount = dict->GetCount();
+	wxCharBuffer matches(codeCount);
+	for( code = 0; code < codeCount; code++ )
+	{
+		bool match = (op == SJ_FIELDOP_IS_EQUAL_TO)?
+		             (strcmp(dict->Get(code), valueSqlite3Str)==0) :
+		             SjTrackIndexLike(dict->Get(code), pattern.data(), valueLen, op);
+		matches.data()[code] = (match!=negate)? 1 : 0;
+	}
+
+	// scan the rows
+	const int32_t* v = m_str[col];
+	ret.Clear();
+	for( long row = 0; row < m_rowCount; row++ )
+	{
+		if( v[row] >= 0 )
+		{
+			ret.Set(row, matches.data()[v[row]]!=0);
+		}
+	}
+
+	return TRUE;
+}
+
+
+void SjTrackIndex::EvalIds(const wxString& ids, SjTrackIndexCond& ret)
+{
+	// the IDs are given as ",123,456,"; tracks not in the IDs are FALSE
+	ret.SetAll(FALSE);
+
+	wxStringTokenizer tkz(ids, wxT(","), wxTOKEN_STRTOK);
+	while( tkz.HasMoreTokens() )
+	{
+		long trackId, row;
+		if( tkz.GetNextToken().ToLong(&trackId) && (row=m_idToRow.Lookup(trackId)-1) >= 0 )
+		{
+			ret.Set(row, TRUE);
+		}
+	}
+}
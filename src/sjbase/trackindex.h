@@ -0,0 +1,111 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2016 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    trackindex.h
+ * Authors: Björn Petersen
+ * Purpose: Column store of the tracks table for advanced searches
+ *
+ ******************************************************************************/
+
+
+#ifndef __SJ_TRACKINDEX_H__
+#define __SJ_TRACKINDEX_H__
+
+
+class SjTrackIndexCond;
+class SjTrackIndexDict;
+
+
+// SjTrackIndex holds the numeric and the name columns of the tracks table in
+// memory, one array per column; the names are stored as indices into a
+// dictionary of unique strings.  With this, most rules of an advanced search
+// can be evaluated by simple scans over one or two columns instead of an SQL
+// query calling TIMESTAMP() etc. for every track.
+//
+// Search() returns FALSE for searches it cannot evaluate (limits, album scope,
+// SQL expressions, file types, queue positions, similarity, comments and file
+// names); SjAdvSearch::GetAsSql() uses SQL then.  The result is always the
+// same as with SQL, including NULL values.
+//
+// The index is loaded on first use.  Changes to the tracks table must be
+// reported by Invalidate() or InvalidateTrack(), changed tracks are re-read
+// on the next search.
+class SjTrackIndex
+{
+public:
+	                SjTrackIndex        ();
+	                ~SjTrackIndex       ();
+
+	// report changes
+	void            Invalidate          () { m_valid = FALSE; }
+	void            InvalidateTrack     (long trackId) { if( m_valid ) { m_pendingIds.Insert(trackId); } }
+	void            InvalidateTrack     (const wxString& url) { if( m_valid ) { m_pendingUrls.Add(url); } }
+
+	// evaluate the given advanced search, on success the track IDs are
+	// added to the given set.
+	bool            Search              (const SjAdvSearch&, SjIdSet* retIds);
+
+	// the names of the track, artist, album, genre and group columns, sorted
+	// case-insensitive; new names are added as they are read, so these calls
+	// are fast after the first one.  GetFirstName() sets ret to the first name
+	// starting with the given prefix in this case-insensitive order (so for
+	// "the", "the band" comes before "The Beatles") or to an empty string.  Both functions
+	// return FALSE if the index cannot be used; the caller should use SQL then.
+	bool            GetFirstName        (SjField, const wxString& prefix, wxString& ret);
+	bool            GetNames            (SjField, wxArrayString& ret);
+
+private:
+	// the columns, the row index is not the track ID
+	#define         SJ_TI_NUM_COLS      17
+	#define         SJ_TI_STR_COLS      7
+	#define         SJ_TI_NULL          ((int32_t)0x80000000L) // NULL in numeric columns; in string columns, -1 is used
+	bool            m_enabled;
+	bool            m_valid;
+	long            m_rowCount;
+	int32_t*        m_ids;
+	SjLLHash        m_idToRow;  // track ID -> row index + 1
+	int32_t*        m_num[SJ_TI_NUM_COLS];
+	bool            m_numOk[SJ_TI_NUM_COLS]; // FALSE if a value does not fit into the column, searches use SQL then
+	int32_t*        m_str[SJ_TI_STR_COLS];
+	SjTrackIndexDict* m_dict[SJ_TI_STR_COLS];
+	static int      GetNumCol           (SjField);
+	static int      GetStrCol           (SjField);
+	static wxString GetColsSql          ();
+
+	// loading
+	SjIdSet         m_pendingIds;
+	wxArrayString   m_pendingUrls;
+	void            Clear               ();
+	bool            Load                ();
+	bool            LoadPending         ();
+	void            ReadRow             (wxSqlt&, long row, bool reread);
+	SjTrackIndexDict* GetSortedDict     (SjField);
+
+	// evaluation
+	bool            EvalRule            (const SjRule&, SjTrackIndexCond&);
+	bool            EvalValue           (const wxString& value, SjField, SjFieldOp, SjUnit, bool forceSet, bool recursiveCall, SjTrackIndexCond&);
+	bool            EvalNum             (int col, SjFieldOp, long value, bool forceNumberSet, SjTrackIndexCond&);
+	bool            EvalStr             (int col, SjFieldOp, const wxString& value, SjTrackIndexCond&);
+	void            EvalIds             (const wxString& ids, SjTrackIndexCond&);
+};
+
+
+#endif // __SJ_TRACKINDEX_H__
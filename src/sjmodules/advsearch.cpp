@@ -1433,11 +1433,11 @@ void SjAdvSearchDialog::OnOpenPlaylistDo(wxCommandEvent& e)
 			allUrls += wxT("'");
 		}
 
-		SjLLHash ids;
+		SjIdSet ids;
 		sql.Query(wxT("SELECT id FROM tracks WHERE url IN (") + allUrls + wxT(");"));
 		while( sql.Next() )
 		{
-			ids.Insert(sql.GetLong(0), 1);
+			ids.Insert(sql.GetLong(0));
 		}
 		// wxLogDebug(wxT(" -- IDs : %s"), ids.GetKeysAsString().c_str());
 
@@ -2117,12 +2117,12 @@ void SjAdvSearchDialog::OnPlay(wxCommandEvent& e)
 	::wxBeginBusyCursor();
 
 	// get all tracks
-	SjLLHash trackIdsHash;
+	SjIdSet  trackIds;
 	wxString selectSql;
 	SjSearchStat stat;
 	{
 		wxBusyCursor busy;
-		stat = advSearch.GetAsSql(&trackIdsHash, selectSql);
+		stat = advSearch.GetAsSql(&trackIds, selectSql);
 	}
 
 	if( stat.m_advResultCount == 0 )
@@ -2134,7 +2134,7 @@ void SjAdvSearchDialog::OnPlay(wxCommandEvent& e)
 
 	// enqueue all tracks
 	wxArrayString urls;
-	g_mainFrame->m_libraryModule->GetOrderedUrlsFromIDs(trackIdsHash, urls);
+	g_mainFrame->m_libraryModule->GetOrderedUrlsFromIDs(trackIds, urls);
 
 	if( e.GetId() == IDT_ENQUEUE_NOW )
 	{
@@ -2451,7 +2451,7 @@ void SjAdvSearchModule::CloseDialog()
 }
 
 
-bool SjAdvSearchModule::IncludeExclude(SjLLHash* ids, bool delPressed)
+bool SjAdvSearchModule::IncludeExclude(const SjIdSet* ids, bool delPressed)
 {
 	// returns TRUE if tracks were deleted from the view of the caller
 	SjAdvSearch         searchToChange;
@@ -2624,13 +2624,13 @@ bool SjAdvSearchModule::DragNDrop(SjDragNDropAction action, wxWindow* windowAtMo
 		 && data->m_fileData )
 		{
 			const wxArrayString& filenames = data->m_fileData->GetFilenames();
-			SjLLHash hash;
+			SjIdSet ids;
 			int i, iCount = filenames.GetCount();
 			for( i = 0; i < iCount; i++ )
 			{
-				hash.Insert(g_mainFrame->m_libraryModule->GetId(filenames.Item(i)), 1);
+				ids.Insert(g_mainFrame->m_libraryModule->GetId(filenames.Item(i)));
 			}
-			IncludeExclude(&hash, FALSE);
+			IncludeExclude(&ids, FALSE);
 		}
 		return TRUE;
 	}
@@ -258,7 +258,7 @@ public:
 	void            OpenDialog          (long preselectId=0);
 	void            CloseDialog         ();
 	bool            IsDialogOpen        () const { return (m_dialog!=NULL); }
-	bool            IncludeExclude      (SjLLHash*, bool delPressed); // returns TRUE if tracks were deleted
+	bool            IncludeExclude      (const SjIdSet*, bool delPressed); // returns TRUE if tracks were deleted
 
 	// functions mainly for the search dialog
 	long            GetSearchCount      () const;
@@ -92,6 +92,11 @@
  *
  *  Test System: Windows 2000, 490 MB RAM, AMD Athlon XP 2400 MHz
  *
+ *  Later, the received tracks are collected and written in batches of
+ *  WRITE_BATCH tracks using compiled statements with bound parameters (see
+ *  SjLibraryTrackWriter), so that importing large collections is no longer
+ *  slowed down by formatting and parsing SQL for each file.
+ *
  ******************************************************************************/
 
 
@@ -102,12 +107,14 @@
 #include <sjbase/browser.h>
 #include <sjbase/columnmixer.h>
 #include <sjtools/msgbox.h>
+#include <sjtools/console.h>
 #include <sjmodules/library.h>
 #include <sjmodules/kiosk/kiosk.h>
 #include <sjmodules/advsearch.h>
 #include <sjmodules/arteditor.h>
 #include <sjmodules/tageditor/tageditor.h>
 #include <sjmodules/weblinks.h>
+#include <atomic>
 
 
 #define DEFAULT_OMIT_ARTISTS    SjTools::LocaleConfigRead(wxT("__STOP_ARTISTS__"), wxT("the, der, die, die happy, das"))
@@ -123,6 +130,8 @@
 #define MIN_N2                  2
 #define MAX_N2                  99
 
+#define WRITE_BATCH             256 // received tracks written at once, see Callback_ReceiveTrackInfo()
+
 
 #define IDM_DEFAULT             (IDM_FIRSTPRIVATE+16)
 
@@ -415,8 +424,13 @@ SjLibraryModule::SjLibraryModule(SjInterfaceBase* interf)
 	m_name  = _("Combine tracks to albums");
 	m_searchOffsets = NULL;
 	m_searchOffsetsCount = -1; // no search
+	m_searchThread = NULL;
+	m_searchGeneration = 0;
+	m_searchPending = FALSE;
 	m_filterAzFirstHidden = FALSE;
-	m_hiliteRegExOk = false;
+	m_filterFuncDb = NULL;
+	m_pendingTimestamp = 0;
+	m_trackWriter = NULL;
 
 	ForgetRememberedValues();
 }
@@ -549,6 +563,12 @@ bool SjLibraryModule::FirstLoad()
 		}
 	}
 
+	// replace the indexes created above by the ones needed by this version
+	if( !UpdateIndexes() )
+	{
+		return FALSE;
+	}
+
 	// currently not needed, however, this may be useful for future updates of the library
 	if( needsRecombiningAlbums )
 	{
@@ -559,8 +579,146 @@ bool SjLibraryModule::FirstLoad()
 }
 
 
+/* Index updates for existing databases, applied once and in the given order.
+ * The version of the last applied step is stored as "libindexversion" in the
+ * database; never change existing steps, add new ones at the end instead.
+ * CheckQueryPlans() should be adapted if the indexes change.
+ */
+static const struct
+{
+	long            version;
+	const wxChar*   query;
+}
+s_indexUpdates[] =
+{
+	// covering indexes for the album view, the search, the list view and the update
+	{ 1, wxT("CREATE INDEX IF NOT EXISTS tracksindex11 ON tracks (url, updatecrc);") },
+	{ 1, wxT("DROP INDEX IF EXISTS tracksindex01;") },
+	{ 1, wxT("CREATE INDEX IF NOT EXISTS tracksindex12 ON tracks (albumname, albumid, tracknr);") },
+	{ 1, wxT("DROP INDEX IF EXISTS tracksindex07;") },
+	{ 1, wxT("CREATE INDEX IF NOT EXISTS tracksindex13 ON tracks (albumid, disknr, tracknr, trackname, leadartistname, albumname);") },
+	{ 1, wxT("DROP INDEX IF EXISTS tracksindex10;") },
+	{ 1, wxT("CREATE INDEX IF NOT EXISTS tracksindex14 ON tracks (leadartistname, albumname, tracknr, albumid);") },
+	{ 1, wxT("DROP INDEX IF EXISTS tracksindex04;") },
+	{ 1, wxT("CREATE INDEX IF NOT EXISTS albumsindex06 ON albums (url, albumindex);") },
+	{ 1, wxT("DROP INDEX IF EXISTS albumsindex01;") },
+	{ 1, wxT("CREATE INDEX IF NOT EXISTS albumsindex07 ON albums (azfirst, albumindex);") },
+	{ 1, wxT("DROP INDEX IF EXISTS albumsindex04;") },
+	{ 1, wxT("CREATE INDEX IF NOT EXISTS albumsindex08 ON albums (albumindex, az);") },
+	{ 1, wxT("DROP INDEX IF EXISTS albumsindex05;") },
+	{ 0, NULL }
+};
+
+
+bool SjLibraryModule::UpdateIndexes()
+{
+	wxSqlt  sql;
+	long    currVersion = sql.ConfigRead(wxT("libindexversion"), 0L);
+	int     i;
+
+	for( i = 0; s_indexUpdates[i].query; i++ )
+	{
+		if( s_indexUpdates[i].version > currVersion )
+		{
+			break;
+		}
+	}
+
+	if( s_indexUpdates[i].query == NULL )
+	{
+		return TRUE; // nothing to do
+	}
+
+	// creating the indexes may take a moment for larger libraries;
+	// on errors, the transaction is rolled back and we'll try over on the next start
+	wxBusyCursor busy;
+	wxSqltTransaction transaction;
+	for( ; s_indexUpdates[i].query; i++ )
+	{
+		if( !sql.Query(s_indexUpdates[i].query) )
+		{
+			return FALSE;
+		}
+		currVersion = s_indexUpdates[i].version;
+	}
+
+	// the version is written together with the indexes by Commit()
+	sql.ConfigWrite(wxT("libindexversion"), currVersion);
+	transaction.Commit();
+	return TRUE;
+}
+
+
+long SjLibraryModule::CheckQueryPlans()
+{
+	// the most frequently used queries in the forms used by the code below;
+	// reading a table completely is okay if this is done using an index
+	// (eg. for sorting all tracks in the list view), but not by a full table scan
+	static const wxChar* hotQueries[] =
+	{
+		// GetCol__(), GetMaskedColIndexByAz() and friends
+		wxT("SELECT id, leadartistname, albumname, az, azfirst, artidauto, artiduser, url FROM albums WHERE albumindex=1;"),
+		wxT("SELECT az FROM albums WHERE albumindex=1;"),
+		wxT("SELECT albumindex FROM albums WHERE azfirst=97;"),
+		wxT("SELECT albumindex FROM albums WHERE url='';"),
+		wxT("SELECT albumindex FROM albums WHERE id=1;"),
+		wxT("SELECT id, albumname, trackname, leadartistname, orgartistname, composername, year, tracknr, playtimems, url, disknr, comment, genrename, rating FROM tracks WHERE albumid=1 ORDER BY disknr, tracknr, trackname, id;"),
+		// PrepareSearchJob()
+		wxT("SELECT tracks.id,albumindex FROM tracks, albums WHERE (trackname LIKE '%a%' OR tracks.leadartistname LIKE '%a%' OR tracks.albumname LIKE '%a%') AND albums.id=albumid ORDER BY albumindex;"),
+		// GetOrderedUrlsFromIDs()
+		wxT("SELECT tracks.url FROM tracks, albums WHERE tracks.id IN(1,2) AND albums.id=albumid ORDER BY albums.albumindex, disknr, tracknr, tracks.id;"),
+		// SjLibraryListView::ChangeOrder() for the default orders
+		wxT("SELECT id, albumId FROM tracks WHERE id IN (1,2) ORDER BY sortable(albumName,23), albumId, trackNr;"),
+		wxT("SELECT id, albumId FROM tracks ORDER BY sortable(albumName,23), albumId, trackNr;"),
+		wxT("SELECT id, albumId FROM tracks ORDER BY sortable(leadArtistName,15), albumName, trackNr;"),
+		// SjLibraryTrackWriter
+		wxT("SELECT id, updatecrc FROM tracks WHERE url='';"),
+		wxT("SELECT id, rating, groupName, timesplayed, lastplayed, timemodified, autovol, playtimems, genrename FROM tracks WHERE url='';"),
+		wxT("SELECT id FROM arts WHERE url='';"),
+		NULL
+	};
+
+	wxSqlt  sql;
+	long    fullScans = 0;
+	int     i;
+
+	for( i = 0; hotQueries[i]; i++ )
+	{
+		if( !sql.Query(wxString(wxT("EXPLAIN QUERY PLAN ")) + hotQueries[i]) )
+		{
+			fullScans++;
+			continue;
+		}
+
+		while( sql.Next() )
+		{
+			// the detail is the last column, eg. "SCAN tracks USING COVERING INDEX tracksindex12";
+			// older versions of sqlite write "SCAN TABLE tracks ..."
+			wxString detail = sql.GetString(sql.GetFieldCount()-1);
+			if( detail.StartsWith(wxT("SCAN ")) && detail.Find(wxT(" USING ")) == wxNOT_FOUND )
+			{
+				wxLogWarning(wxT("Testdrive: Full table scan \"%s\" for \"%s\"."), detail.c_str(), hotQueries[i]);
+				fullScans++;
+			}
+		}
+	}
+
+	return fullScans;
+}
+
+
 void SjLibraryModule::LastUnload()
 {
+	FlushTrackInfos(FALSE);
+	FreeTrackWriter();
+
+	if( m_searchThread )
+	{
+		m_searchThread->Shutdown();
+		delete m_searchThread;
+		m_searchThread = NULL;
+	}
+
 	if( m_searchOffsets )
 	{
 		free(m_searchOffsets);
@@ -577,10 +735,191 @@ void SjLibraryModule::LastUnload()
  ******************************************************************************/
 
 
-bool SjLibraryModule::WriteTrackInfo(SjTrackInfo* t, long trackId, bool writeArtIds)
+// SjLibraryTrackWriter keeps the statements needed to write received tracks
+// compiled; the object should only live while updating the library as the
+// statements cannot be used after the database schema has changed.
+class SjLibraryTrackWriter
 {
-	wxSqlt sql;
+public:
+	                SjLibraryTrackWriter();
+
+	// get the ID of the track with the given URL if its update CRC matches
+	// the given one, returns 0 otherwise
+	long            GetUnchangedId      (const wxString& url, uint32_t actualCrc);
+
+	// get the ID of the track with the URL from the given track info and
+	// preserve some old values in it; if there is no such track, a new
+	// record is inserted and isNew is set to TRUE.  Returns 0 on errors.
+	long            GetTrackId          (SjTrackInfo*, unsigned long timeAdded, bool& isNew);
+
+	// write the given track info to the record with the given ID
+	bool            Write               (SjTrackInfo*, long trackId, bool writeArtIds);
+
+private:
+	long            GetArtId            (const wxString& url);
+
+	wxSqlt          m_selectCrc,
+	                m_selectTrack,
+	                m_insertTrack,
+	                m_selectArt,
+	                m_insertArt,
+	                m_selectArtIds,
+	                m_updateTrack,
+	                m_updateUrl;
+};
+
+
+SjLibraryTrackWriter::SjLibraryTrackWriter()
+{
+	// we're not writing autovol here; this is done in PlaybackDone()
+	m_selectCrc     .Prepare(wxT("SELECT id, updatecrc FROM tracks WHERE url=?;"));
+	m_selectTrack   .Prepare(wxT("SELECT id, rating, groupName, timesplayed, lastplayed, timemodified, autovol, playtimems, genrename FROM tracks WHERE url=?;"));
+	m_insertTrack   .Prepare(wxT("INSERT INTO tracks (url, timeadded, timemodified) VALUES (?, ?, 0);"));
+	m_selectArt     .Prepare(wxT("SELECT id FROM arts WHERE url=?;"));
+	m_insertArt     .Prepare(wxT("INSERT INTO arts (url) VALUES (?);"));
+	m_selectArtIds  .Prepare(wxT("SELECT artids FROM tracks WHERE id=?;"));
+	m_updateTrack   .Prepare(wxT("UPDATE tracks SET ")
+	                         wxT("updatecrc=?, timemodified=?, lastplayed=?, timesplayed=?, databytes=?, ")
+	                         wxT("bitrate=?, samplerate=?, channels=?, playtimems=?, trackname=?, ")
+	                         wxT("tracknr=?, trackcount=?, disknr=?, diskcount=?, leadartistname=?, ")
+	                         wxT("orgartistname=?, composername=?, albumname=?, genrename=?, groupname=?, ")
+	                         wxT("comment=?, beatsperminute=?, rating=?, year=?, artids=? ")
+	                         wxT("WHERE id=?;"));
+	m_updateUrl     .Prepare(wxT("UPDATE tracks SET url=? WHERE id=?;"));
+}
+
+
+long SjLibraryTrackWriter::GetUnchangedId(const wxString& url, uint32_t actualCrc)
+{
+	long trackId = 0;
+
+	m_selectCrc.Reset();
+	m_selectCrc.Bind(1, url);
+	if( m_selectCrc.Execute() && m_selectCrc.Next() )
+	{
+		if( (uint32_t)m_selectCrc.GetLong(1) == actualCrc )
+		{
+			trackId = m_selectCrc.GetLong(0);
+		}
+	}
+
+	m_selectCrc.Reset();
+	return trackId;
+}
+
+
+long SjLibraryTrackWriter::GetTrackId(SjTrackInfo* trackInfo, unsigned long timeAdded, bool& isNew)
+{
+	long trackId = 0;
+
+	isNew = FALSE;
+
+	m_selectTrack.Reset();
+	m_selectTrack.Bind(1, trackInfo->m_url);
+	if( !m_selectTrack.Execute() )
+	{
+		return 0; // error, we do not insert the track as it may already exist
+	}
+
+	if( m_selectTrack.Next() )
+	{
+		trackId = m_selectTrack.GetLong(0);
+
+		// preserve rating, if new is unset
+		if( trackInfo->m_rating == 0 )
+		{
+			trackInfo->m_rating = m_selectTrack.GetLong(1);
+		}
+
+		// preserve old group name, if new is unset
+		if( trackInfo->m_groupName.IsEmpty() )
+		{
+			trackInfo->m_groupName = m_selectTrack.GetString(2);
+		}
+
+		// preserve old genre name, if new is unset, new in 2.52beta2, see http://www.silverjuke.net/forum/privmsg.php?mode=quote&p=202
+		if( trackInfo->m_genreName.IsEmpty() )
+		{
+			trackInfo->m_genreName = m_selectTrack.GetString(8);
+		}
+
+		// preserve old times played, if larger
+		unsigned long old_timesPlayed = m_selectTrack.GetLong(3);
+		if( trackInfo->m_timesPlayed < old_timesPlayed )
+		{
+			trackInfo->m_timesPlayed =  old_timesPlayed;
+		}
+
+		// preserve old last played, if it is larger
+		unsigned long old_lastPlayed = m_selectTrack.GetLong(4);
+		if( trackInfo->m_lastPlayed < old_lastPlayed )
+		{
+			trackInfo->m_lastPlayed = old_lastPlayed;
+		}
 
+		// always preserve old modification date
+		trackInfo->m_timeModified = m_selectTrack.GetLong(5);
+
+		// preserve old volume information, always use the old value if set
+		// (I think we make it better ;-)
+		long old_autoVol = m_selectTrack.GetLong(6);
+		if( old_autoVol )
+		{
+			trackInfo->m_autoVol = old_autoVol;
+		}
+
+		// preserved old playing time, if new is unset
+		if( trackInfo->m_playtimeMs <= 0 )
+		{
+			trackInfo->m_playtimeMs = m_selectTrack.GetLong(7);
+		}
+	}
+	m_selectTrack.Reset();
+
+	if( trackId == 0 )
+	{
+		m_insertTrack.Reset();
+		m_insertTrack.Bind(1, trackInfo->m_url);
+		m_insertTrack.Bind(2, (long)timeAdded);
+		if( m_insertTrack.Execute() )
+		{
+			trackId = m_insertTrack.GetInsertId();
+			isNew = TRUE;
+		}
+	}
+
+	return trackId;
+}
+
+
+long SjLibraryTrackWriter::GetArtId(const wxString& url)
+{
+	long artId = 0;
+
+	m_selectArt.Reset();
+	m_selectArt.Bind(1, url);
+	if( m_selectArt.Execute() && m_selectArt.Next() )
+	{
+		artId = m_selectArt.GetLong(0);
+	}
+	m_selectArt.Reset();
+
+	if( artId == 0 )
+	{
+		m_insertArt.Reset();
+		m_insertArt.Bind(1, url);
+		if( m_insertArt.Execute() )
+		{
+			artId = m_insertArt.GetInsertId();
+		}
+	}
+
+	return artId;
+}
+
+
+bool SjLibraryTrackWriter::Write(SjTrackInfo* t, long trackId, bool writeArtIds)
+{
 	wxASSERT(trackId>0);
 
 	wxString artIds;
@@ -589,25 +928,12 @@ bool SjLibraryModule::WriteTrackInfo(SjTrackInfo* t, long trackId, bool writeArt
 		// get art IDs
 		wxStringTokenizer tkz(t->m_arts, wxT("\n"));
 		wxString currArt;
-		long     currArtId;
 		while( tkz.HasMoreTokens() )
 		{
 			currArt = tkz.GetNextToken();
 			if( !currArt.IsEmpty() )
 			{
-				currArtId = 0;
-				sql.Query(wxT("SELECT id FROM arts WHERE url='") + sql.QParam(currArt) + wxT("';"));
-				if( sql.Next() )
-				{
-					currArtId = sql.GetLong(0);
-				}
-				else
-				{
-					sql.Query(wxT("INSERT INTO arts (url) VALUES ('") + sql.QParam(currArt) + wxT("');"));
-					currArtId = sql.GetInsertId();
-				}
-
-				artIds << wxString::Format(wxT("%i "), (int)currArtId);
+				artIds << wxString::Format(wxT("%i "), (int)GetArtId(currArt));
 			}
 		}
 
@@ -616,44 +942,44 @@ bool SjLibraryModule::WriteTrackInfo(SjTrackInfo* t, long trackId, bool writeArt
 	else
 	{
 		// preserve art IDs
-		sql.Query(wxString::Format(wxT("SELECT artids FROM tracks WHERE id=%lu;"), trackId));
-		if( sql.Next() )
+		m_selectArtIds.Reset();
+		m_selectArtIds.Bind(1, trackId);
+		if( m_selectArtIds.Execute() && m_selectArtIds.Next() )
 		{
-			artIds = sql.GetString(0);
+			artIds = m_selectArtIds.GetString(0);
 		}
+		m_selectArtIds.Reset();
 	}
 
 	// write track data
-	// we're not writing autovol here; this is done in PlaybackDone()
-
-	if( !sql.Query(
-	            wxT("UPDATE tracks SET ")
-	            wxT("updatecrc=")       + sql.UParam(t->m_updatecrc)        + wxT(", ")
-	            wxT("timemodified=")    + sql.UParam(t->m_timeModified)     + wxT(", ")
-	            wxT("lastplayed=")      + sql.UParam(t->m_lastPlayed)       + wxT(", ")
-	            wxT("timesplayed=")     + sql.UParam(t->m_timesPlayed)      + wxT(", ")
-	            wxT("databytes=")       + sql.UParam(t->m_dataBytes)        + wxT(", ")
-	            wxT("bitrate=")         + sql.UParam(t->m_bitrate)          + wxT(", ")
-	            wxT("samplerate=")      + sql.UParam(t->m_samplerate)       + wxT(", ")
-	            wxT("channels=")        + sql.UParam(t->m_channels)         + wxT(", ")
-	            wxT("playtimems=")      + sql.UParam(t->m_playtimeMs)       + wxT(", ")
-	            wxT("trackname='")      + sql.QParam(t->m_trackName)        + wxT("', ")
-	            wxT("tracknr=")         + sql.UParam(t->m_trackNr)          + wxT(", ")
-	            wxT("trackcount=")      + sql.UParam(t->m_trackCount)       + wxT(", ")
-	            wxT("disknr=")          + sql.UParam(t->m_diskNr)           + wxT(", ")
-	            wxT("diskcount=")       + sql.UParam(t->m_diskCount)        + wxT(", ")
-	            wxT("leadartistname='") + sql.QParam(t->m_leadArtistName)   + wxT("', ")
-	            wxT("orgartistname='")  + sql.QParam(t->m_orgArtistName)    + wxT("', ")
-	            wxT("composername='")   + sql.QParam(t->m_composerName)     + wxT("', ")
-	            wxT("albumname='")      + sql.QParam(t->m_albumName)        + wxT("', ")
-	            wxT("genrename='")      + sql.QParam(t->m_genreName)        + wxT("', ")
-	            wxT("groupname='")      + sql.QParam(t->m_groupName)        + wxT("', ")
-	            wxT("comment='")        + sql.QParam(t->m_comment)          + wxT("', ")
-	            wxT("beatsperminute=")  + sql.UParam(t->m_beatsPerMinute)   + wxT(", ")
-	            wxT("rating=")          + sql.UParam(t->m_rating)           + wxT(", ")
-	            wxT("year=")            + sql.UParam(t->m_year)             + wxT(", ")
-	            wxT("artids='")         + artIds                            + wxT("' ")
-	            wxT(" WHERE id=") + sql.UParam(trackId) + wxT(";")) )
+	m_updateTrack.Reset();
+	m_updateTrack.Bind( 1, (long)t->m_updatecrc);
+	m_updateTrack.Bind( 2, (long)t->m_timeModified);
+	m_updateTrack.Bind( 3, (long)t->m_lastPlayed);
+	m_updateTrack.Bind( 4, (long)t->m_timesPlayed);
+	m_updateTrack.Bind( 5, t->m_dataBytes);
+	m_updateTrack.Bind( 6, t->m_bitrate);
+	m_updateTrack.Bind( 7, t->m_samplerate);
+	m_updateTrack.Bind( 8, t->m_channels);
+	m_updateTrack.Bind( 9, t->m_playtimeMs);
+	m_updateTrack.Bind(10, t->m_trackName);
+	m_updateTrack.Bind(11, t->m_trackNr);
+	m_updateTrack.Bind(12, t->m_trackCount);
+	m_updateTrack.Bind(13, t->m_diskNr);
+	m_updateTrack.Bind(14, t->m_diskCount);
+	m_updateTrack.Bind(15, t->m_leadArtistName);
+	m_updateTrack.Bind(16, t->m_orgArtistName);
+	m_updateTrack.Bind(17, t->m_composerName);
+	m_updateTrack.Bind(18, t->m_albumName);
+	m_updateTrack.Bind(19, t->m_genreName);
+	m_updateTrack.Bind(20, t->m_groupName);
+	m_updateTrack.Bind(21, t->m_comment);
+	m_updateTrack.Bind(22, t->m_beatsPerMinute);
+	m_updateTrack.Bind(23, t->m_rating);
+	m_updateTrack.Bind(24, t->m_year);
+	m_updateTrack.Bind(25, artIds);
+	m_updateTrack.Bind(26, trackId);
+	if( !m_updateTrack.Execute() )
 	{
 		return FALSE;
 	}
@@ -661,13 +987,130 @@ bool SjLibraryModule::WriteTrackInfo(SjTrackInfo* t, long trackId, bool writeArt
 	// update the URL?
 	if( t->m_validFields & SJ_TI_URL )
 	{
-		sql.Query(wxT("UPDATE tracks SET url='") + sql.QParam(t->m_url) + wxT("' WHERE id=") + sql.UParam(trackId) + wxT(";"));
+		m_updateUrl.Reset();
+		m_updateUrl.Bind(1, t->m_url);
+		m_updateUrl.Bind(2, trackId);
+		m_updateUrl.Execute();
 	}
 
 	return TRUE;
 }
 
 
+SjLibraryTrackWriter* SjLibraryModule::GetTrackWriter()
+{
+	if( m_trackWriter == NULL )
+	{
+		m_trackWriter = new SjLibraryTrackWriter();
+	}
+	return m_trackWriter;
+}
+
+
+void SjLibraryModule::FreeTrackWriter()
+{
+	// the statements must be finalized before the update transaction is committed
+	if( m_trackWriter )
+	{
+		delete m_trackWriter;
+		m_trackWriter = NULL;
+	}
+}
+
+
+bool SjLibraryModule::WriteTrackInfo(SjTrackInfo* t, long trackId, bool writeArtIds)
+{
+	// outside of an update (eg. from the tag editor), the writer is not kept
+	bool freeWriter = (m_trackWriter == NULL);
+	bool ok = GetTrackWriter()->Write(t, trackId, writeArtIds);
+	if( freeWriter )
+	{
+		FreeTrackWriter();
+	}
+
+	if( !ok )
+	{
+		return FALSE;
+	}
+
+	m_trackIndex.InvalidateTrack(trackId);
+	m_advSearchCache.Invalidate();
+	return TRUE;
+}
+
+
+bool SjLibraryModule::WriteTrackInfos(const wxArrayPtrVoid& trackInfos)
+{
+	// insert or update all given tracks; the IDs are added to m_updatedTracks.
+	// errors on single tracks are logged, but do not stop the other tracks.
+	SjLibraryTrackWriter* writer = GetTrackWriter();
+	SjTrackInfo*    trackInfo;
+	long            trackId;
+	bool            isNew, anyNew = FALSE, ret = TRUE;
+	size_t          i, count = trackInfos.GetCount();
+
+	wxSqltTransaction transaction; // nested into the update transaction, if any
+	for( i = 0; i < count; i++ )
+	{
+		trackInfo = (SjTrackInfo*)trackInfos.Item(i);
+
+		trackId = writer->GetTrackId(trackInfo, m_updateStartingTime, isNew);
+		if( trackId == 0 )
+		{
+			ret = FALSE;
+			continue;
+		}
+
+		m_updatedTracks.Insert(trackId);
+		if( isNew )
+		{
+			anyNew = TRUE;
+		}
+
+		if( !writer->Write(trackInfo, trackId, TRUE) )
+		{
+			ret = FALSE;
+			continue;
+		}
+
+		m_trackIndex.InvalidateTrack(trackId);
+	}
+	transaction.Commit();
+
+	if( anyNew )
+	{
+		m_trackIndex.Invalidate();
+	}
+
+	if( count )
+	{
+		m_advSearchCache.Invalidate();
+	}
+
+	return ret;
+}
+
+
+bool SjLibraryModule::FlushTrackInfos(bool write)
+{
+	bool ret = TRUE;
+
+	if( write && m_pendingTrackInfos.GetCount() )
+	{
+		ret = WriteTrackInfos(m_pendingTrackInfos);
+	}
+
+	size_t i, count = m_pendingTrackInfos.GetCount();
+	for( i = 0; i < count; i++ )
+	{
+		delete (SjTrackInfo*)m_pendingTrackInfos.Item(i);
+	}
+	m_pendingTrackInfos.Clear();
+
+	return ret;
+}
+
+
 bool SjLibraryModule::Callback_MarkAsUpdated(const wxString& urlBegin, long checkTrackCount)
 {
 	if( !m_deepUpdate && checkTrackCount > 0 )
@@ -680,7 +1123,7 @@ bool SjLibraryModule::Callback_MarkAsUpdated(const wxString& urlBegin, long chec
 			sql.Query(wxT("SELECT id FROM tracks WHERE url LIKE '") + sql.QParam(urlBegin) + wxT("%'"));
 			while( sql.Next() )
 			{
-				m_updatedTracks.Add(sql.GetLong(0));
+				m_updatedTracks.Insert(sql.GetLong(0));
 			}
 
 			return TRUE;
@@ -694,16 +1137,11 @@ bool SjLibraryModule::Callback_CheckTrackInfo(const wxString& url, uint32_t actu
 {
 	if( !m_deepUpdate )
 	{
-		wxSqlt sql;
-
-		sql.Query(wxT("SELECT id, updatecrc FROM tracks WHERE url='") + sql.QParam(url) + wxT("'"));
-		if( sql.Next() )
+		long trackId = GetTrackWriter()->GetUnchangedId(url, actualCrc);
+		if( trackId )
 		{
-			if( (uint32_t)sql.GetLong(1) == actualCrc )
-			{
-				m_updatedTracks.Add(sql.GetLong(0));
-				return TRUE;
-			}
+			m_updatedTracks.Insert(trackId);
+			return TRUE;
 		}
 	}
 
@@ -713,87 +1151,14 @@ bool SjLibraryModule::Callback_CheckTrackInfo(const wxString& url, uint32_t actu
 
 bool SjLibraryModule::Callback_ReceiveTrackInfo(SjTrackInfo* trackInfo)
 {
-	// insert track info if needed, wxSqlt is local for early destructor call
-	long trackId;
-	{
-		wxSqlt sql;
-		sql.Query(  wxT("SELECT id, rating, groupName, timesplayed, lastplayed, timemodified, autovol, playtimems, genrename FROM tracks WHERE url='") + sql.QParam(trackInfo->m_url) + wxT("';"));
-		if( sql.Next() )
-		{
-			trackId = sql.GetLong(0);
-
-			// preserve rating, if new is unset
-			if( trackInfo->m_rating == 0 )
-			{
-				trackInfo->m_rating = sql.GetLong(1);
-			}
-
-			// preserve old group name, if new is unset
-			if( trackInfo->m_groupName.IsEmpty() )
-			{
-				trackInfo->m_groupName = sql.GetString(2);
-			}
-
-			// preserve old genre name, if new is unset, new in 2.52beta2, see http://www.silverjuke.net/forum/privmsg.php?mode=quote&p=202
-			if( trackInfo->m_genreName.IsEmpty() )
-			{
-				trackInfo->m_genreName = sql.GetString(8);
-			}
-
-			// preserve old times played, if larger
-			unsigned long old_timesPlayed = sql.GetLong(3);
-			if( trackInfo->m_timesPlayed < old_timesPlayed )
-			{
-				trackInfo->m_timesPlayed =  old_timesPlayed;
-			}
-
-			// preserve old last played, if it is larger
-			unsigned long old_lastPlayed = sql.GetLong(4);
-			if( trackInfo->m_lastPlayed < old_lastPlayed )
-			{
-				trackInfo->m_lastPlayed = old_lastPlayed;
-			}
-
-			// always preserve old modification date
-			trackInfo->m_timeModified = sql.GetLong(5);
-
-			// preserve old volume information, always use the old value if set
-			// (I think we make it better ;-)
-			long old_autoVol = sql.GetLong(6);
-			if( old_autoVol )
-			{
-				trackInfo->m_autoVol = old_autoVol;
-			}
-
-			// preserved old playing time, if new is unset
-			if( trackInfo->m_playtimeMs <= 0 )
-			{
-				trackInfo->m_playtimeMs = sql.GetLong(7);
-			}
-		}
-		else
-		{
-			if( !sql.Query(wxT("INSERT INTO tracks (url, timeadded, timemodified) VALUES ('") + sql.QParam(trackInfo->m_url) + wxT("', ") + sql.UParam(m_updateStartingTime) + wxT(", 0);")) )
-			{
-				delete trackInfo;
-				return TRUE; // error, but continue
-			}
-
-			trackId = sql.GetInsertId();
-		}
-	}   /* sql deleted */
-
-	m_updatedTracks.Add(trackId);
-
-	// update track info
-	if( !WriteTrackInfo(trackInfo, trackId) )
+	// the track info is written together with the next ones, see FlushTrackInfos();
+	// errors on single tracks are logged, but do not stop the update
+	m_pendingTrackInfos.Add(trackInfo);
+	if( m_pendingTrackInfos.GetCount() >= WRITE_BATCH )
 	{
-		delete trackInfo;
-		return TRUE; // error, but continue
+		FlushTrackInfos(TRUE);
 	}
 
-	// success
-	delete trackInfo;
 	return TRUE;
 }
 
@@ -807,6 +1172,7 @@ bool SjLibraryModule::UpdateAllCol(wxWindow* parent, bool deepUpdate)
 	m_updateStartingTime    = wxDateTime::Now().GetAsDOS();
 
 	m_updatedTracks.Clear();
+	FlushTrackInfos(FALSE);
 	SavePendingData();
 	ForgetRememberedValues();
 
@@ -823,6 +1189,8 @@ bool SjLibraryModule::UpdateAllCol(wxWindow* parent, bool deepUpdate)
 
 			if( !scannerModule->IterateTrackInfo(this) )
 			{
+				FlushTrackInfos(FALSE);
+				FreeTrackWriter();
 				return FALSE; // user abort
 			}
 
@@ -833,18 +1201,42 @@ bool SjLibraryModule::UpdateAllCol(wxWindow* parent, bool deepUpdate)
 	// remove non-updated tracks
 	SjBusyInfo::Set(_("Updating music library")+wxString(wxT("...")), TRUE);
 
+	FlushTrackInfos(TRUE);
+	FreeTrackWriter();
+
 	{
-		wxString updatedTracksStr = m_updatedTracks.GetAsString();
-		if( !updatedTracksStr.IsEmpty() )
+		if( m_updatedTracks.GetCount() )
 		{
-			if( !sql.Query(wxT("DELETE FROM tracks WHERE NOT (id IN (") + updatedTracksStr + wxT("));")) )
+			// collect the IDs to delete in memory, this is much faster than
+			// giving a list of all updated IDs to "DELETE ... NOT IN (...)"
+			SjIdSet removedTracks;
+			sql.Query(wxT("SELECT id FROM tracks;"));
+			while( sql.Next() )
 			{
-				return FALSE;
+				removedTracks.Insert(sql.GetLong(0));
 			}
+			removedTracks.AndNot(m_updatedTracks);
 
-			if( sql.GetChangedRows() >= 1000 )
+			if( removedTracks.GetCount() )
 			{
-				transaction.Vacuum();
+				SjIdSetIterator iterator;
+				long            trackId;
+				sql.Prepare(wxT("DELETE FROM tracks WHERE id=?;"));
+				while( removedTracks.Iterate(iterator, &trackId) )
+				{
+					sql.Reset();
+					sql.Bind(1, trackId);
+					if( !sql.Execute() )
+					{
+						return FALSE;
+					}
+				}
+				sql.CloseQuery();
+
+				if( removedTracks.GetCount() >= 1000 )
+				{
+					transaction.Vacuum();
+				}
 			}
 		}
 		else
@@ -858,6 +1250,9 @@ bool SjLibraryModule::UpdateAllCol(wxWindow* parent, bool deepUpdate)
 		}
 	}
 
+	m_trackIndex.Invalidate();
+	m_advSearchCache.Invalidate();
+
 	m_updatedTracks.Clear();
 
 	// update albums, genres and groups
@@ -1203,6 +1598,8 @@ void SjLibraryModule::GetPossibleAlbumArts(long albumId, wxArrayLong& albumArtId
 
 bool SjLibraryModule::CombineTracksToAlbums()
 {
+	SJ_STALL_SCOPE("SjLibraryModule::CombineTracksToAlbums");
+
 	// init
 	bool                    ret = FALSE;
 
@@ -1620,6 +2017,7 @@ bool SjLibraryModule::CombineTracksToAlbums()
 				{
 					sql.Query(wxString::Format(wxT("UPDATE tracks SET albumid=%lu WHERE id=%lu;"),
 					                           albumId, currTrackId));
+					m_advSearchCache.Invalidate(SJ_SEARCHDEP_TAGS);
 				}
 			}
 
@@ -1681,6 +2079,8 @@ bool SjLibraryModule::CombineTracksToAlbums()
 	// cleanup
 Cleanup:
 
+	CancelSearch(); // album indices may have changed
+
 	if( m_searchOffsets )
 	{
 		free(m_searchOffsets); // free as the number of columns may increase, re-set on next search
@@ -1688,7 +2088,7 @@ Cleanup:
 	}
 
 	m_searchOffsetsCount = -1; // no search
-	m_searchTracksHash.Clear();
+	m_searchTrackIds.Clear();
 	m_selectedTrackIds.Clear();
 	UpdateMenuBar();
 
@@ -2130,102 +2530,387 @@ void SjLibraryEditDlg::OnUrlChanged(const wxString& oldUrl, const wxString& newU
 // the change to appear early in the list; this should be
 // true for almost all albums. however, we compare not the
 // number of REAL tracks but the FOUND tracks.
-static long* g_tracksPerAlbum = NULL;
-static int compareOffsets(const void *arg1, const void *arg2)
+
+
+extern "C"
+{
+	static void sqlite_infilter(sqlite3_context* context, int argc, sqlite3_value** argv)
+	{
+		// the user data is the set to check against, this is SjLibraryModule::m_filterIds
+		// for the default connection and a copy owned by the search job for read connections
+		const SjIdSet* filterIds = (const SjIdSet*)sqlite3_user_data(context);
+		sqlite3_result_int(context, filterIds->Lookup(sqlite3_value_int(argv[0]))? 1 : 0);
+	}
+
+	static int sqlite_searchcancel(void* cancel)
+	{
+		// progress handler of the search thread; a non-zero value interrupts the running query
+		return ((std::atomic<bool>*)cancel)->load(std::memory_order_relaxed)? 1 : 0;
+	}
+};
+
+
+class SjLibrarySearchJob
+{
+public:
+	                SjLibrarySearchJob  ();
+	                ~SjLibrarySearchJob ();
+
+	// Run() may be called from any thread; it uses only the given connection
+	// and the members of the job.  If filterIds is set, INFILTER() is
+	// registered for the connection and removed afterwards.  Returns FALSE
+	// on errors or if cancel was set while running; setting cancel also
+	// interrupts the query itself, not only the reading of the results.
+	bool            Run                 (wxSqltDb*, const SjIdSet* filterIds, std::atomic<bool>* cancel);
+
+	// input, set by SjLibraryModule::PrepareSearchJob()
+	SjSearch        m_search;
+	wxString        m_query;
+	bool            m_gatherAzFirst;
+	SjIdSet         m_filterIds;        // only copied for jobs running on a read connection
+	long            m_generation;
+
+	// output, set by Run()
+	bool            m_ok;
+	long*           m_offsets;
+	long            m_offsetsMax;
+	long            m_offsetsCount;
+	SjIdSet         m_trackIds;
+	long            m_azFirst[27];
+	bool            m_azFirstHidden;
+};
+
+
+SjLibrarySearchJob::SjLibrarySearchJob()
 {
-	wxASSERT( g_tracksPerAlbum );
+	m_gatherAzFirst = FALSE;
+	m_generation    = 0;
+	m_ok            = FALSE;
+	m_offsets       = NULL;
+	m_offsetsMax    = 0;
+	m_offsetsCount  = 0;
+	m_azFirstHidden = FALSE;
+
+	int i; for(i=0; i<27; i++) m_azFirst[i] = -1;
+}
+
+
+SjLibrarySearchJob::~SjLibrarySearchJob()
+{
+	if( m_offsets )
+	{
+		free(m_offsets);
+	}
+}
+
+
+bool SjLibrarySearchJob::Run(wxSqltDb* db, const SjIdSet* filterIds, std::atomic<bool>* cancel)
+{
+	wxSqlt  sql(db);
+	long*   tracksPerAlbum;
+	bool    ret = FALSE;
+
+	// allocate memory for the search offsets, the max. number is the number of albums
+	sql.Query(wxT("SELECT COUNT(*) FROM albums;"));
+	m_offsetsMax = sql.GetLong(0);
+	if( m_offsetsMax <= 0 )
+	{
+		return TRUE; // no error but nothing to search for
+	}
+
+	m_offsets = (long*)malloc(sizeof(long)*m_offsetsMax);
+	if( m_offsets == NULL )
+	{
+		return FALSE; // error
+	}
+
+	// allocate temp. memory for the number of tracks per
+	// album and for moving "large" albums to the beginning
+	tracksPerAlbum = (long*)malloc(sizeof(long)*m_offsetsMax);
+	if( tracksPerAlbum == NULL )
+	{
+		return FALSE; // error
+	}
+	memset(tracksPerAlbum, 0, sizeof(long)*m_offsetsMax);
+
+	if( filterIds )
+	{
+		sqlite3_create_function(db->GetDb(), "infilter", 1, SQLITE_ANY, (void*)filterIds, sqlite_infilter, NULL, NULL);
+	}
 
-	long o1 = *((long*)arg1), o2 = *((long*)arg2);
-	long t1 = g_tracksPerAlbum[o1], t2 = g_tracksPerAlbum[o2];
+	if( cancel )
+	{
+		#define SEARCH_CANCEL_CHECK_OPS 1000 // virtual machine instructions between two checks
+		sqlite3_progress_handler(db->GetDb(), SEARCH_CANCEL_CHECK_OPS, sqlite_searchcancel, (void*)cancel);
+	}
 
-	if( t1 >= LARGE_ALBUM && t2 >= LARGE_ALBUM )
+	// query database
 	{
-		return o1-o2;
+		#if 0//def __WXDEBUG__
+				wxString queryDebug__(m_query);
+				queryDebug__.Replace(wxT("%"), wxT("%%"));
+				wxLogDebug(queryDebug__);
+		#endif
+		sql.Query(m_query);
+
+		// go through result:
+		long lastAlbumIndex = -1, thisAlbumIndex;
+		long thisAlbumAz, lastAlbumAz = -1;
+		while( sql.Next() )
+		{
+			if( cancel && cancel->load(std::memory_order_relaxed) )
+			{
+				goto Cleanup; // superseded by another search, the remaining rows are not needed
+			}
+
+			thisAlbumIndex = sql.GetLong(1);
+			wxASSERT( thisAlbumIndex >= lastAlbumIndex );
+
+			if( lastAlbumIndex != thisAlbumIndex )
+			{
+				wxASSERT( m_offsetsCount < m_offsetsMax );
+				if( m_offsetsCount >= m_offsetsMax /*proofe anyway for corrupted databases*/ )
+				{
+					goto Cleanup;
+				}
+
+				m_offsets[m_offsetsCount] = thisAlbumIndex;
+				lastAlbumIndex = thisAlbumIndex;
+
+				if( m_gatherAzFirst )
+				{
+					thisAlbumAz = sql.GetLong(2);
+					wxASSERT( thisAlbumAz >= lastAlbumAz );
+					wxASSERT( thisAlbumAz >= 'a' && thisAlbumAz <= ('z'+1) );
+					if( thisAlbumAz != lastAlbumAz
+					        && thisAlbumAz >= 'a' && thisAlbumAz <= ('z'+1) )
+					{
+						m_azFirst[thisAlbumAz-'a'] = m_offsetsCount;
+						lastAlbumAz = thisAlbumAz;
+					}
+				}
+
+				m_offsetsCount++;
+			}
+
+			wxASSERT( thisAlbumIndex < m_offsetsMax );
+			if( thisAlbumIndex >= 0 && thisAlbumIndex < m_offsetsMax /*proofe anyway for corrupted databases*/ )
+			{
+				tracksPerAlbum[thisAlbumIndex]++;
+			}
+
+			m_trackIds.Insert(sql.GetLong(0));
+		}
 	}
-	else if( t1 >= LARGE_ALBUM )
+
+	// an interrupted query just ends the loop above
+	if( cancel && cancel->load(std::memory_order_relaxed) )
 	{
-		return -1;
+		goto Cleanup;
 	}
-	else if( t2 >= LARGE_ALBUM )
+
+	// Move albums with equal or more than LARGE_ALBUM tracks found to the beginning of the list
+	// (normally these are full albums with matching artist or album names)
+	// However, we do this only if the simple search ist set.
+	// As the offsets are already sorted by the album index, this is a stable partition
+	// that keeps the order within both groups - no need to sort.
+	if( m_search.m_simple.IsSet() )
 	{
-		return 1;
+		long* sorted = (long*)malloc(sizeof(long)*m_offsetsMax);
+		if( sorted == NULL )
+		{
+			goto Cleanup; // error
+		}
+
+		long i, sortedCount = 0, o;
+		for( i = 0; i < m_offsetsCount; i++ )
+		{
+			o = m_offsets[i];
+			if( o >= 0 && o < m_offsetsMax && tracksPerAlbum[o] >= LARGE_ALBUM )
+				sorted[sortedCount++] = o;
+		}
+
+		for( i = 0; i < m_offsetsCount; i++ )
+		{
+			o = m_offsets[i];
+			if( !(o >= 0 && o < m_offsetsMax && tracksPerAlbum[o] >= LARGE_ALBUM) )
+				sorted[sortedCount++] = o;
+		}
+
+		free(m_offsets);
+		m_offsets = sorted;
+	}
+	else if( m_offsetsCount < 20 )
+	{
+		// for very small albums view, hide the display "Albums - A" etc.
+		m_azFirstHidden = TRUE;
+	}
+
+	ret = TRUE;
+
+	// cleanup
+Cleanup:
+	if( filterIds )
+	{
+		sqlite3_create_function(db->GetDb(), "infilter", 1, SQLITE_ANY, NULL, NULL, NULL, NULL);
+	}
+
+	if( cancel )
+	{
+		sqlite3_progress_handler(db->GetDb(), 0, NULL, NULL);
+	}
+
+	free(tracksPerAlbum);
+	return ret;
+}
+
+
+class SjLibrarySearchThread : public wxThread
+{
+public:
+	// there is only one search thread that is started on the first
+	// asynchronous search and that waits for the next job afterwards
+	                SjLibrarySearchThread();
+
+	// Post() replaces a waiting job, a running job is cancelled; Drop()
+	// cancels all jobs.  Both are called by the main thread.
+	void            Post                (SjLibrarySearchJob*);
+	void            Drop                ();
+
+	// returns the last finished job, if any; the job must be deleted by the caller
+	SjLibrarySearchJob* TakeDone        ();
+
+	// waits for the thread to terminate; should be called before the object is destroyed
+	void            Shutdown            ();
+
+private:
+	void*           Entry               ();
+
+	wxMutex         m_mutex;
+	wxCondition     m_condition;        // signalled when m_waiting or m_exit changes
+	SjLibrarySearchJob* m_waiting;
+	SjLibrarySearchJob* m_done;
+	std::atomic<bool> m_cancel;         // checked by SjLibrarySearchJob::Run() while the query is running
+	bool            m_exit;
+};
+
+
+SjLibrarySearchThread::SjLibrarySearchThread()
+	: wxThread(wxTHREAD_JOINABLE), m_condition(m_mutex)
+{
+	m_waiting   = NULL;
+	m_done      = NULL;
+	m_cancel    = false;
+	m_exit      = false;
+}
+
+
+void* SjLibrarySearchThread::Entry()
+{
+	wxLog::SetThreadActiveTarget(SjLogGui::s_this);
+
+	m_mutex.Lock();
+	while( 1 )
+	{
+		while( !m_exit && m_waiting == NULL )
+			m_condition.Wait();
+		if( m_exit )
+			break;
+
+		SjLibrarySearchJob* job = m_waiting;
+		m_waiting = NULL;
+		m_cancel = false;
+		m_mutex.Unlock();
+
+		{
+			wxSqltReader reader;
+			job->m_ok = reader.IsOk() && job->Run(reader.GetDb(),
+			                                       job->m_search.m_adv.IsSet()? &job->m_filterIds : NULL,
+			                                       &m_cancel);
+		}
+
+		m_mutex.Lock();
+		if( m_cancel )
+		{
+			delete job; // superseded, the next job, if any, is waiting
+		}
+		else
+		{
+			// on errors, the job is given to the main thread anyway;
+			// SjLibraryModule::FinishSearch() will repeat the search synchronously then
+			delete m_done;
+			m_done = job;
+			g_mainFrame->GetEventHandler()->QueueEvent(new wxCommandEvent(wxEVT_COMMAND_MENU_SELECTED, IDO_SEARCHDONE));
+		}
 	}
-
-	return o1-o2;
+	m_mutex.Unlock();
+	return NULL;
 }
 
 
-extern "C"
+void SjLibrarySearchThread::Post(SjLibrarySearchJob* job)
 {
-	static SjLLHash* g_filterHash = NULL;
-	static void sqlite_infilter(sqlite3_context* context, int argc, sqlite3_value** argv)
-	{
-		sqlite3_result_int(context, g_filterHash->Lookup(sqlite3_value_int(argv[0])));
-	}
-};
+	wxMutexLocker locker(m_mutex);
+	delete m_waiting;
+	m_waiting = job;
+	m_cancel = true;
+	m_condition.Broadcast();
+}
 
 
-SjSearchStat SjLibraryModule::SetSearch(const SjSearch& search, bool deepSearch)
+void SjLibrarySearchThread::Drop()
 {
-	wxASSERT( wxThread::IsMain() );
+	wxMutexLocker locker(m_mutex);
+	delete m_waiting;
+	m_waiting = NULL;
+	delete m_done;
+	m_done = NULL;
+	m_cancel = true;
+}
 
-	wxSqlt          sql;
-	SjSearchStat    retStat;
 
-	// create the filter IDs, if needed
-	if( deepSearch || m_search.m_adv!=search.m_adv )
-	{
-		if( g_filterHash == NULL )
-		{
-			g_filterHash = &m_filterHash;
-			sqlite3_create_function(sql.GetDb()->GetDb(), "infilter", 1, SQLITE_ANY, NULL, sqlite_infilter, NULL, NULL);
-		}
+SjLibrarySearchJob* SjLibrarySearchThread::TakeDone()
+{
+	wxMutexLocker locker(m_mutex);
+	SjLibrarySearchJob* job = m_done;
+	m_done = NULL;
+	return job;
+}
 
-		retStat = search.m_adv.GetAsSql(&m_filterHash, m_filterCond);
-	}
-	m_search = search;
 
-	// cancel search?
-	if( !search.IsSet() )
-	{
-		m_searchOffsetsCount = -1;
-		m_searchTracksHash.Clear();
-		return retStat; // search canceled - no tracks found
-	}
+void SjLibrarySearchThread::Shutdown()
+{
+	m_mutex.Lock();
+	m_exit = true;
+	m_cancel = true;
+	m_condition.Broadcast();
+	m_mutex.Unlock();
 
-	// allocate memory for the search offsets if not yet done
-	if( m_searchOffsets == NULL )
-	{
-		sql.Query(wxT("SELECT COUNT(*) FROM albums;")); // get the max. numbers of albums
-		m_searchOffsetsMax = sql.GetLong(0);
-		if( m_searchOffsetsMax <= 0 )
-		{
-			return retStat; // no error but nothing to search for
-		}
+	Wait();
 
-		m_searchOffsets = (long*)malloc(sizeof(long)*m_searchOffsetsMax);
-		if( m_searchOffsets == NULL )
-		{
-			return retStat; /* error */
-		}
-	}
+	delete m_waiting;
+	m_waiting = NULL;
+	delete m_done;
+	m_done = NULL;
+}
 
-	// allocate temp. memory for the number of tracks per
-	// album and for moving "large" albums to the beginning
-	wxASSERT( m_searchOffsetsMax > 0 );
-	g_tracksPerAlbum = (long*)malloc(sizeof(long)*m_searchOffsetsMax);
-	if( g_tracksPerAlbum == NULL ) { return retStat; /* error */ }
-	memset(g_tracksPerAlbum, 0, sizeof(long)*m_searchOffsetsMax);
 
-	// build query string
-	wxString    query;
-	bool        gatherAzFirst = !m_search.m_simple.IsSet();
+SjLibrarySearchJob* SjLibraryModule::PrepareSearchJob(const SjSearch& search)
+{
+	// build query string; this uses some other modules and must be done in the main thread
+	wxASSERT( wxThread::IsMain() );
+
+	SjLibrarySearchJob* job = new SjLibrarySearchJob();
+	job->m_search = search;
+	job->m_generation = m_searchGeneration;
+	job->m_gatherAzFirst = !search.m_simple.IsSet();
 
+	wxString& query = job->m_query;
 	query =  wxT("SELECT tracks.id,albumindex");
-	if( gatherAzFirst ) { query += wxT(",albums.az"); }
+	if( job->m_gatherAzFirst ) { query += wxT(",albums.az"); }
 	query += wxT(" FROM tracks, albums WHERE");
 
-	if( m_search.m_simple.IsSet() )
+	if( search.m_simple.IsSet() )
 	{
 		wxString simpleSearchWords = search.m_simple.GetWords();
 		wxString simpleCond;
@@ -2273,11 +2958,6 @@ SjSearchStat SjLibraryModule::SetSearch(const SjSearch& search, bool deepSearch)
 		// add to query
 		query += wxT(" (") + simpleCond + wxT(") ");
 	}
-	else if( gatherAzFirst )
-	{
-		int i; for(i=0; i<27; i++) m_filterAzFirst[i] = -1;
-		m_filterAzFirstHidden = FALSE;
-	}
 
 	if( search.m_adv.IsSet() )
 	{
@@ -2288,115 +2968,189 @@ SjSearchStat SjLibraryModule::SetSearch(const SjSearch& search, bool deepSearch)
 	query += wxT(" AND albums.id=albumid ") // <-- should be the last condition as this won't eliminate any row itself
 	         wxT("ORDER BY albumindex;");
 
-	// query database
+	return job;
+}
+
+
+void SjLibraryModule::ApplySearchJob(SjLibrarySearchJob* job, SjSearchStat& retStat)
+{
+	// swap in the results of the job, the job can be deleted afterwards
+	wxASSERT( wxThread::IsMain() );
+
+	if( m_searchOffsets )
 	{
-		wxSqlt  sql;
-		#if 0//def __WXDEBUG__
-				wxString queryDebug__(query);
-				queryDebug__.Replace(wxT("%"), wxT("%%"));
-				wxLogDebug(queryDebug__);
-		#endif
-		sql.Query(query);
+		free(m_searchOffsets);
+	}
+	m_searchOffsets         = job->m_offsets;
+	m_searchOffsetsMax      = job->m_offsetsMax;
+	m_searchOffsetsCount    = job->m_offsets? job->m_offsetsCount : 0;
+	m_searchTrackIds        = job->m_trackIds;
+	m_search                = job->m_search;
+	job->m_offsets = NULL;
 
-		// go through result:
-		long lastAlbumIndex = -1, thisAlbumIndex;
-		long thisAlbumAz, lastAlbumAz = -1;
-		m_searchOffsetsCount = 0;
-		m_searchTracksHash.Clear();
-		while( sql.Next() )
+	if( job->m_gatherAzFirst )
+	{
+		int i; for(i=0; i<27; i++) m_filterAzFirst[i] = job->m_azFirst[i];
+		m_filterAzFirstHidden = job->m_azFirstHidden;
+	}
+
+	// check, if the selected tracks are still in search
+	{
+		long oldCount = m_selectedTrackIds.GetCount();
+		m_selectedTrackIds.And(m_searchTrackIds);
+		if( m_selectedTrackIds.GetCount() != oldCount )
 		{
-			thisAlbumIndex = sql.GetLong(1);
-			wxASSERT( thisAlbumIndex >= lastAlbumIndex );
+			UpdateMenuBar();
+		}
+	}
 
-			if( lastAlbumIndex != thisAlbumIndex )
-			{
-				wxASSERT( m_searchOffsetsCount < m_searchOffsetsMax );
-				m_searchOffsets[m_searchOffsetsCount] = thisAlbumIndex;
-				lastAlbumIndex = thisAlbumIndex;
+	retStat.m_totalResultCount = m_searchTrackIds.GetCount();
+}
 
-				if( gatherAzFirst )
-				{
-					thisAlbumAz = sql.GetLong(2);
-					wxASSERT( thisAlbumAz >= lastAlbumAz );
-					wxASSERT( thisAlbumAz >= 'a' && thisAlbumAz <= ('z'+1) );
-					if( thisAlbumAz != lastAlbumAz
-					        && thisAlbumAz >= 'a' && thisAlbumAz <= ('z'+1) )
-					{
-						m_filterAzFirst[thisAlbumAz-'a'] = m_searchOffsetsCount;
-						lastAlbumAz = thisAlbumAz;
-					}
-				}
 
-				m_searchOffsetsCount++;
-			}
+SjSearchStat SjLibraryModule::SetSearch(const SjSearch& search, bool deepSearch)
+{
+	SJ_STALL_SCOPE("SjLibraryModule::SetSearch");
 
-			wxASSERT( thisAlbumIndex < m_searchOffsetsMax );
-			if( thisAlbumIndex < m_searchOffsetsMax /*proofe anyway for corrupted databases*/ )
-			{
-				g_tracksPerAlbum[thisAlbumIndex]++;
-			}
+	wxASSERT( wxThread::IsMain() );
 
-			m_searchTracksHash.Insert(sql.GetLong(0), 1);
-		}
-	}
+	wxSqlt          sql;
+	SjSearchStat    retStat;
 
-	// check, if the selected tracks are still in search
+	// a pending asynchronous search is superseded by this one
+	CancelSearch();
+
+	// create the filter IDs, if needed
+	if( deepSearch || m_search.m_adv!=search.m_adv )
 	{
-		long selTrackId;
-		bool updateMenu = FALSE;
-		SjHashIterator iterator3;
-		while( m_selectedTrackIds.Iterate(iterator3, &selTrackId) )
+		if( m_filterFuncDb != sql.GetDb()->GetDb() )
 		{
-			if( m_searchTracksHash.Lookup(selTrackId)==0 )
-			{
-				// the iteration functionality allows us to remove the
-				// current element
-				m_selectedTrackIds.Remove(selTrackId);
-				updateMenu = TRUE;
-			}
+			m_filterFuncDb = sql.GetDb()->GetDb();
+			sqlite3_create_function(m_filterFuncDb, "infilter", 1, SQLITE_ANY, &m_filterIds, sqlite_infilter, NULL, NULL);
 		}
 
-		if( updateMenu )
+		retStat = search.m_adv.GetAsSql(&m_filterIds, m_filterCond);
+	}
+	m_search = search;
+
+	// cancel search?
+	if( !search.IsSet() )
+	{
+		m_searchOffsetsCount = -1;
+		m_searchTrackIds.Clear();
+		return retStat; // search canceled - no tracks found
+	}
+
+	// do the search in this thread, INFILTER() is already
+	// registered for the default connection
+	SjLibrarySearchJob* job = PrepareSearchJob(search);
+	if( job->Run(sql.GetDb(), NULL, NULL) )
+	{
+		ApplySearchJob(job, retStat);
+	}
+	delete job;
+
+	return retStat;
+}
+
+
+bool SjLibraryModule::StartSearch(const SjSearch& search)
+{
+	// start a simple search in the search thread; if FALSE is returned,
+	// the caller should use SetSearch() instead.  The advanced search must
+	// not change, as this may need the main thread (QUEUEPOS etc.)
+	wxASSERT( wxThread::IsMain() );
+
+	if( !search.IsSet()
+	 || m_search.m_adv != search.m_adv
+	 || wxSqltDb::GetDefault()->GetMaxReaders() <= 0
+	 || g_tools->m_config->Read(wxT("main/asyncSearch"), 1L) == 0 )
+	{
+		return FALSE;
+	}
+
+	if( m_searchThread == NULL )
+	{
+		m_searchThread = new SjLibrarySearchThread();
+		if( m_searchThread->Create() != wxTHREAD_NO_ERROR || m_searchThread->Run() != wxTHREAD_NO_ERROR )
 		{
-			UpdateMenuBar();
+			delete m_searchThread;
+			m_searchThread = NULL;
+			return FALSE;
 		}
 	}
 
-	// Move albums with equal or more than LARGE_ALBUM tracks found to the beginning of the list
-	// (normally these are full albums with matching artist or album names)
-	// However, we do this only if the simple search ist set
-	if( m_search.m_simple.IsSet() )
+	m_searchGeneration++;
+	SjLibrarySearchJob* job = PrepareSearchJob(search);
+	if( search.m_adv.IsSet() )
 	{
-		qsort(m_searchOffsets, m_searchOffsetsCount, sizeof(long), compareOffsets);
+		job->m_filterIds = m_filterIds;
 	}
-	else if( m_searchOffsetsCount < 20 )
+	m_searchThread->Post(job);
+	m_searchPending = TRUE;
+
+	return TRUE;
+}
+
+
+bool SjLibraryModule::FinishSearch(SjSearchStat& retStat)
+{
+	// called on IDO_SEARCHDONE; returns TRUE if the results of the last
+	// search started by StartSearch() are applied.  Results of cancelled
+	// searches are silently dropped.
+	wxASSERT( wxThread::IsMain() );
+
+	SjLibrarySearchJob* job = m_searchThread? m_searchThread->TakeDone() : NULL;
+	if( job == NULL )
 	{
-		// for very small albums view, hide the display "Albums - A" etc.
-		m_filterAzFirstHidden = TRUE;
+		return FALSE;
 	}
 
-	// done
-	free(g_tracksPerAlbum);
-	retStat.m_totalResultCount = m_searchTracksHash.GetCount();
-	return retStat;
+	if( job->m_generation != m_searchGeneration )
+	{
+		delete job;
+		return FALSE; // superseded, m_searchPending refers to the newer search
+	}
+
+	m_searchPending = FALSE;
+
+	if( job->m_ok )
+	{
+		ApplySearchJob(job, retStat);
+	}
+	else
+	{
+		// the read connection failed, try again in the main thread
+		retStat = SetSearch(job->m_search, FALSE);
+	}
+
+	delete job;
+	return TRUE;
+}
+
+
+void SjLibraryModule::CancelSearch()
+{
+	m_searchGeneration++;
+	m_searchPending = FALSE;
+
+	if( m_searchThread )
+	{
+		m_searchThread->Drop();
+	}
 }
 
 
-void SjLibraryModule::GetIdsInView(SjLLHash* ret,
+void SjLibraryModule::GetIdsInView(SjIdSet* ret,
                                    bool ignoreSimpleSearchIfNull,
                                    bool ignoreAdvSearchIfNull)
 {
 	wxASSERT( wxThread::IsMain() );
 	wxASSERT( ret );
 
-	if( m_searchTracksHash.GetCount() )
+	if( m_searchTrackIds.GetCount() )
 	{
-		long currId;
-		SjHashIterator iterator4;
-		while( m_searchTracksHash.Iterate(iterator4, &currId) )
-		{
-			ret->Insert(currId, 1);
-		}
+		ret->Or(m_searchTrackIds);
 
 		return; // done - tracks in view found
 	}
@@ -2438,7 +3192,7 @@ void SjLibraryModule::GetIdsInView(SjLLHash* ret,
 		sql.Query(wxT("SELECT id FROM tracks;"));
 		while( sql.Next() )
 		{
-			ret->Insert(sql.GetLong(0), 1);
+			ret->Insert(sql.GetLong(0));
 		}
 	}
 }
@@ -2455,12 +3209,7 @@ long SjLibraryModule::DelInsSelection(bool del)
 		{
 			// remove the selection from the filtered tracks
 			long numDeletedTracks = m_selectedTrackIds.GetCount();
-			long selectedId;
-			SjHashIterator iterator5;
-			while( m_selectedTrackIds.Iterate(iterator5, &selectedId) )
-			{
-				m_filterHash.Remove(selectedId);
-			}
+			m_filterIds.AndNot(m_selectedTrackIds);
 
 			// make sure, the hash is always regarded
 			// (SjAdvSearch::GetAsSql() may have returned some other, optimized query)
@@ -2485,47 +3234,16 @@ bool SjLibraryModule::HiliteSearchWords(wxString& in)
 
 	if( m_search.m_simple.IsSet() )
 	{
-		if( m_hiliteRegExFor != m_search.m_simple.GetHiliteWords() )
+		// (re-)build the automaton only if the search words have changed,
+		// this function is called for each string drawn
+		if( m_hiliterFor != m_search.m_simple.GetHiliteWords() )
 		{
-			wxString cond = m_search.m_simple.GetHiliteWords();
-			cond.Trim(true).Trim(false);
-			if( cond.IsEmpty() )
-			{
-				m_hiliteRegExOk = false;
-			}
-			else
-			{
-				cond.Replace(wxT("\\"), wxT("\\\\"));   // do not for get to escape all special characters in the words ...
-				cond.Replace(wxT("$"), wxT("\\$"));     // see http://www.silverjuke.net/forum/post.php?p=14723
-				cond.Replace(wxT("+"), wxT("\\+"));
-				cond.Replace(wxT("-"), wxT("\\-"));
-				cond.Replace(wxT("*"), wxT("\\*"));
-				cond.Replace(wxT("^"), wxT("\\^"));
-				cond.Replace(wxT("."), wxT("\\."));
-				cond.Replace(wxT(","), wxT("\\,"));
-				cond.Replace(wxT("?"), wxT("\\?"));
-				cond.Replace(wxT("|"), wxT("\\|"));
-				cond.Replace(wxT("["), wxT("\\["));
-				cond.Replace(wxT("]"), wxT("\\]"));
-				cond.Replace(wxT("("), wxT("\\("));
-				cond.Replace(wxT(")"), wxT("\\)"));
-				cond.Replace(wxT("{"), wxT("\\{"));
-				cond.Replace(wxT("}"), wxT("\\}"));
-
-				cond.Replace(wxT(" "), wxT("|"));
-				cond = wxT("(") + cond + wxT(")");
-
-				m_hiliteRegExOk  = m_hiliteRegEx.Compile(cond, wxRE_ICASE);
-			}
-
-			m_hiliteRegExFor = m_search.m_simple.GetHiliteWords();
+			m_hiliterFor = m_search.m_simple.GetHiliteWords();
+			m_hiliter.Init(m_hiliterFor);
 		}
 
-		if( m_hiliteRegExOk )
-		{
-			if( m_hiliteRegEx.Replace(&in, wxT("\t\\1\t")) > 1 )
-				ret = true;
-		}
+		if( m_hiliter.Hilite(in, wxT('\t')) > 1 )
+			ret = true;
 	}
 
 	return ret;
@@ -2716,10 +3434,17 @@ bool SjLibraryModule::GetTrackInfo(const wxString& url, SjTrackInfo& trackInfo,
 wxArrayString SjLibraryModule::GetUniqueValues(long what)
 {
 	wxString        name = what==SJ_TI_GENRENAME? wxT("genrename") : wxT("groupname");
+	wxArrayString   allValuesArray;
 
+	// use the names from the index, if possible; these are always up to date
+	if( m_trackIndex.GetNames(what==SJ_TI_GENRENAME? SJ_FIELD_GENRENAME : SJ_FIELD_GROUPNAME, allValuesArray) )
+	{
+		return allValuesArray;
+	}
+
+	// use the list written by UpdateUniqueValues()
 	wxSqlt          sql;
 	wxString        allValuesString = sql.ConfigRead(wxT("library/") + name, wxEmptyString);
-	wxArrayString   allValuesArray;
 
 	wxString        currValue;
 
@@ -2740,27 +3465,31 @@ wxArrayString SjLibraryModule::GetUniqueValues(long what)
 bool SjLibraryModule::GetAutoComplete(long what, const wxString& in, wxString& out, bool internalCall)
 {
 	wxString    name;
-	wxSqlt      sql;
+	SjField     field = SJ_FIELD_URL;
 
-	if( what == SJ_TI_ALBUMNAME )      { name = wxT("albumname");      }
-	else if( what == SJ_TI_GENRENAME )      { name = wxT("genrename");      }
-	else if( what == SJ_TI_GROUPNAME )      { name = wxT("groupname");      }
-	else if( what == SJ_TI_LEADARTISTNAME ) { name = wxT("leadartistname"); }
-	else if( what == SJ_TI_ORGARTISTNAME )  { name = wxT("orgartistname");  }
-	else if( what == SJ_TI_COMPOSERNAME )   { name = wxT("composername");   }
-	else if( what == SJ_TI_COMMENT )        { name = wxT("comment");        }
-	else if( what == SJ_TI_TRACKNAME )      { name = wxT("trackname");      }
-	else if( what == SJ_TI_URL )            { name = wxT("url");            }
+	if( what == SJ_TI_ALBUMNAME )      { name = wxT("albumname");      field = SJ_FIELD_ALBUMNAME;      }
+	else if( what == SJ_TI_GENRENAME )      { name = wxT("genrename");      field = SJ_FIELD_GENRENAME;      }
+	else if( what == SJ_TI_GROUPNAME )      { name = wxT("groupname");      field = SJ_FIELD_GROUPNAME;      }
+	else if( what == SJ_TI_LEADARTISTNAME ) { name = wxT("leadartistname"); field = SJ_FIELD_LEADARTISTNAME; }
+	else if( what == SJ_TI_ORGARTISTNAME )  { name = wxT("orgartistname");  field = SJ_FIELD_ORGARTISTNAME;  }
+	else if( what == SJ_TI_COMPOSERNAME )   { name = wxT("composername");   field = SJ_FIELD_COMPOSERNAME;   }
+	else if( what == SJ_TI_COMMENT )        { name = wxT("comment");        field = SJ_FIELD_COMMENT;        }
+	else if( what == SJ_TI_TRACKNAME )      { name = wxT("trackname");      field = SJ_FIELD_TRACKNAME;      }
+	else if( what == SJ_TI_URL )            { name = wxT("url");            field = SJ_FIELD_URL;            }
 
 
-	sql.Query(wxT("SELECT ") + name + wxT(" FROM tracks WHERE ") + name + wxT(" LIKE '") + sql.QParam(in) + wxT("%' ORDER BY ") + name + wxT(" LIMIT 1;"));
-	if( sql.Next() )
+	// use the names from the index, if possible (not for comments and URLs);
+	// otherwise, query the database
+	if( !m_trackIndex.GetFirstName(field, in, out) )
 	{
-		out = sql.GetString(0);
-		if( out.Len() > in.Len() )
-		{
-			return TRUE;
-		}
+		wxSqlt sql;
+		sql.Query(wxT("SELECT ") + name + wxT(" FROM tracks WHERE ") + name + wxT(" LIKE '") + sql.QParam(in) + wxT("%' ORDER BY ") + name + wxT(" LIMIT 1;"));
+		out = sql.Next()? sql.GetString(0) : wxString();
+	}
+
+	if( out.Len() > in.Len() )
+	{
+		return TRUE;
 	}
 
 	if( !internalCall )
@@ -3026,7 +3755,7 @@ wxString SjLibraryModule::GetUpText()
 		}
 
 		ret += wxString::Format(_("%s tracks on %s albums found for \"%s\""),
-		                        SjTools::FormatNumber(m_searchTracksHash.GetCount()).c_str(),
+		                        SjTools::FormatNumber(m_searchTrackIds.GetCount()).c_str(),
 		                        SjTools::FormatNumber(m_searchOffsetsCount).c_str(),
 		                        m_search.m_simple.GetWords().c_str());
 	}
@@ -3038,7 +3767,7 @@ wxString SjLibraryModule::GetUpText()
 		}
 
 		ret += wxString::Format(_("%s tracks on %s albums"),
-		                        SjTools::FormatNumber(m_searchTracksHash.GetCount()).c_str(),
+		                        SjTools::FormatNumber(m_searchTrackIds.GetCount()).c_str(),
 		                        SjTools::FormatNumber(m_searchOffsetsCount).c_str());
 	}
 	else
@@ -3054,6 +3783,8 @@ wxString SjLibraryModule::GetUpText()
 
 SjCol* SjLibraryModule::GetCol__(long dbAlbumIndex, long virtualAlbumIndex, bool regardSearch)
 {
+	SJ_STALL_SCOPE("SjLibraryModule::GetCol__");
+
 	wxSqlt sql;
 
 	// get album information
@@ -3104,7 +3835,7 @@ SjCol* SjLibraryModule::GetCol__(long dbAlbumIndex, long virtualAlbumIndex, bool
 			}
 
 			col->m_textUp += wxString::Format(_("%s tracks on %s albums found for \"%s\""),
-			                                  SjTools::FormatNumber(m_searchTracksHash.GetCount()).c_str(),
+			                                  SjTools::FormatNumber(m_searchTrackIds.GetCount()).c_str(),
 			                                  SjTools::FormatNumber(m_searchOffsetsCount).c_str(),
 			                                  m_search.m_simple.GetWords().c_str());
 		}
@@ -3121,7 +3852,7 @@ SjCol* SjLibraryModule::GetCol__(long dbAlbumIndex, long virtualAlbumIndex, bool
 			}
 
 			col->m_textUp += wxString::Format(_("%s tracks on %s albums"),
-			                                  SjTools::FormatNumber(m_searchTracksHash.GetCount()).c_str(),
+			                                  SjTools::FormatNumber(m_searchTrackIds.GetCount()).c_str(),
 			                                  SjTools::FormatNumber(m_searchOffsetsCount).c_str());
 
 			if( !m_filterAzFirstHidden ) // for very small albums view, hide the display "Albums - A" etc.
@@ -3376,7 +4107,7 @@ SjCol* SjLibraryModule::GetCol__(long dbAlbumIndex, long virtualAlbumIndex, bool
 		}
 
 		// track in search?
-		if( regardSearch && HasSearch() && m_searchTracksHash.Lookup(trackId)==0 )
+		if( regardSearch && HasSearch() && !m_searchTrackIds.Lookup(trackId) )
 		{
 			automTrackNr++;
 			continue;
@@ -3683,7 +4414,7 @@ void SjLibraryModule::UpdateMenu(SjMenu* enqueueMenu, SjMenu* editMenu, bool upd
 		// ...get single track information
 		wxSqlt sql;
 		long trackId = 0;
-		SjHashIterator iterator6;
+		SjIdSetIterator iterator6;
 		m_selectedTrackIds.Iterate(iterator6, &trackId);
 		sql.Query(wxString::Format(wxT("SELECT rating, trackname, url, leadartistname FROM tracks WHERE id=%lu;"), trackId));
 		if( sql.Next() )
@@ -4070,6 +4801,8 @@ bool SjLibraryModule::SetRating(const wxArrayString& urls, long rating)
 			if( sql.Next() )
 			{
 				sql.Query(wxT("UPDATE tracks SET rating=") + sql.LParam(rating) + wxT(" WHERE url='") + sql.QParam(urls[i]) + wxT("';"));
+				m_trackIndex.InvalidateTrack(urls[i]);
+				m_advSearchCache.Invalidate(SJ_SEARCHDEP_RATING);
 				setRatingCount ++;
 			}
 			else
@@ -4125,17 +4858,19 @@ void SjLibraryModule::HandleMenu(int id)
 					wxSqlt sql;
 
 					long trackId;
-					SjHashIterator iterator7;
+					SjIdSetIterator iterator7;
 					while( m_selectedTrackIds.Iterate(iterator7, &trackId) )
 					{
 						sql.Query(wxString::Format(wxT("UPDATE tracks SET rating=%i WHERE id=%i;"),
 						                           (int)(id-IDM_RATINGSELECTION00), (int)trackId));
+						m_trackIndex.InvalidateTrack(trackId);
 					}
+					m_advSearchCache.Invalidate(SJ_SEARCHDEP_RATING);
 
 					if( g_tagEditorModule->GetWriteId3Tags() )
 					{
-						SjHashIterator iterator8;
-						while( m_selectedTrackIds.Iterate(iterator7, &trackId) )
+						SjIdSetIterator iterator8;
+						while( m_selectedTrackIds.Iterate(iterator8, &trackId) )
 						{
 							SjTrackInfo ti;
 							ti.m_validFields |= SJ_TI_RATING|SJ_TI_URL;
@@ -4168,7 +4903,7 @@ void SjLibraryModule::HandleMenu(int id)
 					wxSqlt sql;
 					long trackId = 0;
 
-					SjHashIterator iterator8;
+					SjIdSetIterator iterator8;
 					m_selectedTrackIds.Iterate(iterator8, &trackId);
 
 					sql.Query(wxString::Format(wxT("SELECT url FROM tracks WHERE id=%lu;"), trackId));
@@ -4204,16 +4939,84 @@ void SjLibraryModule::HandleMiddleMouse()
 #define VALID_GAIN_MAX 10.0
 
 
+class SjPendingPlayback
+{
+public:
+	                SjPendingPlayback   () { m_timesPlayed = 0; m_startingTime = 0; m_gainLong = 0; m_playtimeMs = 0; }
+	long            m_timesPlayed;
+	unsigned long   m_startingTime;
+	long            m_gainLong;     // the smallest gain found, 0 for unknown
+	long            m_playtimeMs;   // the last continuously decoded time, 0 for unknown
+};
+
+
 void SjLibraryModule::PlaybackDone(const wxString& url, unsigned long newStartingTime,
                                    double newGainDbl, long realContinuousDecodedMs)
 {
 	// hint: if the track was not played completely continuously, realContinuousDecodedMs
 	// should be set to 0!
 
+	// just remember the data, they're written by SavePendingData(); several playbacks of the same track are combined
+	SjPendingPlayback* pending = (SjPendingPlayback*)m_pendingPlaybacks.Lookup(url);
+	if( pending == NULL )
+	{
+		pending = new SjPendingPlayback;
+		m_pendingPlaybacks.Insert(url, pending);
+	}
+
+	pending->m_timesPlayed++;
+
+	if( newStartingTime > pending->m_startingTime )
+	{
+		pending->m_startingTime = newStartingTime;
+	}
+
+	long newGainLong = ::SjGain2Long(newGainDbl);
+	if( newGainLong > 0 && (pending->m_gainLong <= 0 || newGainLong < pending->m_gainLong) )
+	{
+		pending->m_gainLong = newGainLong;
+	}
+
+	if( realContinuousDecodedMs > 0 )
+	{
+		pending->m_playtimeMs = realContinuousDecodedMs;
+	}
+
+	if( m_pendingTimestamp == 0 )
+	{
+		m_pendingTimestamp = SjTools::GetMsTicks();
+	}
+}
+
+
+void SjLibraryModule::SavePendingData()
+{
+	if( m_pendingPlaybacks.GetCount() == 0 )
+		return;
+
+	wxSqltTransaction transaction;
+
+	SjHashIterator     iterator;
+	wxString           url;
+	SjPendingPlayback* pending;
+	while( (pending=(SjPendingPlayback*)m_pendingPlaybacks.Iterate(iterator, url))!=NULL )
+	{
+		SavePlayback(url, pending);
+		delete pending;
+	}
+	m_pendingPlaybacks.Clear();
+	m_pendingTimestamp = 0;
+
+	transaction.Commit();
+}
+
+
+void SjLibraryModule::SavePlayback(const wxString& url, const SjPendingPlayback* pending)
+{
 	wxSqlt          sql;
 	unsigned long   id;
-	long            oldGainLong, newGainLong = ::SjGain2Long(newGainDbl);
-	unsigned long   oldStartingTime;
+	long            oldGainLong, newGainLong = pending->m_gainLong;
+	unsigned long   oldStartingTime, newStartingTime = pending->m_startingTime;
 	unsigned long   oldTimesPlayed;
 	long            oldPlaytimeMs, newPlaytimeMs;
 
@@ -4228,9 +5031,13 @@ void SjLibraryModule::PlaybackDone(const wxString& url, unsigned long newStartin
 	oldPlaytimeMs   = sql.GetLong(4);
 
 	// old gain valid? due to a bug in older versions, it may be out of range, see http://www.silverjuke.net/forum/viewtopic.php?t=1007
-	double testGain = ::SjLong2Gain(oldGainLong);
-	if( testGain < VALID_GAIN_MIN || testGain > VALID_GAIN_MAX )
-		oldGainLong = 0;
+	// (-1 marks tracks that cannot be analysed, see GetUnanalysedUrls(); this is kept if no new gain was measured)
+	if( oldGainLong != -1 )
+	{
+		double testGain = ::SjLong2Gain(oldGainLong);
+		if( testGain < VALID_GAIN_MIN || testGain > VALID_GAIN_MAX )
+			oldGainLong = 0;
+	}
 
 	// check if we should use the new or the old values
 	if( oldStartingTime > newStartingTime )
@@ -4245,9 +5052,9 @@ void SjLibraryModule::PlaybackDone(const wxString& url, unsigned long newStartin
 	}
 
 	newPlaytimeMs = oldPlaytimeMs;
-	if( realContinuousDecodedMs > 0 )
+	if( pending->m_playtimeMs > 0 )
 	{
-		newPlaytimeMs = realContinuousDecodedMs;
+		newPlaytimeMs = pending->m_playtimeMs;
 		if( (newPlaytimeMs/1000) != (oldPlaytimeMs/1000) )
 		{
 			if( !SjMainApp::IsInShutdown() /*the main frame may already be destructed, check this!*/ )
@@ -4260,8 +5067,10 @@ void SjLibraryModule::PlaybackDone(const wxString& url, unsigned long newStartin
 	}
 
 	sql.Query(wxString::Format(wxT("UPDATE tracks SET timesplayed=%lu, lastplayed=%lu, autovol=%i, playtimems=%i WHERE id=%lu;"),
-	                           oldTimesPlayed+1, newStartingTime, (int)newGainLong, (int)newPlaytimeMs,
+	                           oldTimesPlayed+pending->m_timesPlayed, newStartingTime, (int)newGainLong, (int)newPlaytimeMs,
 	                           id));
+	m_trackIndex.InvalidateTrack(id);
+	m_advSearchCache.Invalidate(SJ_SEARCHDEP_PLAYBACK);
 }
 
 
@@ -4280,6 +5089,14 @@ void SjLibraryModule::GetAutoVol(const wxString& url, double* trackGain, double*
 	if( sql.Next() )
 	{
 		lng = sql.GetLong(0);
+
+		// a gain not yet written may be smaller, see PlaybackDone()
+		const SjPendingPlayback* pending = (const SjPendingPlayback*)m_pendingPlaybacks.Lookup(url);
+		if( pending && pending->m_gainLong > 0 && (lng <= 0 || pending->m_gainLong < lng) )
+		{
+			lng = pending->m_gainLong;
+		}
+
 		if( lng > 0 )
 		{
 			*trackGain = ::SjLong2Gain(lng);
@@ -4351,6 +5168,46 @@ double SjLibraryModule::GetAutoVol(const wxString& url, bool useAlbumGainIfPossi
 }
 
 
+void SjLibraryModule::GetUnanalysedUrls(wxArrayString& ret, long maxCount)
+{
+	// tracks that cannot be analysed are marked by autovol=-1, so they're not returned again
+	wxSqlt sql;
+	sql.Query(wxString::Format(wxT("SELECT url FROM tracks WHERE autovol=0 OR autovol IS NULL LIMIT %i;"), (int)maxCount));
+	while( sql.Next() )
+	{
+		ret.Add(sql.GetString(0));
+	}
+}
+
+
+void SjLibraryModule::SetAnalysedAutoVol(const wxArrayString& urls, const wxArrayLong& gains)
+{
+	wxASSERT( urls.GetCount() == gains.GetCount() );
+
+	// as in PlaybackDone(), a smaller gain that was found before is not overwritten
+	wxSqltTransaction transaction;
+	wxSqlt            sql;
+	size_t            i, iCnt = urls.GetCount();
+	for( i = 0; i < iCnt; i++ )
+	{
+		long newGainLong = gains[i];
+		double testGain = ::SjLong2Gain(newGainLong);
+		if( testGain >= VALID_GAIN_MIN && testGain <= VALID_GAIN_MAX )
+		{
+			sql.Query(wxString::Format(wxT("UPDATE tracks SET autovol=%i WHERE url='"), (int)newGainLong) + sql.QParam(urls[i])
+			        + wxString::Format(wxT("' AND (autovol IS NULL OR autovol<=0 OR autovol>%i);"), (int)newGainLong));
+		}
+		else
+		{
+			sql.Query(wxT("UPDATE tracks SET autovol=-1 WHERE url='") + sql.QParam(urls[i]) + wxT("' AND (autovol IS NULL OR autovol=0);"));
+		}
+		m_trackIndex.InvalidateTrack(urls[i]);
+	}
+	m_advSearchCache.Invalidate(SJ_SEARCHDEP_PLAYBACK);
+	transaction.Commit();
+}
+
+
 bool SjLibraryModule::AreTracksSubsequent(const wxString& url1, const wxString& url2)
 {
 	wxSqlt sql;
@@ -4890,7 +5747,7 @@ void SjAlbumTrackRow::Select(bool select)
 {
 	if( select )
 	{
-		m_libraryModule->m_selectedTrackIds.Insert(m_trackId, 1);
+		m_libraryModule->m_selectedTrackIds.Insert(m_trackId);
 	}
 	else
 	{
@@ -4911,12 +5768,7 @@ void SjLibraryModule::SelectAllRows(bool select)
 
 		if( HasSearch() )
 		{
-			long trackId;
-			SjHashIterator iterator9;
-			while( m_searchTracksHash.Iterate(iterator9, &trackId) )
-			{
-				m_selectedTrackIds.Insert(trackId, 1);
-			}
+			m_selectedTrackIds = m_searchTrackIds;
 		}
 		else
 		{
@@ -4924,7 +5776,7 @@ void SjLibraryModule::SelectAllRows(bool select)
 			sql.Query(wxT("SELECT id FROM tracks;"));
 			while( sql.Next() )
 			{
-				m_selectedTrackIds.Insert(sql.GetLong(0), 1);
+				m_selectedTrackIds.Insert(sql.GetLong(0));
 			}
 		}
 	}
@@ -4948,7 +5800,7 @@ void SjLibraryModule::SelectByQuery(bool select, const wxString& formattedQuery)
 		{
 			if( select )
 			{
-				m_selectedTrackIds.Insert(trackId, 1);
+				m_selectedTrackIds.Insert(trackId);
 			}
 			else
 			{
@@ -4963,7 +5815,7 @@ void SjLibraryModule::SelectByQuery(bool select, const wxString& formattedQuery)
 }
 
 
-void SjLibraryModule::GetOrderedUrlsFromIDs(SjLLHash& ids, wxArrayString& urls)
+void SjLibraryModule::GetOrderedUrlsFromIDs(const SjIdSet& ids, wxArrayString& urls)
 {
 	long trackCount = ids.GetCount();
 	if( trackCount >= 1 )
@@ -5049,8 +5901,8 @@ public:
 	long            GetTrackCount       () { return m_idsCount; }
 	void            GetTrack            (long offset, SjTrackInfo&, long& albumId, long& special);
 	long            GetTrackSpecial     (long offset);
-	bool            IsTrackSelected     (long offset) { return m_module->m_selectedTrackIds.Lookup(m_ids[offset].id)!=0; }
-	void            SelectTrack         (long offset, bool select) { m_module->m_selectedTrackIds.InsertOrRemove(m_ids[offset].id, select? 1L : 0L); }
+	bool            IsTrackSelected     (long offset) { return m_module->m_selectedTrackIds.Lookup(m_ids[offset].id); }
+	void            SelectTrack         (long offset, bool select) { m_module->m_selectedTrackIds.InsertOrRemove(m_ids[offset].id, select); }
 	long            Url2TrackOffset     (const wxString& url); // return -1 if not in view
 
 	wxString        GetUpText           ();
@@ -5175,10 +6027,10 @@ void SjLibraryListView::ChangeOrder(long orderField, bool orderDesc)
 	order.Replace(wxT("DIR"), orderDesc? wxT("DESC") : wxT(""));
 
 	// get base query
-	m_idsCount = m_module->m_searchTracksHash.GetCount();
+	m_idsCount = m_module->m_searchTrackIds.GetCount();
 	if( m_idsCount )
 	{
-		sql.Query(wxString::Format(wxT("SELECT id, albumId FROM tracks WHERE id IN (%s) ORDER BY %s"),  m_module->m_searchTracksHash.GetKeysAsString().c_str(), order.c_str()));
+		sql.Query(wxString::Format(wxT("SELECT id, albumId FROM tracks WHERE id IN (%s) ORDER BY %s"),  m_module->m_searchTrackIds.GetKeysAsString().c_str(), order.c_str()));
 	}
 	else
 	{
@@ -79,6 +79,12 @@ private:
 #define SJ_SHORTENED_ARTISTNAME_LEN 24
 
 
+class SjPendingPlayback;
+class SjLibrarySearchJob;
+class SjLibrarySearchThread;
+class SjLibraryTrackWriter;
+
+
 class SjLibraryModule : public SjColModule
 {
 public:
@@ -86,7 +92,13 @@ public:
 
 	SjSearchStat    SetSearch           (const SjSearch&, bool deepSearch);
 
-	void            GetIdsInView        (SjLLHash* ret, bool ignoreSimpleSearchIfNull=FALSE, bool ignoreAdvSearchIfNull=FALSE);
+	// asynchronous simple searches, see SjColumnMixer::StartSearch()
+	bool            StartSearch         (const SjSearch&);
+	bool            FinishSearch        (SjSearchStat&);
+	void            CancelSearch        ();
+	bool            IsSearchPending     () const { return m_searchPending; } // TRUE between StartSearch() and FinishSearch() applying the results or CancelSearch()
+
+	void            GetIdsInView        (SjIdSet* ret, bool ignoreSimpleSearchIfNull=FALSE, bool ignoreAdvSearchIfNull=FALSE);
 
 	SjEmbedTo       EmbedTo             () { return SJ_EMBED_TO_MUSICLIB; }
 	wxWindow*       GetConfigPage       (wxWindow* parent, int selectedPage);
@@ -117,7 +129,7 @@ public:
 	long            GetSelectedUrlCount () { return m_selectedTrackIds.GetCount(); }
 	void            GetSelectedUrls     (wxArrayString& urls);
 	void            GetOrderedUrlsFromIDs
-	(SjLLHash& ids, wxArrayString& urls);
+	(const SjIdSet& ids, wxArrayString& urls);
 	long            DelInsSelection     (bool del);
 
 	// misc.
@@ -131,6 +143,8 @@ public:
 	void            PlaybackDone        (const wxString& url, unsigned long startingTime, double newGain, long realDecodedBytes);
 	void            GetAutoVol          (const wxString& url, double* trackGain, double* albumGain) const; // set to < 0 if unknown
 	double          GetAutoVol          (const wxString& url, bool useAlbumGainIfPossible);
+	void            GetUnanalysedUrls   (wxArrayString& ret, long maxCount); // tracks without autovol, see SjPlayer::UpdateAnalyser()
+	void            SetAnalysedAutoVol  (const wxArrayString& urls, const wxArrayLong& gains); // gains as from SjGain2Long(), <=0 if the track cannot be analysed
 	bool            AreTracksSubsequent (const wxString& url1, const wxString& url2);
 
 	// Get more tracks from an artist or album,
@@ -138,13 +152,21 @@ public:
 	// if alreadyEnqueued is set, URLs already in the given queue are not returned.
 	wxArrayString   GetMoreFrom         (const wxString& url, int targetId, SjQueue* alreadyEnqueued);
 
-	// my first idea was not to save the autovol and the playcount directly, but
-	// flush it sometime using SavePendingData(). however, PlaybackDone() seems to
-	// be fast enough (we call it at the end of a track); so we save many certain
-	// circumstances where we would check if there are data pending... in short,
-	// currently SavePendingData() is not needed but called at places where it
-	// may be needed.
-	void            SavePendingData     () {}
+	// PlaybackDone() does not write the autovol and the playcount directly as this
+	// would lock the database just when the next track is started; the statistics are
+	// collected and written in one transaction by SavePendingData() - this is done
+	// by the timer (see IsPendingDataDue()), before searching or editing and on exit.
+	void            SavePendingData     ();
+	#define         SJ_PENDING_DATA_MS  60000L
+	bool            IsPendingDataDue    (unsigned long thisTimestamp) const { return m_pendingTimestamp!=0 && thisTimestamp > m_pendingTimestamp+SJ_PENDING_DATA_MS; }
+
+	// the tracks table in memory, used for advanced searches; all changes to
+	// the tracks table must be reported to the index
+	SjTrackIndex    m_trackIndex;
+
+	// the results of the saved advanced searches; as for the index, all
+	// changes to the tracks table must be reported
+	SjAdvSearchCache m_advSearchCache;
 
 	// add an art image to use as cover to an album
 	#define         SJ_DUMMY_COVER_ID   0x7FFFFFFFL
@@ -187,33 +209,44 @@ public:
 	long            GetFlags            () const { return m_flags; }
 	void            SetFlags            (long f) { m_flags = f; SaveSettings(); }
 
+	// check the plans of the most frequently used queries, see testdrive.cpp;
+	// returns the number of queries that read a table completely
+	long            CheckQueryPlans     ();
+
 protected:
 	bool            FirstLoad           ();
 	void            LastUnload          ();
+	bool            UpdateIndexes       ();
 
 private:
 	// search stuff
 	long*           m_searchOffsets;
 	long            m_searchOffsetsMax;   // if m_searchOffsets is set, this is typically the number of phys. albums
 	long            m_searchOffsetsCount; // -1 indicated "no search", use HasSearch() for testing
-	SjLLHash        m_searchTracksHash;
+	SjIdSet         m_searchTrackIds;
 	SjSearch        m_search;
+	SjLibrarySearchThread* m_searchThread; // NULL until the first asynchronous search
+	long            m_searchGeneration; // incremented for each search, results of older searches are dropped
+	bool            m_searchPending;
+	SjLibrarySearchJob* PrepareSearchJob(const SjSearch&);
+	void            ApplySearchJob      (SjLibrarySearchJob*, SjSearchStat&);
 	bool            HasSearch           () {return m_searchOffsetsCount==-1? FALSE : TRUE;}
-	bool            IsInSearch          (long trackId) {return m_searchOffsetsCount==-1? TRUE : (m_searchTracksHash.Lookup(trackId)!=0); }
+	bool            IsInSearch          (long trackId) {return m_searchOffsetsCount==-1? TRUE : m_searchTrackIds.Lookup(trackId); }
 	bool            ModifySearch        (int keyCode, bool modifiersPressed);
 	bool            HiliteSearchWords   (wxString&);
 	SjCol*          GetCol__            (long dbAlbumIndex, long virtualAlbumIndex, bool regardSearch);
 
 	// filter stuff
-	SjLLHash        m_filterHash;
+	SjIdSet         m_filterIds;
 	long            m_filterAzFirst[27]; // a, b, c, ... z, 0-9 -> log. offsets
 	bool            m_filterAzFirstHidden;
 	wxString        m_filterCond;
+	sqlite3*        m_filterFuncDb;     // the connection INFILTER() is registered for
 
 	// selection stuff
 	void            SelectByQuery       (bool select, const wxString& formattedQuery);
 	void            AskToAddSelection   ();
-	SjLLHash        m_selectedTrackIds;
+	SjIdSet         m_selectedTrackIds;
 
 	// remembered values - use eg. GetUnmaskedTrackCount() and GetMaskedColCount() instead
 	long            m_rememberedUnmaskedTrackCount;
@@ -228,7 +261,11 @@ private:
 
 	bool            m_deepUpdate;
 	unsigned long   m_updateStartingTime; // the DOS timestamp the update process started
-	SjIdCollector   m_updatedTracks;
+	SjIdSet         m_updatedTracks;
+	wxArrayPtrVoid  m_pendingTrackInfos; // SjTrackInfo objects received but not yet written, see FlushTrackInfos()
+	SjLibraryTrackWriter* m_trackWriter; // compiled statements for the update, see GetTrackWriter()
+	SjLibraryTrackWriter* GetTrackWriter ();
+	void            FreeTrackWriter     ();
 
 	SjCoverFinder   m_coverFinder;
 
@@ -242,6 +279,8 @@ private:
 	bool            Callback_ReceiveTrackInfo (SjTrackInfo*);
 
 	bool            WriteTrackInfo      (SjTrackInfo*, long trackId, bool writeArtIds=TRUE);
+	bool            WriteTrackInfos     (const wxArrayPtrVoid& trackInfos);
+	bool            FlushTrackInfos     (bool write);
 
 	bool            CombineTracksToAlbums();
 	bool            UpdateUniqueValues  (const wxString& name);
@@ -258,9 +297,13 @@ private:
 
 	SjLLHash        m_addedArtIds;
 
-	wxRegEx         m_hiliteRegEx;
-	bool            m_hiliteRegExOk;
-	wxString        m_hiliteRegExFor;
+	// statistics not yet written, see SavePendingData()
+	SjSPHash        m_pendingPlaybacks; // URL -> SjPendingPlayback*
+	unsigned long   m_pendingTimestamp; // time of the oldest pending playback, 0 if there is nothing pending
+	void            SavePlayback        (const wxString& url, const SjPendingPlayback*);
+
+	SjHiliter       m_hiliter;
+	wxString        m_hiliterFor;
 
 	friend class    SjLibraryConfigPage;
 	friend class    SjLibraryEditDlg;
@@ -273,6 +316,7 @@ private:
 	friend class    SjTagEditorDlg;
 	friend class    SjUpdateAlbum;
 	friend class    SjLibraryListView;
+	friend class    SjBenchmark;
 };
 
 
@@ -379,7 +423,7 @@ public:
 	bool            OnDropData          (SjDataObject*);
 
 	int             IsSelectable        () {return 2;}
-	bool            IsSelected          () { return m_libraryModule->m_selectedTrackIds.Lookup(m_trackId)!=0; }
+	bool            IsSelected          () { return m_libraryModule->m_selectedTrackIds.Lookup(m_trackId); }
 	void            Select              (bool select);
 
 	int             UsesMiddleClick     () { return 2; }
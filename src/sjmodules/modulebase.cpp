@@ -147,6 +147,13 @@ void SjModuleSystem::Init()
 		if( !db->IsOk() ) { SjMainApp::FatalError(); }
 		db->SetDefault();
 
+		// ...journal mode and the read-only connections for other threads; the WAL mode
+		// is stored in the file, so SetWal() also switches back if the setting is changed.
+		// The mmap size and the number of readers are per connection and set on every opening.
+		db->SetWal(g_tools->m_config->Read("main/idxWal", SJ_DEF_SQLITE_WAL)!=0);
+		db->SetMmapSize(g_tools->m_config->Read("main/idxMmapBytes", SJ_DEF_SQLITE_MMAP_BYTES));
+		db->SetMaxReaders(g_tools->m_config->Read("main/idxReaders", SJ_DEF_SQLITE_READERS));
+
 		// ...the database version: if the major version of the database is
 		// _larger_, the database cannot be opened.  However, the version
 		// normally does not change at all as we can add tables and fields as
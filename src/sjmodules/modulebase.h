@@ -81,7 +81,7 @@ public:
 	long            m_samplerate;
 	long            m_channels;
 	long            m_playtimeMs;
-	long            m_autoVol;      // we store the gain * 1000 here, eg. 4321 for 4.321, 0 indicates no information
+	long            m_autoVol;      // we store the gain * 1000 here, eg. 4321 for 4.321, 0 indicates no information, -1 that the track cannot be analysed
 
 	wxString        m_trackName;
 	long            m_trackNr;
@@ -604,9 +604,8 @@ public:
 	// when the size has changed ... the module should call SjVisWindow::GetRendererClientRect() or SjVisImpl::GetRendererScreenRect()
 	virtual void    PleaseUpdateSize    (SjVisWindow*) = 0;
 
-	// AddVisData() function is called from without the audio DSP output, so please be fast and do not do
-	// weird things here!
-	virtual void    AddVisData          (const float* buffer, long bytes) {}
+	// the audio data are not pushed to the renderer; they can be read at
+	// any time from SjVisModule::GetVisData()
 
 	// Used to find out a window that can be used as a parent for the overlay.
 	virtual wxWindow* GetSuitableParentForOverlay() = 0;
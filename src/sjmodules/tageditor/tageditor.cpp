@@ -754,7 +754,7 @@ bool SjTagEditorDlg::Dsk2Data_CopyAllData(int what, bool logErrors)
 			samplerateCount++;
 		}
 
-		if( currTrackInfo.m_autoVol )
+		if( currTrackInfo.m_autoVol > 0 )
 		{
 			gain += currTrackInfo.m_autoVol;
 			gainCount++;
@@ -1098,7 +1098,7 @@ void SjTagEditorDlg::Data2Dlg_CopyInfo(bool showMoreInfo)
 			temp += wxString(wxT(", ")) + _("Album") + wxString(wxT(": ")) + SjTools::FormatGain(albumGain);
 		}
 	}
-	else if( m_dataStat.m_autoVol )
+	else if( m_dataStat.m_autoVol > 0 )
 	{
 		temp = SjTools::FormatGain(::SjLong2Gain(m_dataStat.m_autoVol));
 	}
@@ -1703,6 +1703,7 @@ void SjTagEditorDlg::RenameDone__(const wxString& oldUrl, const wxString& newUrl
 
 		// update database
 		sql.Query(wxT("UPDATE tracks SET url='") + sql.QParam(newUrl) + wxT("' WHERE url='") + sql.QParam(oldUrl) + wxT("';"));
+		g_mainFrame->m_libraryModule->m_advSearchCache.Invalidate(SJ_SEARCHDEP_TAGS);
 	}
 
 	// inform the main frame about the change --
@@ -0,0 +1,96 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2016 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    vis_analysis.cpp
+ * Authors: Björn Petersen
+ * Purpose: Samples and spectrum shared by all renderers
+ *
+ ******************************************************************************/
+
+
+#include <sjbase/base.h>
+#include <sjmodules/vis/vis_analysis.h>
+#include <math.h>
+
+
+SjVisAnalysis::SjVisAnalysis()
+{
+	m_fftCfg = kiss_fftr_alloc(SJ_VIS_FFT_SIZE, 0, NULL, NULL);
+
+	for( int i = 0; i < SJ_VIS_FFT_SIZE; i++ )
+	{
+		m_window[i] = 0.5F - 0.5F * cos(2.0*M_PI*i/(SJ_VIS_FFT_SIZE-1));
+	}
+
+	m_blockPos = -1;
+	memset(m_samples, 0, sizeof(m_samples));
+	memset(m_spectrum, 0, sizeof(m_spectrum));
+}
+
+
+SjVisAnalysis::~SjVisAnalysis()
+{
+	kiss_fftr_free(m_fftCfg);
+}
+
+
+void SjVisAnalysis::Update(const SjRingbuffer& buffer)
+{
+	int64_t writePos = buffer.GetWritePos();
+	if( writePos == m_blockPos || m_fftCfg == NULL ) {
+		return; // nothing new
+	}
+	m_blockPos = writePos;
+
+	// get the newest frames and split them into the channels; if there are not
+	// enough samples yet, the block is padded with silence at the beginning
+	long valid = buffer.ReadLast(m_frames, SJ_VIS_FFT_SIZE*2) / 2;
+	long pad = SJ_VIS_FFT_SIZE - valid, i, ch;
+	for( i = 0; i < pad; i++ )
+	{
+		m_samples[0][i] = 0;
+		m_samples[1][i] = 0;
+	}
+	for( i = 0; i < valid; i++ )
+	{
+		m_samples[0][pad+i] = m_frames[i*2];
+		m_samples[1][pad+i] = m_frames[i*2+1];
+	}
+
+	// one FFT per channel; the window halves the amplitude, so we correct this
+	for( ch = 0; ch < 2; ch++ )
+	{
+		kiss_fft_scalar in[SJ_VIS_FFT_SIZE];
+		kiss_fft_cpx out[SJ_VIS_SPECTRUM_BINS+1];
+		for( i = 0; i < SJ_VIS_FFT_SIZE; i++ )
+		{
+			in[i] = m_samples[ch][i] * m_window[i];
+		}
+
+		kiss_fftr(m_fftCfg, in, out);
+
+		float* spectrum = m_spectrum[ch];
+		for( i = 0; i < SJ_VIS_SPECTRUM_BINS; i++ )
+		{
+			spectrum[i] = 2.0F * sqrt(out[i].r*out[i].r + out[i].i*out[i].i);
+		}
+	}
+}
@@ -0,0 +1,75 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2016 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    vis_analysis.h
+ * Authors: Björn Petersen
+ * Purpose: Samples and spectrum shared by all renderers
+ *
+ ******************************************************************************/
+
+
+#ifndef __SJ_VIS_ANALYSIS_H__
+#define __SJ_VIS_ANALYSIS_H__
+
+
+#include <sjtools/ringbuffer.h>
+#include <kiss_fft/tools/kiss_fftr.h>
+
+
+// the number of samples per channel analysed at once; this is what the
+// oscilloscope always used - 1152 = 2^7*9 is fine for kiss_fft
+#define SJ_VIS_FFT_SIZE         1152
+#define SJ_VIS_SPECTRUM_BINS    (SJ_VIS_FFT_SIZE/2)
+
+
+class SjVisAnalysis
+{
+public:
+	                SjVisAnalysis       ();
+	                ~SjVisAnalysis      ();
+
+	// Analyse the newest SJ_VIS_FFT_SIZE stereo frames of the given buffer.
+	// Nothing is done if nothing was added since the last call, so all renderers
+	// may call this function for every frame.  Must be called from the main thread.
+	void            Update              (const SjRingbuffer&);
+
+	// The write position of the analysed block; changes if the results change.
+	int64_t         GetBlockPos         () const { return m_blockPos; }
+
+	// The analysed samples of the given channel (0=left, 1=right), the newest sample is the last one.
+	const float*    GetSamples          (int ch) const { return m_samples[ch]; }
+
+	// The magnitudes of the Hann windowed spectrum, SJ_VIS_SPECTRUM_BINS per channel.
+	// The values are not normalised, a full scale sine results in about SJ_VIS_FFT_SIZE/2.
+	const float*    GetSpectrum         (int ch) const { return m_spectrum[ch]; }
+
+private:
+	kiss_fftr_cfg   m_fftCfg;
+	float           m_window[SJ_VIS_FFT_SIZE];
+	float           m_frames[SJ_VIS_FFT_SIZE*2];
+
+	int64_t         m_blockPos;
+	float           m_samples[2][SJ_VIS_FFT_SIZE];
+	float           m_spectrum[2][SJ_VIS_SPECTRUM_BINS];
+};
+
+
+#endif // __SJ_VIS_ANALYSIS_H__
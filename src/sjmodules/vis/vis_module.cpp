@@ -67,6 +67,7 @@ SjVisModule::SjVisModule(SjInterfaceBase* interf)
 	m_visIsStarted              = false;
 	m_overlay                   = NULL;
 	m_modal                     = 0;
+	m_visData.Alloc(SJ_VIS_DATA_SAMPLES);
 }
 
 
@@ -353,16 +354,6 @@ SjVisRendererModule* SjVisModule::GetCurrRenderer() const
 }
 
 
-void SjVisModule::AddVisData(const float* data, long bytes)
-{
-	SjVisRendererModule* renderer = GetCurrRenderer();
-	if( renderer )
-	{
-		renderer->AddVisData(data, bytes);
-	}
-}
-
-
 void SjVisModule::ReceiveMsg(int msg)
 {
 	if( msg == IDMODMSG_WINDOW_SIZED_MOVED )
@@ -30,6 +30,10 @@
 #define __SJ_VIS_MODULE_H__
 
 
+#include <sjtools/ringbuffer.h>
+#include <sjmodules/vis/vis_analysis.h>
+
+
 class SjVisWindow;
 class SjVisOverlay;
 class SjVisFrame;
@@ -62,7 +66,15 @@ public:
 	// menu entries. CAVE: IsVisStarted() and AddVisData() are called by SjPlayer::DSPCallback(),
 	// so please do not any weird things here (checking windows handles etc. is not possible)
 	bool            IsVisStarted        () const { return m_visIsStarted; }
-	void            AddVisData          (const float* data, long bytes);
+	void            AddVisData          (const float* data, long bytes) { m_visData.Write(data, bytes/sizeof(float)); }
+
+	// The samples given to AddVisData() (interleaved stereo floats); the renderers
+	// read from here in their own thread, the audio thread never waits for them.
+	#define         SJ_VIS_DATA_SAMPLES 65536
+	const SjRingbuffer& GetVisData      () const { return m_visData; }
+
+	// Spectrum etc. of the newest samples, calculated once for all renderers; main thread only.
+	const SjVisAnalysis& GetVisAnalysis () { m_visAnalysis.Update(m_visData); return m_visAnalysis; }
 
 	// More state
 	bool            IsOverWorkspace     () const { return (m_visWindowVisible && !m_visOwnFrame && m_visIsOverWorkspace); }
@@ -131,6 +143,9 @@ private:
 	// set if vis. module opens a modal dialog; avoids closing
 	long            m_modal;
 
+	SjRingbuffer    m_visData;
+	SjVisAnalysis   m_visAnalysis;
+
 	// temp. needed for IDMODMSG_VIS_FWD_SWITCH_RENDER, can be referred easily by SJ_SET_FROM_TEMP1STR
 	wxString        m_temp1str__;
 };
@@ -29,14 +29,16 @@
 #include <sjbase/base.h>
 #include <sjmodules/vis/vis_oscilloscope.h>
 #include <sjmodules/vis/vis_window.h>
+#include <sjmodules/vis/vis_module.h>
 #include <math.h>
-#include <kiss_fft/tools/kiss_fftr.h>
 
 // you should not change SLEEP_MS without reasons.
 // IF you change it, also check if really all time-depending calculations are still correct.
 // (a sleep of 30 ms will render about 33 frames/s; on my 2012er i7, 2,9 GHz each frames needs about 0-1 ms for calculation)
 #define SLEEP_MS 30
 
+#define float_to_short ((float)0x7FFF) // Multiplier for making 16-bit integer
+
 
 /*******************************************************************************
  *  SjOscStarfield
@@ -924,7 +926,7 @@ public:
 	                SjOscSpectrum       ();
 	                ~SjOscSpectrum      ();
 	void            Calc                (const wxSize& clientSize,
-	                                     const unsigned char* bufferStart);
+	                                     const SjVisAnalysis* analysis); // NULL for silence
 	void            Draw                (wxDC& dc, bool volumeBeat, bool showFigures, bool forceAnim)
 	{	Draw(dc, &m_chData[0], volumeBeat, showFigures, forceAnim);
 		Draw(dc, &m_chData[1], volumeBeat, showFigures, forceAnim);
@@ -932,7 +934,6 @@ public:
 
 private:
 	wxSize          m_clientSize;
-	kiss_fftr_cfg   m_kiss_fft_setup;
 	SjOscSpectrumChData m_chData[2];
 
 	void            Draw                (wxDC&, SjOscSpectrumChData* chData, bool volumeBeat, bool showFigures, bool forceAnim);
@@ -957,7 +958,7 @@ private:
 
 SjOscSpectrum::SjOscSpectrum()
 {
-	m_kiss_fft_setup    = kiss_fftr_alloc(SPEC_NUM*2, 0, NULL, 0);
+	wxASSERT( SPEC_NUM == SJ_VIS_SPECTRUM_BINS );
 	m_chData[0].chNum   = 0;
 	m_chData[1].chNum   = 1;
 
@@ -983,29 +984,16 @@ SjOscSpectrum::SjOscSpectrum()
 }
 
 
-void SjOscSpectrum::Calc(const wxSize& clientSize, const unsigned char* bufferStart)
+void SjOscSpectrum::Calc(const wxSize& clientSize, const SjVisAnalysis* analysis)
 {
 	m_clientSize = clientSize;
 
-	// convert to double
-	signed short*       bufferSShort = (signed short*)bufferStart;
+	// the spectrum is calculated by SjVisAnalysis, shared with other renderers
 	long                i, ch;
-	kiss_fft_scalar     kiss_in[2][SPEC_NUM*2];
-
-	for( i = 0; i < SPEC_NUM*2; i++ )
-	{
-		#define  float_to_short ((float)0x7FFF) // Multiplier for making 16-bit integer
-		kiss_in[0][i]  = (float)(*bufferSShort++) / float_to_short;
-		kiss_in[1][i] = (float)(*bufferSShort++) / float_to_short;
-	}
 
 	static const int equalizer[20] = {9,11,12,13,20,23,28,36,52,60,70,90,110,140,140,150,150,150,150,160};
-	kiss_fft_cpx kiss_out[SPEC_NUM*2];
 	for( ch = 0; ch < 2; ch++ )
 	{
-		// get spectrum data
-		kiss_fftr(m_kiss_fft_setup, kiss_in[ch], kiss_out);
-
 		// calculate all boxes
 		double* boxY = m_chData[ch].m_boxY;
 		for( i = 0; i < NUM_BOXES; i++ )
@@ -1013,12 +1001,16 @@ void SjOscSpectrum::Calc(const wxSize& clientSize, const unsigned char* bufferSt
 			boxY[i] = 0;
 		}
 
+		if( analysis == NULL )
+		{
+			continue;
+		}
+
+		const float* spectrum = analysis->GetSpectrum(ch);
 		double amplitude = 0.03f;
 		for( i = 0; i < SPEC_NUM; i++ )
 		{
-			kiss_fft_scalar absval = sqrt(static_cast<double>(kiss_out[i].r * kiss_out[i].r)
-			                              + static_cast<double>(kiss_out[i].i * kiss_out[i].i));
-			double y = amplitude*absval;
+			double y = amplitude*spectrum[i];
 
 			boxY[m_freqToBox[i]] += y;
 		}
@@ -1164,7 +1156,6 @@ void SjOscSpectrum::Draw(wxDC& dc, SjOscSpectrumChData* chData, bool volumeBeat,
 
 SjOscSpectrum::~SjOscSpectrum()
 {
-	kiss_fftr_free(m_kiss_fft_setup);
 }
 
 
@@ -1183,13 +1174,9 @@ private:
 	SjOscModule*        m_oscModule;
     wxBitmap            m_offscreenBitmap;
     wxMemoryDC          m_offscreenDc;
-    unsigned char*      m_bufferStart;
     unsigned char*      m_bufferTemp;
     #define             BUFFER_MIN_BYTES (576*2*sizeof(float))
-    long                m_bufferTotalBytes;
-    long                m_bufferValidBytes;
-    bool                m_bufferDrawn;
-    wxCriticalSection   m_bufferCritical;
+    int64_t             m_bufferWritePos;
     long                m_sampleCount_;
 	wxColour            m_textColour;
 	wxColour            m_fgColour;
@@ -1251,14 +1238,8 @@ SjOscWindow::SjOscWindow(SjOscModule* oscModule, wxWindow* parent)
 {
 	m_oscModule = oscModule;
 
-	m_bufferTotalBytes = 0;
-	m_bufferValidBytes = 0;
-	m_bufferDrawn = false;
-	m_bufferStart = (unsigned char*)malloc(BUFFER_MIN_BYTES);
+	m_bufferWritePos = 0;
 	m_bufferTemp = (unsigned char*)malloc(BUFFER_MIN_BYTES);
-	if( m_bufferStart && m_bufferTemp ) {
-		m_bufferTotalBytes = BUFFER_MIN_BYTES;
-	}
 
 	// set colors
 	m_textColour = wxColour(0x2F, 0x60, 0xA3);
@@ -1288,7 +1269,6 @@ SjOscWindow::~SjOscWindow()
 	if( m_hands )        { delete m_hands; }
 	if( m_firework )     { delete m_firework; }
 	if( m_starfield )    { delete m_starfield; }
-	if( m_bufferStart )  { free(m_bufferStart); }
 	if( m_bufferTemp )   { free(m_bufferTemp); }
 	m_oscModule = NULL;
 }
@@ -1300,8 +1280,6 @@ void SjOscWindow::OnTimer(wxTimerEvent&)
 
 	if( m_oscModule )
 	{
-		long                validBytes;
-
 		// volume stuff
 		long                volume, maxVolume = 1;
 		bool                volumeBeat;
@@ -1311,19 +1289,29 @@ void SjOscWindow::OnTimer(wxTimerEvent&)
 		bool                titleChanged, forceOscAnim, forceSpectrAnim;
 		wxString            newTitle;
 
-		// get data
-		if( m_bufferStart==NULL || m_bufferTemp == NULL ) return;
-		m_bufferCritical.Enter();
-			validBytes = m_bufferValidBytes;
-			m_bufferDrawn = true;
-			if( validBytes > 0 ) {
-				memcpy(m_bufferTemp, m_bufferStart, validBytes);
-			}
-			else {
-				validBytes = BUFFER_MIN_BYTES;
-				memset(m_bufferTemp, 0, validBytes);
+		// get data - the newest samples and their spectrum, see SjVisAnalysis; the samples
+		// are converted to interleaved signed shorts. if nothing was added since the
+		// last call (eg. on pause), we show silence
+		if( m_bufferTemp == NULL ) return;
+		const SjVisAnalysis& analysis = g_visModule->GetVisAnalysis();
+		bool silence = (analysis.GetBlockPos() == m_bufferWritePos);
+		m_bufferWritePos = analysis.GetBlockPos();
+		{
+			wxASSERT( BUFFER_MIN_BYTES == SJ_VIS_FFT_SIZE*2*sizeof(signed short) );
+			signed short* dest = (signed short*)m_bufferTemp;
+			float sample;
+			long s, ch;
+			for( s = 0; s < SJ_VIS_FFT_SIZE; s++ )
+			{
+				for( ch = 0; ch < 2; ch++ )
+				{
+					sample = silence? 0 : analysis.GetSamples(ch)[s] * float_to_short;
+					if( sample < -32768 ) sample = -32768;
+					if( sample >  32767 ) sample =  32767;
+					*dest++ = sample;
+				}
 			}
-		m_bufferCritical.Leave();
+		}
 
 		// get window client size, correct offscreen DC if needed
 		wxSize clientSize = m_oscModule->m_oscWindow->GetClientSize();
@@ -1342,7 +1330,7 @@ void SjOscWindow::OnTimer(wxTimerEvent&)
 			m_oscilloscope->Calc(drawSize, m_bufferTemp, volume);
 			if( m_oscModule->m_showFlags&SJ_OSC_SHOW_SPECTRUM )
 			{
-				m_spectrum->Calc(drawSize, m_bufferTemp);
+				m_spectrum->Calc(drawSize, silence? NULL : &analysis);
 			}
 		}
 
@@ -1559,42 +1547,3 @@ void SjOscModule::OnMenuOption(int i)
 	g_tools->m_config->Write(wxT("player/oscflags"), m_showFlags);
 }
 
-
-
-void SjOscModule::AddVisData(const float* src, long bytes)
-{
-	if( m_oscWindow && m_oscWindow->m_bufferStart && bytes )
-	{
-		m_oscWindow->m_bufferCritical.Enter();
-
-			// resize the buffer, if needed
-			if( m_oscWindow->m_bufferDrawn ) {
-				m_oscWindow->m_bufferValidBytes = 0;
-				m_oscWindow->m_bufferDrawn = false;
-			}
-			long bytesWanted = m_oscWindow->m_bufferValidBytes + bytes / 2/*use use short, not float*/;
-			if( bytesWanted > m_oscWindow->m_bufferTotalBytes )
-			{
-                m_oscWindow->m_bufferStart = (unsigned char*)realloc(m_oscWindow->m_bufferStart, bytesWanted);
-                m_oscWindow->m_bufferTemp  = (unsigned char*)realloc(m_oscWindow->m_bufferTemp,  bytesWanted);
-                if( m_oscWindow->m_bufferStart == NULL || m_oscWindow->m_bufferTemp == NULL ) { return; }
-			}
-
-			// copy the buffer, convert float to singed shorts
-			long s, numSamples = bytes/4;
-			signed short* dest =  (signed short*)(&m_oscWindow->m_bufferStart[m_oscWindow->m_bufferValidBytes]);
-			float sample;
-			for( s = 0; s < numSamples; s++ )
-			{
-				sample = src[s] * float_to_short;
-				if( sample < -32768 ) sample = -32768;
-				if( sample >  32767 ) sample =  32767;
-				dest[s] = sample;
-			}
-
-			m_oscWindow->m_bufferValidBytes += bytes / 2;
-
-		m_oscWindow->m_bufferCritical.Leave();
-	}
-}
-
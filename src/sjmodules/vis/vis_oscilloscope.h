@@ -49,7 +49,6 @@ public:
 	void            AddMenuOptions      (SjMenu&);
 	void            OnMenuOption        (int);
 	void            PleaseUpdateSize    (SjVisWindow*);
-	void            AddVisData          (const float* buffer, long bytes);
 	wxWindow*       GetSuitableParentForOverlay() { return (wxWindow*)m_oscWindow; }
 
 private:
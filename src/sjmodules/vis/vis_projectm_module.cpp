@@ -31,9 +31,11 @@
 #include <wx/glcanvas.h>
 #include <sjtools/msgbox.h>
 #include <sjmodules/vis/vis_window.h>
+#include <sjmodules/vis/vis_module.h>
 #include <sjmodules/vis/vis_projectm_module.h>
 #include <prjm/src/projectM.hpp>
 #include <prjm/src/Renderer/BeatDetect.hpp>
+#include <prjm/src/MeshWorkerPool.hpp>
 
 
 /*******************************************************************************
@@ -166,6 +168,13 @@ void SjProjectmGlCanvas::OnTimer(wxTimerEvent&)
 			false, // bool softCutRatingsEnabled;
 		};
 
+		// the per pixel mesh is calculated by some worker threads; "main/prjmthreads" is the number
+		// of threads to use (0=one per cpu, 1=no threads), the other options are for testing only
+		MeshWorkerPool::configure(g_tools->m_config->Read("main/prjmthreads", 0L),
+		                          g_tools->m_config->Read("main/prjmdeterministic", 0L)!=0);
+		s_theProjectmModule->m_prjmTimings = g_tools->m_config->Read("main/prjmtimings", 0L)!=0;
+		s_theProjectmModule->m_prjmTimingsMs = SjTools::GetMsTicks();
+
 		try {
 			s_theProjectmModule->m_projectMobj = new projectM(s, projectM::FLAG_NONE);
 
@@ -193,6 +202,8 @@ void SjProjectmGlCanvas::OnTimer(wxTimerEvent&)
 
 			wxSize size = GetSize();
 			s_theProjectmModule->m_projectMobj->projectM_resetGL(size.x, size.y);
+
+			s_theProjectmModule->m_visDataPos = g_visModule->GetVisData().GetWritePos();
 		}
 		catch(...) {
 			s_theProjectmModule->m_projectMobj = NULL;
@@ -211,7 +222,14 @@ void SjProjectmGlCanvas::OnTimer(wxTimerEvent&)
 
 		//SetCurrent(*s_theProjectmModule->m_glContext); -- this is only needed if we use several GL contexts at the same in the same thread
 
+		// forward the samples added since the last frame to projectM
+		long samples = g_visModule->GetVisData().ReadNew(s_theProjectmModule->m_visDataPos,
+		                    s_theProjectmModule->m_visSamples, SJ_PRJM_VIS_SAMPLES);
+
 		try {
+			if( samples > 0 ) {
+				s_theProjectmModule->m_projectMobj->pcm()->addPCMfloat(s_theProjectmModule->m_visSamples, samples);
+			}
 			s_theProjectmModule->m_projectMobj->renderFrame();
 		}
 		catch(...) {
@@ -219,6 +237,25 @@ void SjProjectmGlCanvas::OnTimer(wxTimerEvent&)
 
 		s_theProjectmModule->m_glCanvas->SwapBuffers();
 
+		if( s_theProjectmModule->m_prjmTimings )
+		{
+			unsigned long thisMs = SjTools::GetMsTicks();
+			if( thisMs - s_theProjectmModule->m_prjmTimingsMs > 10000 )
+			{
+				s_theProjectmModule->m_prjmTimingsMs = thisMs;
+				float ms[MeshWorkerPool::NUM_STAGES];
+				int frames = MeshWorkerPool::getTimings(ms);
+				wxLogInfo("projectM: %i frames, per-pixel equations %.2f ms/frame, per-pixel math %.2f ms/frame"/*n/t*/,
+					frames, ms[MeshWorkerPool::STAGE_PER_PIXEL_EQNS], ms[MeshWorkerPool::STAGE_PER_PIXEL_MATH]);
+				PresetPreloader::Stats stats = s_theProjectmModule->m_projectMobj->getPresetPreloadStats();
+				if( stats.preloaded || stats.loaded || stats.failed )
+				{
+					wxLogInfo("projectM: %i presets preloaded (parsed in %.1f ms, waited %.1f ms), %i loaded on transition (%.1f ms), %i errors"/*n/t*/,
+						stats.preloaded, stats.parseMs, stats.waitMs, stats.loaded, stats.loadMs, stats.failed);
+				}
+			}
+		}
+
 		#ifdef __WXMSW__
 			wxASSERT( _CrtCheckMemory() );
 		#endif
@@ -240,6 +277,9 @@ SjProjectmModule::SjProjectmModule(SjInterfaceBase* interf)
 	m_glCanvas          = NULL;
 	m_glContext         = NULL;
 	m_projectMobj       = NULL;
+	m_prjmTimings       = false;
+	m_prjmTimingsMs     = 0;
+	m_visDataPos        = 0;
 	s_theProjectmModule = this;
 	m_sort              = 1; // start of list, defaukt is 1000
 }
@@ -523,17 +563,4 @@ void SjProjectmModule::PleaseUpdateSize(SjVisWindow* impl)
 }
 
 
-void SjProjectmModule::AddVisData(const float* buffer, long bytes)
-{
-	if( m_projectMobj )
-	{
-		try {
-			m_projectMobj->pcm()->addPCMfloat(buffer, bytes/sizeof(float));
-		}
-		catch(...) {
-		}
-	}
-}
-
-
 #endif // SJ_USE_PROJECTM
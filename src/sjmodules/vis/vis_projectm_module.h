@@ -49,7 +49,6 @@ public:
 	void            AddMenuOptions      (SjMenu&);
 	void            OnMenuOption        (int);
 	void            PleaseUpdateSize    (SjVisWindow*);
-	void            AddVisData          (const float* buffer, long bytes);
 	wxWindow*       GetSuitableParentForOverlay() { return (wxWindow*)m_glCanvas; }
 
 private:
@@ -60,6 +59,11 @@ private:
 	#define         SJ_PRJMDURATION_STD     20
 	#define         SJ_PRJMDURATION_MAX     36000 // allow large values to be set in the INI, with the risk sth. is working wrong. Via the GUI, we allow only up to 5 minutes.
 	int             m_prjmDuration;
+	bool            m_prjmTimings;
+	unsigned long   m_prjmTimingsMs;
+	#define         SJ_PRJM_VIS_SAMPLES     4096 // projectM's PCM buffer holds 2048 samples per channel
+	float           m_visSamples[SJ_PRJM_VIS_SAMPLES];
+	int64_t         m_visDataPos;
 	bool            FirstLoad           ();
 	void            WritePrjmConfig     ();
 
@@ -45,7 +45,7 @@ public:
 	static void     Yield               () {
 		wxASSERT(s_inYield==0);
 		wxASSERT(wxThread::IsMain());
-		if(s_inYield==0) {s_inYield++; wxYield(); s_inYield--;}
+		if(s_inYield==0) {SJ_STALL_SCOPE("SjBusyInfo::Yield"); s_inYield++; wxYield(); s_inYield--;}
 	}
 	static bool     InYield             () { return (s_dlgOpen || (s_inYield!=0)); }
 
@@ -79,6 +79,7 @@ private:
 	friend class    SjLogDialog;
 	friend class    SjImgThread;  // to access s_this needed for wxLog::SetThreadActiveTarget()
 	friend class    SjHttpThread; //                - " -
+	friend class    SjLibrarySearchThread; //       - " -
 };
 
 
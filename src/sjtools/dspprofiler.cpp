@@ -0,0 +1,199 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2016 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    dspprofiler.cpp
+ * Authors: Björn Petersen
+ * Purpose: Measuring the stages of the audio callback
+ *
+ ******************************************************************************/
+
+
+#include <sjbase/base.h>
+#include <sjtools/dspprofiler.h>
+#include <chrono>
+
+
+SjDspProfiler::SjDspProfiler()
+{
+	m_enabled = false;
+	Reset();
+}
+
+
+void SjDspProfiler::Enable(bool enable)
+{
+	wxASSERT( wxThread::IsMain() );
+
+	if( enable == IsEnabled() ) {
+		return;
+	}
+
+	if( enable )
+	{
+		Reset();
+		m_enabled.store(true, std::memory_order_relaxed);
+	}
+	else
+	{
+		m_enabled.store(false, std::memory_order_relaxed);
+		if( m_stages[SJ_DSP_TOTAL].calls > 0 )
+		{
+			wxArrayString lines = SjTools::Explode(GetStats(), wxT('\n'), 1);
+			for( size_t i = 0; i < lines.GetCount(); i++ ) {
+				wxLogInfo(wxT("%s"), lines[i].c_str());
+			}
+		}
+	}
+}
+
+
+void SjDspProfiler::Reset()
+{
+	// the audio threads may still add some values while we're resetting; this is not worth a lock
+	for( int stage = 0; stage < SJ_DSP_STAGE_COUNT; stage++ )
+	{
+		Stage& s = m_stages[stage];
+		s.calls.store(0, std::memory_order_relaxed);
+		s.totalUs.store(0, std::memory_order_relaxed);
+		s.maxUs.store(0, std::memory_order_relaxed);
+		for( int bucket = 0; bucket < SJ_DSP_HISTO_BUCKETS; bucket++ ) {
+			s.histo[bucket].store(0, std::memory_order_relaxed);
+		}
+	}
+	m_lateBuffers.store(0, std::memory_order_relaxed);
+	m_tightBuffers.store(0, std::memory_order_relaxed);
+	m_bufferUs.store(0, std::memory_order_relaxed);
+	m_startTimestamp = SjTools::GetMsTicks();
+}
+
+
+int64_t SjDspProfiler::GetUsTicks()
+{
+	// not wxGetUTCTimeUSec() - the wall clock may be adjusted while we're measuring
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void SjDspProfiler::AddStage(int stage, int64_t us)
+{
+	Stage& s = m_stages[stage];
+	s.calls.fetch_add(1, std::memory_order_relaxed);
+	s.totalUs.fetch_add(us, std::memory_order_relaxed);
+
+	int64_t oldMax = s.maxUs.load(std::memory_order_relaxed);
+	while( us > oldMax
+	   && !s.maxUs.compare_exchange_weak(oldMax, us, std::memory_order_relaxed) ) {
+		;
+	}
+
+	int bucket = 0;
+	while( bucket < SJ_DSP_HISTO_BUCKETS-1 && us >= ((int64_t)1<<bucket) ) {
+		bucket++;
+	}
+	s.histo[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void SjDspProfiler::AddBuffer(int64_t totalUs, int64_t bufferUs)
+{
+	AddStage(SJ_DSP_TOTAL, totalUs);
+
+	if( bufferUs > 0 )
+	{
+		m_bufferUs.fetch_add(bufferUs, std::memory_order_relaxed);
+		if( totalUs > bufferUs ) {
+			m_lateBuffers.fetch_add(1, std::memory_order_relaxed);
+		}
+		else if( totalUs > bufferUs/2 ) {
+			m_tightBuffers.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
+
+
+const wxChar* SjDspProfiler::GetStageName(int stage)
+{
+	switch( stage )
+	{
+		case SJ_DSP_VOLCALC:    return wxT("volume calculation");
+		case SJ_DSP_AUTOVOL:    return wxT("auto volume");
+		case SJ_DSP_EQUALIZER:  return wxT("equalizer");
+		case SJ_DSP_VIS:        return wxT("visualisation");
+		case SJ_DSP_FADE:       return wxT("fading");
+		case SJ_DSP_MIXDOWN:    return wxT("volume/mixdown");
+		default:                return wxT("total");
+	}
+}
+
+
+int64_t SjDspProfiler::GetPercentileUs(const Stage& s, int percent)
+{
+	// returns the upper limit of the bucket that contains the percentile
+	int64_t needed = (s.calls*percent + 99) / 100, sum = 0;
+	for( int bucket = 0; bucket < SJ_DSP_HISTO_BUCKETS-1; bucket++ )
+	{
+		sum += s.histo[bucket];
+		if( sum >= needed ) {
+			int64_t limit = (int64_t)1<<bucket;
+			int64_t maxUs = s.maxUs.load(std::memory_order_relaxed);
+			return limit < maxUs? limit : maxUs;
+		}
+	}
+	return s.maxUs.load(std::memory_order_relaxed);
+}
+
+
+wxString SjDspProfiler::GetStats() const
+{
+	const Stage& total = m_stages[SJ_DSP_TOTAL];
+
+	wxString ret = wxString::Format(wxT("DSP profile: %s, %i buffers, %i late, %i tight, load %.2f%%"),
+	                                SjTools::FormatMs(SjTools::GetMsTicks()-m_startTimestamp).c_str(),
+	                                (int)total.calls, (int)m_lateBuffers, (int)m_tightBuffers,
+	                                m_bufferUs>0? (double)total.totalUs*100.0/(double)m_bufferUs : 0.0);
+
+	for( int stage = 0; stage < SJ_DSP_STAGE_COUNT; stage++ )
+	{
+		const Stage& s = m_stages[stage];
+		if( s.calls <= 0 ) {
+			continue;
+		}
+
+		ret += wxString::Format(wxT("\n%s: %i calls, avg %i us, p50 %i us, p99 %i us, max %i us, histogram"),
+		                        GetStageName(stage), (int)s.calls, (int)(s.totalUs/s.calls),
+		                        (int)GetPercentileUs(s, 50), (int)GetPercentileUs(s, 99), (int)s.maxUs);
+
+		for( int bucket = 0; bucket < SJ_DSP_HISTO_BUCKETS; bucket++ )
+		{
+			if( s.histo[bucket] > 0 )
+			{
+				if( bucket < SJ_DSP_HISTO_BUCKETS-1 ) {
+					ret += wxString::Format(wxT(" <%i:%i"), 1<<bucket, (int)s.histo[bucket]);
+				}
+				else {
+					ret += wxString::Format(wxT(" >=%i:%i"), 1<<(bucket-1), (int)s.histo[bucket]);
+				}
+			}
+		}
+	}
+
+	return ret;
+}
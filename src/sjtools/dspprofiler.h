@@ -0,0 +1,104 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2016 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    dspprofiler.h
+ * Authors: Björn Petersen
+ * Purpose: Measuring the stages of the audio callback
+ *
+ ******************************************************************************/
+
+
+#ifndef __SJ_DSPPROFILER_H__
+#define __SJ_DSPPROFILER_H__
+
+
+#include <atomic>
+
+
+// the stages of SjPlayer_BackendCallback(), in the order of processing
+enum SjDspStage
+{
+	SJ_DSP_VOLCALC = 0,
+	SJ_DSP_AUTOVOL,
+	SJ_DSP_EQUALIZER,
+	SJ_DSP_VIS,
+	SJ_DSP_FADE,
+	SJ_DSP_MIXDOWN,
+	SJ_DSP_TOTAL,       // the whole callback
+	SJ_DSP_STAGE_COUNT
+};
+
+
+// histogram bucket n counts the calls that took less than 2^n microseconds,
+// the last bucket counts everything above
+#define SJ_DSP_HISTO_BUCKETS 16
+
+
+// SjDspProfiler collects the time spent in the stages of the audio callback;
+// the callback may run in several threads at the same time (one per stream),
+// so all counters are updated atomically and nobody takes a lock.
+//
+// A buffer is "late" if processing took longer than the buffer plays; if this
+// happens often, the output will underrun.  It is "tight" if processing took
+// more than half of this time.
+class SjDspProfiler
+{
+public:
+	// Constructor
+	                SjDspProfiler       ();
+
+	// Enabling resets the statistics, disabling logs them.  Call from the
+	// main thread only.
+	void            Enable              (bool);
+	bool            IsEnabled           () const { return m_enabled.load(std::memory_order_relaxed); }
+	void            Reset               ();
+
+	// Measuring, called by the audio thread(s) if IsEnabled(); GetUsTicks()
+	// uses a monotonic clock
+	static int64_t  GetUsTicks          ();
+	void            AddStage            (int stage, int64_t us);
+	void            AddBuffer           (int64_t totalUs, int64_t bufferUs); // adds SJ_DSP_TOTAL and checks the deadline
+
+	// Get the statistics as human readable text, one line per stage
+	wxString        GetStats            () const;
+
+private:
+	// private stuff
+	struct Stage
+	{
+		std::atomic<int64_t> calls;
+		std::atomic<int64_t> totalUs;
+		std::atomic<int64_t> maxUs;
+		std::atomic<int64_t> histo[SJ_DSP_HISTO_BUCKETS];
+	};
+	std::atomic<bool> m_enabled;
+	Stage           m_stages[SJ_DSP_STAGE_COUNT];
+	std::atomic<int64_t> m_lateBuffers;
+	std::atomic<int64_t> m_tightBuffers;
+	std::atomic<int64_t> m_bufferUs; // the sum of the played time of all buffers
+	unsigned long   m_startTimestamp;
+
+	static const wxChar* GetStageName(int stage);
+	static int64_t  GetPercentileUs     (const Stage&, int percent);
+};
+
+
+#endif // __SJ_DSPPROFILER_H__
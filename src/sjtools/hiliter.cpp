@@ -0,0 +1,250 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2015 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    hiliter.cpp
+ * Authors: Björn Petersen
+ * Purpose: Find and mark search words in strings
+ *
+ ******************************************************************************/
+
+
+#include <sjbase/base.h>
+#include <sjtools/hiliter.h>
+
+
+SjHiliter::SjHiliter()
+{
+	m_nodes         = NULL;
+	m_nodeCount     = 0;
+	m_nodeAlloc     = 0;
+	m_longest       = NULL;
+	m_longestAlloc  = 0;
+}
+
+
+SjHiliter::~SjHiliter()
+{
+	if( m_nodes )   { free(m_nodes); }
+	if( m_longest ) { free(m_longest); }
+}
+
+
+void SjHiliter::Clear()
+{
+	m_nodeCount = 0;
+}
+
+
+long SjHiliter::AddNode(wxChar c)
+{
+	if( m_nodeCount >= m_nodeAlloc )
+	{
+		long newAlloc = m_nodeAlloc? m_nodeAlloc*2 : 64;
+		SjHiliterNode* newNodes = (SjHiliterNode*)realloc(m_nodes, newAlloc*sizeof(SjHiliterNode));
+		if( newNodes == NULL )
+		{
+			return -1; // error
+		}
+		m_nodes = newNodes;
+		m_nodeAlloc = newAlloc;
+	}
+
+	SjHiliterNode* node = &m_nodes[m_nodeCount];
+	node->m_char        = c;
+	node->m_firstChild  = 0;
+	node->m_nextSibling = 0;
+	node->m_fail        = 0;
+	node->m_out         = 0;
+	node->m_wordLen     = 0;
+	return m_nodeCount++;
+}
+
+
+long SjHiliter::GetChild(long node, wxChar c) const
+{
+	long child = m_nodes[node].m_firstChild;
+	while( child )
+	{
+		if( m_nodes[child].m_char == c )
+		{
+			return child;
+		}
+		child = m_nodes[child].m_nextSibling;
+	}
+	return 0;
+}
+
+
+void SjHiliter::Init(const wxString& spaceSeparatedWords)
+{
+	Clear();
+	if( AddNode(0) != 0 )
+	{
+		return; // error, IsOk() returns false
+	}
+
+	// build the trie of all words
+	const wxChar* p = spaceSeparatedWords.c_str();
+	while( *p )
+	{
+		while( *p == ' ' ) { p++; }
+
+		long node = 0, wordLen = 0;
+		while( *p && *p != ' ' )
+		{
+			wxChar c = Fold(*p++);
+			long child = GetChild(node, c);
+			if( child == 0 )
+			{
+				if( (child=AddNode(c)) == -1 )
+				{
+					Clear();
+					return; // error
+				}
+				m_nodes[child].m_nextSibling = m_nodes[node].m_firstChild;
+				m_nodes[node].m_firstChild = child;
+			}
+			node = child;
+			wordLen++;
+		}
+
+		if( wordLen )
+		{
+			m_nodes[node].m_wordLen = wordLen;
+		}
+	}
+
+	// set the failure links breadth-first, so the links of all shorter
+	// prefixes are known when a node is reached
+	long* queue = (long*)malloc(m_nodeCount*sizeof(long));
+	if( queue == NULL )
+	{
+		Clear();
+		return; // error
+	}
+
+	long queueHead = 0, queueTail = 0, child;
+	for( child = m_nodes[0].m_firstChild; child; child = m_nodes[child].m_nextSibling )
+	{
+		queue[queueTail++] = child; // the failure link of the first level is the root
+	}
+
+	while( queueHead < queueTail )
+	{
+		long node = queue[queueHead++];
+		for( child = m_nodes[node].m_firstChild; child; child = m_nodes[child].m_nextSibling )
+		{
+			wxChar c = m_nodes[child].m_char;
+			long fail = m_nodes[node].m_fail;
+			while( fail && GetChild(fail, c) == 0 )
+			{
+				fail = m_nodes[fail].m_fail;
+			}
+			fail = GetChild(fail, c);
+
+			m_nodes[child].m_fail = fail;
+			m_nodes[child].m_out  = m_nodes[fail].m_wordLen? fail : m_nodes[fail].m_out;
+
+			queue[queueTail++] = child;
+		}
+	}
+
+	free(queue);
+}
+
+
+long SjHiliter::Hilite(wxString& str, wxChar mark)
+{
+	if( !IsOk() )
+	{
+		return 0;
+	}
+
+	const wxChar* p = str.c_str();
+	long len = (long)str.Len(), i;
+
+	if( len > m_longestAlloc )
+	{
+		long* newLongest = (long*)realloc(m_longest, len*sizeof(long));
+		if( newLongest == NULL )
+		{
+			return 0; // error
+		}
+		m_longest = newLongest;
+		m_longestAlloc = len;
+	}
+	memset(m_longest, 0, len*sizeof(long));
+
+	// find all words; as folding is done character by character, the
+	// positions in the folded text are the positions in the original string
+	long node = 0, out, wordCount = 0;
+	for( i = 0; i < len; i++ )
+	{
+		wxChar c = Fold(p[i]);
+		while( node && GetChild(node, c) == 0 )
+		{
+			node = m_nodes[node].m_fail;
+		}
+		node = GetChild(node, c);
+
+		for( out = m_nodes[node].m_wordLen? node : m_nodes[node].m_out; out; out = m_nodes[out].m_out )
+		{
+			long wordLen = m_nodes[out].m_wordLen;
+			if( wordLen > m_longest[i-wordLen+1] )
+			{
+				m_longest[i-wordLen+1] = wordLen;
+				wordCount++;
+			}
+		}
+	}
+
+	if( wordCount == 0 )
+	{
+		return 0; // nothing found, leave the string unchanged
+	}
+
+	// mark the words, skip words overlapping with a word already marked
+	wxString ret;
+	ret.Alloc(len + wordCount*2);
+	long start = 0, marked = 0;
+	for( i = 0; i < len; )
+	{
+		if( m_longest[i] )
+		{
+			ret.Append(p+start, i-start);
+			ret.Append(mark);
+			ret.Append(p+i, m_longest[i]);
+			ret.Append(mark);
+			marked++;
+
+			i += m_longest[i];
+			start = i;
+		}
+		else
+		{
+			i++;
+		}
+	}
+	ret.Append(p+start, len-start);
+
+	str = ret;
+	return marked;
+}
@@ -0,0 +1,76 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2015 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    hiliter.h
+ * Authors: Björn Petersen
+ * Purpose: Find and mark search words in strings
+ *
+ ******************************************************************************/
+
+
+
+#ifndef __SJ_HILITER_H__
+#define __SJ_HILITER_H__
+
+
+
+class SjHiliter
+{
+public:
+	// SjHiliter finds any number of words in one pass over a string (this is
+	// an Aho-Corasick automaton); it is built once for a search and used for
+	// each string shown.  Words are found case-insensitive, overlapping words
+	// are marked as one, preferring the leftmost and then the longest word.
+	                SjHiliter           ();
+	                ~SjHiliter          ();
+	void            Init                (const wxString& spaceSeparatedWords);
+	void            Clear               ();
+	bool            IsOk                () const { return m_nodeCount > 1; }
+
+	// encloses all words found in the given string in the given mark
+	// character and returns the number of words found
+	long            Hilite              (wxString&, wxChar mark);
+
+private:
+	struct SjHiliterNode
+	{
+		wxChar      m_char;             // the character leading to this node
+		long        m_firstChild;       // 0 = none
+		long        m_nextSibling;      // 0 = none
+		long        m_fail;             // longest proper suffix that is also in the trie
+		long        m_out;              // next node on the suffix chain that ends a word, 0 = none
+		long        m_wordLen;          // length of the word ending here, 0 = no word ends here
+	};
+
+	SjHiliterNode*  m_nodes;            // m_nodes[0] is the root
+	long            m_nodeCount;
+	long            m_nodeAlloc;
+	long            AddNode             (wxChar);
+	long            GetChild            (long node, wxChar) const;
+	static wxChar   Fold                (wxChar c) { return (wxChar)wxTolower(c); }
+
+	long*           m_longest;          // temp. buffer for Hilite(): length of the longest word starting at a position
+	long            m_longestAlloc;
+};
+
+
+
+#endif // __SJ_HILITER_H__
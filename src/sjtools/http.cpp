@@ -167,6 +167,8 @@ void SjHttp::OpenFile(const wxString& urlStr, wxMBConv* mbConv, const SjSSHash*
 wxString SjHttp::ReadFile_(const wxString& urlStr, wxMBConv* mbConv, const SjSSHash* requestHeader, const wxString& postData,
                            int& retHttpStatusCode, SjSSHash** retResponseHeader)
 {
+	SJ_STALL_SCOPE("SjHttp::ReadFile_");
+
 	wxURL url(urlStr);
 
 	// get protocol pointer
@@ -0,0 +1,710 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2015 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    idset.cpp
+ * Authors: Björn Petersen
+ * Purpose: Compressed sets of track IDs
+ *
+ ******************************************************************************/
+
+
+
+#include <sjbase/base.h>
+#include <sjtools/idset.h>
+
+
+#define SJ_IDSET_ARRAY_MAX  4096    // chunks with more IDs are stored as bitmaps
+#define SJ_IDSET_ARRAY_MIN  2048    // bitmaps with fewer IDs go back to arrays; the gap avoids converting back and forth
+#define SJ_IDSET_WORDS      2048    // 65536 bits per bitmap
+
+
+static inline long SjIdSetPopcount(uint32_t v)
+{
+	#ifdef __GNUC__
+		return __builtin_popcount(v);
+	#else
+		v = v - ((v >> 1) & 0x55555555);
+		v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+		return (long)((((v + (v >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24);
+	#endif
+}
+
+
+/*******************************************************************************
+ * SjIdSetChunk
+ ******************************************************************************/
+
+
+struct SjIdSetChunk
+{
+	uint16_t        m_key;      // upper 16 bits of the IDs
+	long            m_count;    // number of IDs in the chunk
+	long            m_alloc;    // allocated entries in m_array
+	uint16_t*       m_array;    // sorted lower 16 bits, used if m_bitmap is NULL
+	uint32_t*       m_bitmap;   // SJ_IDSET_WORDS words or NULL
+
+	SjIdSetChunk(uint16_t key)
+	{
+		m_key = key; m_count = 0; m_alloc = 0; m_array = NULL; m_bitmap = NULL;
+	}
+
+	~SjIdSetChunk()
+	{
+		if( m_array ) { free(m_array); }
+		if( m_bitmap ) { free(m_bitmap); }
+	}
+
+	SjIdSetChunk* Clone() const
+	{
+		SjIdSetChunk* c = new SjIdSetChunk(m_key);
+		c->m_count = m_count;
+		if( m_bitmap )
+		{
+			c->m_bitmap = (uint32_t*)malloc(SJ_IDSET_WORDS*sizeof(uint32_t));
+			memcpy(c->m_bitmap, m_bitmap, SJ_IDSET_WORDS*sizeof(uint32_t));
+		}
+		else if( m_count )
+		{
+			c->m_alloc = m_count;
+			c->m_array = (uint16_t*)malloc(m_count*sizeof(uint16_t));
+			memcpy(c->m_array, m_array, m_count*sizeof(uint16_t));
+		}
+		return c;
+	}
+
+	// index of the first array entry >= low
+	long LowerBound(uint16_t low) const
+	{
+		long l = 0, r = m_count;
+		while( l < r )
+		{
+			long m = (l+r)/2;
+			if( m_array[m] < low ) { l = m+1; } else { r = m; }
+		}
+		return l;
+	}
+
+	bool Contains(uint16_t low) const
+	{
+		if( m_bitmap )
+		{
+			return (m_bitmap[low>>5] & (1UL<<(low&31))) != 0;
+		}
+		long pos = LowerBound(low);
+		return (pos < m_count && m_array[pos] == low);
+	}
+
+	bool ToBitmap()
+	{
+		uint32_t* bitmap = (uint32_t*)calloc(SJ_IDSET_WORDS, sizeof(uint32_t));
+		if( bitmap == NULL ) { return FALSE; }
+		for( long i = 0; i < m_count; i++ )
+		{
+			bitmap[m_array[i]>>5] |= 1UL<<(m_array[i]&31);
+		}
+		if( m_array ) { free(m_array); m_array = NULL; }
+		m_alloc = 0;
+		m_bitmap = bitmap;
+		return TRUE;
+	}
+
+	void ToArray()
+	{
+		uint16_t* array = NULL;
+		if( m_count )
+		{
+			array = (uint16_t*)malloc(m_count*sizeof(uint16_t));
+			if( array == NULL ) { return; } // stay a bitmap
+			long n = 0;
+			for( long w = 0; w < SJ_IDSET_WORDS; w++ )
+			{
+				uint32_t bits = m_bitmap[w];
+				while( bits )
+				{
+					int b = 0; while( !(bits & (1UL<<b)) ) { b++; }
+					array[n++] = (uint16_t)((w<<5) + b);
+					bits &= bits-1;
+				}
+			}
+		}
+		free(m_bitmap);
+		m_bitmap = NULL;
+		m_array = array;
+		m_alloc = m_count;
+	}
+
+	// call after the bitmap was modified directly
+	void Recount()
+	{
+		if( m_bitmap )
+		{
+			m_count = 0;
+			for( long w = 0; w < SJ_IDSET_WORDS; w++ )
+			{
+				m_count += SjIdSetPopcount(m_bitmap[w]);
+			}
+			if( m_count < SJ_IDSET_ARRAY_MIN )
+			{
+				ToArray();
+			}
+		}
+	}
+
+	bool Add(uint16_t low)
+	{
+		if( m_bitmap )
+		{
+			uint32_t mask = 1UL<<(low&31);
+			if( m_bitmap[low>>5] & mask ) { return FALSE; }
+			m_bitmap[low>>5] |= mask;
+			m_count++;
+			return TRUE;
+		}
+
+		// IDs are often added in ascending order, check the end first
+		long pos = (m_count && m_array[m_count-1] < low)? m_count : LowerBound(low);
+		if( pos < m_count && m_array[pos] == low ) { return FALSE; }
+
+		if( m_count >= SJ_IDSET_ARRAY_MAX )
+		{
+			if( !ToBitmap() ) { return FALSE; }
+			return Add(low);
+		}
+
+		if( m_count >= m_alloc )
+		{
+			long newAlloc = m_alloc? m_alloc*2 : 4;
+			if( newAlloc > SJ_IDSET_ARRAY_MAX ) { newAlloc = SJ_IDSET_ARRAY_MAX; }
+			uint16_t* newArray = (uint16_t*)realloc(m_array, newAlloc*sizeof(uint16_t));
+			if( newArray == NULL ) { return FALSE; }
+			m_array = newArray;
+			m_alloc = newAlloc;
+		}
+
+		memmove(&m_array[pos+1], &m_array[pos], (m_count-pos)*sizeof(uint16_t));
+		m_array[pos] = low;
+		m_count++;
+		return TRUE;
+	}
+
+	bool Del(uint16_t low)
+	{
+		if( m_bitmap )
+		{
+			uint32_t mask = 1UL<<(low&31);
+			if( !(m_bitmap[low>>5] & mask) ) { return FALSE; }
+			m_bitmap[low>>5] &= ~mask;
+			m_count--;
+			if( m_count < SJ_IDSET_ARRAY_MIN ) { ToArray(); }
+			return TRUE;
+		}
+
+		long pos = LowerBound(low);
+		if( pos >= m_count || m_array[pos] != low ) { return FALSE; }
+		memmove(&m_array[pos], &m_array[pos+1], (m_count-pos-1)*sizeof(uint16_t));
+		m_count--;
+		return TRUE;
+	}
+
+	// find the first value >= low; low may be 65536 (nothing found then)
+	bool NextFrom(long low, uint16_t* ret) const
+	{
+		if( low > 0xFFFF ) { return FALSE; }
+		if( m_bitmap )
+		{
+			long w = low>>5;
+			uint32_t bits = m_bitmap[w] & (0xFFFFFFFFUL<<(low&31));
+			while( 1 )
+			{
+				if( bits )
+				{
+					int b = 0; while( !(bits & (1UL<<b)) ) { b++; }
+					*ret = (uint16_t)((w<<5) + b);
+					return TRUE;
+				}
+				if( ++w >= SJ_IDSET_WORDS ) { return FALSE; }
+				bits = m_bitmap[w];
+			}
+		}
+		long pos = LowerBound((uint16_t)low);
+		if( pos >= m_count ) { return FALSE; }
+		*ret = m_array[pos];
+		return TRUE;
+	}
+
+	// number of values < low
+	long CountBelow(uint16_t low) const
+	{
+		if( m_bitmap )
+		{
+			long n = 0, w;
+			for( w = 0; w < (low>>5); w++ )
+			{
+				n += SjIdSetPopcount(m_bitmap[w]);
+			}
+			if( low&31 )
+			{
+				n += SjIdSetPopcount(m_bitmap[w] & (0xFFFFFFFFUL>>(32-(low&31))));
+			}
+			return n;
+		}
+		return LowerBound(low);
+	}
+
+	// the value at the given position, 0..m_count-1
+	uint16_t At(long pos) const
+	{
+		if( m_bitmap )
+		{
+			long w = 0, n;
+			while( pos >= (n=SjIdSetPopcount(m_bitmap[w])) )
+			{
+				pos -= n;
+				w++;
+			}
+			uint32_t bits = m_bitmap[w];
+			while( pos-- ) { bits &= bits-1; }
+			int b = 0; while( !(bits & (1UL<<b)) ) { b++; }
+			return (uint16_t)((w<<5) + b);
+		}
+		return m_array[pos];
+	}
+};
+
+
+/*******************************************************************************
+ * SjIdSet
+ ******************************************************************************/
+
+
+SjIdSet::SjIdSet()
+{
+	m_chunks        = NULL;
+	m_chunkCount    = 0;
+	m_chunkAlloc    = 0;
+	m_count         = 0;
+}
+
+
+SjIdSet::SjIdSet(const SjIdSet& o)
+{
+	m_chunks        = NULL;
+	m_chunkCount    = 0;
+	m_chunkAlloc    = 0;
+	m_count         = 0;
+	CopyFrom(o);
+}
+
+
+void SjIdSet::Clear()
+{
+	for( long c = 0; c < m_chunkCount; c++ )
+	{
+		delete m_chunks[c];
+	}
+
+	if( m_chunks )
+	{
+		free(m_chunks);
+		m_chunks = NULL;
+	}
+
+	m_chunkCount = 0;
+	m_chunkAlloc = 0;
+	m_count = 0;
+}
+
+
+void SjIdSet::CopyFrom(const SjIdSet& o)
+{
+	Clear();
+	for( long c = 0; c < o.m_chunkCount; c++ )
+	{
+		InsertChunk(c, o.m_chunks[c]->Clone());
+	}
+	m_count = o.m_count;
+}
+
+
+long SjIdSet::FindChunk(uint16_t key, long* insertPos) const
+{
+	// check the last chunk first as IDs are often added in ascending order
+	long l = 0, r = m_chunkCount;
+	if( m_chunkCount && m_chunks[m_chunkCount-1]->m_key <= key )
+	{
+		l = m_chunkCount-1;
+	}
+
+	while( l < r )
+	{
+		long m = (l+r)/2;
+		if( m_chunks[m]->m_key < key ) { l = m+1; } else { r = m; }
+	}
+
+	if( insertPos ) { *insertPos = l; }
+	return (l < m_chunkCount && m_chunks[l]->m_key == key)? l : -1;
+}
+
+
+void SjIdSet::InsertChunk(long pos, SjIdSetChunk* chunk)
+{
+	if( m_chunkCount >= m_chunkAlloc )
+	{
+		m_chunkAlloc = m_chunkAlloc? m_chunkAlloc*2 : 8;
+		m_chunks = (SjIdSetChunk**)realloc(m_chunks, m_chunkAlloc*sizeof(SjIdSetChunk*));
+	}
+
+	memmove(&m_chunks[pos+1], &m_chunks[pos], (m_chunkCount-pos)*sizeof(SjIdSetChunk*));
+	m_chunks[pos] = chunk;
+	m_chunkCount++;
+}
+
+
+void SjIdSet::RemoveEmptyChunks()
+{
+	long src, dest = 0;
+	m_count = 0;
+	for( src = 0; src < m_chunkCount; src++ )
+	{
+		if( m_chunks[src]->m_count )
+		{
+			m_count += m_chunks[src]->m_count;
+			m_chunks[dest++] = m_chunks[src];
+		}
+		else
+		{
+			delete m_chunks[src];
+		}
+	}
+	m_chunkCount = dest;
+}
+
+
+bool SjIdSet::Insert(long id)
+{
+	wxASSERT( id >= 0 );
+
+	long pos, c = FindChunk((uint16_t)(((uint32_t)id)>>16), &pos);
+	if( c == -1 )
+	{
+		InsertChunk(pos, new SjIdSetChunk((uint16_t)(((uint32_t)id)>>16)));
+		c = pos;
+	}
+
+	if( !m_chunks[c]->Add((uint16_t)(id&0xFFFF)) )
+	{
+		return FALSE;
+	}
+
+	m_count++;
+	return TRUE;
+}
+
+
+bool SjIdSet::Remove(long id)
+{
+	long c = FindChunk((uint16_t)(((uint32_t)id)>>16), NULL);
+	if( c == -1 || !m_chunks[c]->Del((uint16_t)(id&0xFFFF)) )
+	{
+		return FALSE;
+	}
+
+	m_count--;
+	if( m_chunks[c]->m_count == 0 )
+	{
+		delete m_chunks[c];
+		memmove(&m_chunks[c], &m_chunks[c+1], (m_chunkCount-c-1)*sizeof(SjIdSetChunk*));
+		m_chunkCount--;
+	}
+	return TRUE;
+}
+
+
+bool SjIdSet::Lookup(long id) const
+{
+	long c = FindChunk((uint16_t)(((uint32_t)id)>>16), NULL);
+	return (c != -1 && m_chunks[c]->Contains((uint16_t)(id&0xFFFF)));
+}
+
+
+bool SjIdSet::Next(uint32_t from, uint32_t* ret) const
+{
+	long pos;
+	FindChunk((uint16_t)(from>>16), &pos);
+	for( ; pos < m_chunkCount; pos++ )
+	{
+		const SjIdSetChunk* chunk = m_chunks[pos];
+		uint16_t low;
+		if( chunk->NextFrom(chunk->m_key==(from>>16)? (long)(from&0xFFFF) : 0, &low) )
+		{
+			*ret = (((uint32_t)chunk->m_key)<<16) | low;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+
+bool SjIdSet::Iterate(SjIdSetIterator& i, long* id) const
+{
+	wxASSERT( id );
+
+	uint32_t from = 0;
+	if( i.m_started )
+	{
+		if( i.m_last == 0xFFFFFFFFUL ) { return FALSE; }
+		from = i.m_last + 1;
+	}
+
+	// we search the successor of the last ID instead of remembering a
+	// position; this way, the set may be modified while iterating
+	if( !Next(from, &i.m_last) )
+	{
+		return FALSE;
+	}
+
+	i.m_started = TRUE;
+	*id = (long)i.m_last;
+	return TRUE;
+}
+
+
+void SjIdSet::And(const SjIdSet& o)
+{
+	for( long c = 0; c < m_chunkCount; c++ )
+	{
+		SjIdSetChunk* chunk = m_chunks[c];
+		long oc = o.FindChunk(chunk->m_key, NULL);
+		if( oc == -1 )
+		{
+			chunk->m_count = 0; // removed below
+			continue;
+		}
+
+		const SjIdSetChunk* other = o.m_chunks[oc];
+		if( chunk->m_bitmap && other->m_bitmap )
+		{
+			for( long w = 0; w < SJ_IDSET_WORDS; w++ )
+			{
+				chunk->m_bitmap[w] &= other->m_bitmap[w];
+			}
+			chunk->Recount();
+		}
+		else if( chunk->m_bitmap )
+		{
+			// the result is a subset of the other array
+			SjIdSetChunk* result = new SjIdSetChunk(chunk->m_key);
+			for( long i = 0; i < other->m_count; i++ )
+			{
+				if( chunk->Contains(other->m_array[i]) )
+				{
+					result->Add(other->m_array[i]);
+				}
+			}
+			delete chunk;
+			m_chunks[c] = result;
+		}
+		else
+		{
+			long n = 0;
+			for( long i = 0; i < chunk->m_count; i++ )
+			{
+				if( other->Contains(chunk->m_array[i]) )
+				{
+					chunk->m_array[n++] = chunk->m_array[i];
+				}
+			}
+			chunk->m_count = n;
+		}
+	}
+
+	RemoveEmptyChunks();
+}
+
+
+void SjIdSet::AndNot(const SjIdSet& o)
+{
+	for( long c = 0; c < m_chunkCount; c++ )
+	{
+		SjIdSetChunk* chunk = m_chunks[c];
+		long oc = o.FindChunk(chunk->m_key, NULL);
+		if( oc == -1 )
+		{
+			continue;
+		}
+
+		const SjIdSetChunk* other = o.m_chunks[oc];
+		if( chunk->m_bitmap )
+		{
+			if( other->m_bitmap )
+			{
+				for( long w = 0; w < SJ_IDSET_WORDS; w++ )
+				{
+					chunk->m_bitmap[w] &= ~other->m_bitmap[w];
+				}
+			}
+			else
+			{
+				for( long i = 0; i < other->m_count; i++ )
+				{
+					chunk->m_bitmap[other->m_array[i]>>5] &= ~(1UL<<(other->m_array[i]&31));
+				}
+			}
+			chunk->Recount();
+		}
+		else
+		{
+			long n = 0;
+			for( long i = 0; i < chunk->m_count; i++ )
+			{
+				if( !other->Contains(chunk->m_array[i]) )
+				{
+					chunk->m_array[n++] = chunk->m_array[i];
+				}
+			}
+			chunk->m_count = n;
+		}
+	}
+
+	RemoveEmptyChunks();
+}
+
+
+void SjIdSet::Or(const SjIdSet& o)
+{
+	for( long oc = 0; oc < o.m_chunkCount; oc++ )
+	{
+		const SjIdSetChunk* other = o.m_chunks[oc];
+		long pos, c = FindChunk(other->m_key, &pos);
+		if( c == -1 )
+		{
+			InsertChunk(pos, other->Clone());
+			continue;
+		}
+
+		SjIdSetChunk* chunk = m_chunks[c];
+		if( chunk->m_bitmap == NULL
+		 && (other->m_bitmap || chunk->m_count+other->m_count > SJ_IDSET_ARRAY_MAX) )
+		{
+			chunk->ToBitmap();
+		}
+
+		if( chunk->m_bitmap )
+		{
+			if( other->m_bitmap )
+			{
+				for( long w = 0; w < SJ_IDSET_WORDS; w++ )
+				{
+					chunk->m_bitmap[w] |= other->m_bitmap[w];
+				}
+			}
+			else
+			{
+				for( long i = 0; i < other->m_count; i++ )
+				{
+					chunk->m_bitmap[other->m_array[i]>>5] |= 1UL<<(other->m_array[i]&31);
+				}
+			}
+			chunk->Recount();
+		}
+		else
+		{
+			// merge two sorted arrays
+			uint16_t* merged = (uint16_t*)malloc((chunk->m_count+other->m_count)*sizeof(uint16_t));
+			long i = 0, j = 0, n = 0;
+			while( i < chunk->m_count && j < other->m_count )
+			{
+				if( chunk->m_array[i] < other->m_array[j] )      { merged[n++] = chunk->m_array[i++]; }
+				else if( chunk->m_array[i] > other->m_array[j] ) { merged[n++] = other->m_array[j++]; }
+				else                                             { merged[n++] = chunk->m_array[i++]; j++; }
+			}
+			while( i < chunk->m_count ) { merged[n++] = chunk->m_array[i++]; }
+			while( j < other->m_count ) { merged[n++] = other->m_array[j++]; }
+
+			free(chunk->m_array);
+			chunk->m_array = merged;
+			chunk->m_alloc = chunk->m_count+other->m_count;
+			chunk->m_count = n;
+		}
+	}
+
+	RemoveEmptyChunks(); // recalculates m_count
+}
+
+
+long SjIdSet::Rank(long id) const
+{
+	uint16_t key = (uint16_t)(((uint32_t)id)>>16);
+	long ret = 0;
+	for( long c = 0; c < m_chunkCount; c++ )
+	{
+		if( m_chunks[c]->m_key < key )
+		{
+			ret += m_chunks[c]->m_count;
+		}
+		else
+		{
+			if( m_chunks[c]->m_key == key )
+			{
+				ret += m_chunks[c]->CountBelow((uint16_t)(id&0xFFFF));
+			}
+			break;
+		}
+	}
+	return ret;
+}
+
+
+bool SjIdSet::Select(long pos, long* id) const
+{
+	wxASSERT( id );
+
+	if( pos < 0 || pos >= m_count )
+	{
+		return FALSE;
+	}
+
+	for( long c = 0; c < m_chunkCount; c++ )
+	{
+		if( pos < m_chunks[c]->m_count )
+		{
+			*id = (long)((((uint32_t)m_chunks[c]->m_key)<<16) | m_chunks[c]->At(pos));
+			return TRUE;
+		}
+		pos -= m_chunks[c]->m_count;
+	}
+
+	return FALSE;
+}
+
+
+wxString SjIdSet::GetKeysAsString() const
+{
+	wxString ret;
+	long     id;
+	SjIdSetIterator iterator;
+	while( Iterate(iterator, &id) )
+	{
+		ret.Append(wxString::Format(wxT("%i,"), (int)id));
+	}
+	ret.Truncate(ret.Len()? ret.Len()-1 : 0);
+	return ret;
+}
@@ -0,0 +1,110 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2015 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    idset.h
+ * Authors: Björn Petersen
+ * Purpose: Compressed sets of track IDs
+ *
+ ******************************************************************************/
+
+
+
+#ifndef __SJ_IDSET_H__
+#define __SJ_IDSET_H__
+
+
+
+class SjIdSetIterator
+{
+public:
+	                SjIdSetIterator     () { Rewind(); }
+	void            Rewind              () { m_started = FALSE; m_last = 0; }
+
+private:
+	bool            m_started;
+	uint32_t        m_last;
+	friend class    SjIdSet;
+};
+
+
+
+struct SjIdSetChunk;
+
+
+
+class SjIdSet
+{
+public:
+	// A set of IDs in the range 0..0xFFFFFFFF, organized as "roaring bitmap":
+	// the IDs are grouped by their upper 16 bits into chunks; a chunk is a
+	// sorted array of the lower 16 bits or, if there are more than 4096 IDs
+	// in the chunk, a bitmap of 65536 bits.  A bitmap is converted back to an
+	// array only if less than 2048 IDs are left.
+	                SjIdSet             ();
+	                SjIdSet             (const SjIdSet& o);
+	                ~SjIdSet            () { Clear(); }
+	SjIdSet&        operator =          (const SjIdSet& o) { if( &o != this ) { CopyFrom(o); } return *this; }
+
+	// Insert()/Remove() return TRUE if the set was modified
+	bool            Insert              (long id);
+	bool            Remove              (long id);
+	bool            InsertOrRemove      (long id, bool insert) { return insert? Insert(id) : Remove(id); }
+
+	// TRUE if the ID is in the set
+	bool            Lookup              (long id) const;
+
+	// number of IDs in the set
+	long            GetCount            () const { return m_count; }
+
+	// remove all IDs
+	void            Clear               ();
+
+	// Iterate the IDs in ascending order, if there are no more IDs, FALSE is
+	// returned. The set may be modified while iterating.
+	bool            Iterate             (SjIdSetIterator& i, long* id) const;
+
+	// set operations, the result is stored in this set
+	void            And                 (const SjIdSet& o);
+	void            Or                  (const SjIdSet& o);
+	void            AndNot              (const SjIdSet& o);
+
+	// Rank() returns the number of IDs smaller than the given one, Select()
+	// returns the ID at the given position, 0..GetCount()-1
+	long            Rank                (long id) const;
+	bool            Select              (long pos, long* id) const;
+
+	// get all IDs as a string in the format "2,12,23" etc.
+	wxString        GetKeysAsString     () const;
+
+private:
+	SjIdSetChunk**  m_chunks; // sorted by SjIdSetChunk::m_key
+	long            m_chunkCount;
+	long            m_chunkAlloc;
+	long            m_count;
+	long            FindChunk           (uint16_t key, long* insertPos) const;
+	void            InsertChunk         (long pos, SjIdSetChunk*);
+	void            RemoveEmptyChunks   ();
+	bool            Next                (uint32_t from, uint32_t* ret) const;
+	void            CopyFrom            (const SjIdSet& o);
+};
+
+
+#endif // __SJ_IDSET_H__
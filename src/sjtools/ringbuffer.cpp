@@ -21,7 +21,7 @@
  *
  * File:    ringbuffer.cpp
  * Authors: Björn Petersen
- * Purpose: A simple ringbuffer
+ * Purpose: A lock-free ringbuffer with one writer and any number of readers
  *
  ******************************************************************************/
 
@@ -32,11 +32,11 @@
 
 SjRingbuffer::SjRingbuffer()
 {
-	m_buffer				= NULL; //Free() checks this pointer
-	m_totalBytes			= 0;
-	m_waitingForResizeBytes = 0;
-
-	Empty();
+	m_buffer        = NULL; //Free() checks this pointer
+	m_totalSamples  = 0;
+	m_mask          = 0;
+	m_writePos      = 0;
+	m_writeEnd      = 0;
 }
 
 
@@ -46,238 +46,147 @@ SjRingbuffer::~SjRingbuffer()
 }
 
 
-bool SjRingbuffer::Alloc(long totalBytes)
+bool SjRingbuffer::Alloc(long totalSamples)
 {
-	m_waitingForResizeBytes = 0;
+	long newTotal = 1;
+	while( newTotal < totalSamples ) {
+		newTotal <<= 1;
+	}
 
-    if( m_totalBytes == totalBytes )
-    {
-        Empty();
-    }
-    else
-    {
-        Free();
+	if( newTotal != m_totalSamples )
+	{
+		Free();
 
-		if( totalBytes > 0 )
+		m_buffer = (float*)malloc(newTotal*sizeof(float));
+		if( m_buffer == NULL )
 		{
-			m_buffer = (unsigned char*)malloc(totalBytes);
-			if( m_buffer == NULL )
-			{
-				return FALSE;
-			}
+			return false;
 		}
 
-        m_totalBytes = totalBytes;
-    }
-
-    return TRUE;
-
-}
-
-
-bool SjRingbuffer::Resize(long totalBytes)
-{
-	m_waitingForResizeBytes = 0;
-
-	if( m_buffer == NULL || totalBytes <= 0 )
-	{
-		// this function may not be used to allocate buffers, use Alloc() instead
-		// or check if the buffer is allocted using IsAllocated()
-		wxASSERT( m_buffer && m_totalBytes > 0 );
-		return FALSE;
+		m_totalSamples = newTotal;
+		m_mask = newTotal-1;
 	}
-	else if( m_totalBytes == totalBytes )
-	{
-		// same size - nothing to do
-		return TRUE;
-	}
-	else if( m_totalBytes > totalBytes )
-	{
-		// shrink buffer
-		if( m_validBytes <= totalBytes )
-		{
-			return ResizeDo(totalBytes);
-		}
-		else
-		{
-			m_waitingForResizeBytes = totalBytes;
-			return TRUE;
-		}
-	}
-	else
-	{
-		// enlarge buffer
-		return ResizeDo(totalBytes);
-	}
-}
-
-
-bool SjRingbuffer::ResizeDo(long totalBytes)
-{
-	wxASSERT( m_buffer && totalBytes > 0 );
-
-	unsigned char* newBuffer = (unsigned char*)malloc(totalBytes);
-	if( newBuffer == NULL )
-	{
-		return FALSE;
-	}
-
-	PeekFromBeg(newBuffer, 0, GetValidBytes());
-
-	free(m_buffer);
 
-	m_buffer				= newBuffer;
-	m_totalBytes			= totalBytes;
-	m_validPos				= 0;
-	m_waitingForResizeBytes = 0;
-
-	return TRUE;
+	memset(m_buffer, 0, m_totalSamples*sizeof(float));
+	m_writePos = 0;
+	m_writeEnd = 0;
+	return true;
 }
 
 
 void SjRingbuffer::Free()
 {
-    if( m_buffer )
-    {
-        free(m_buffer);
-        m_buffer = NULL;
-		m_totalBytes = 0;
-		//m_totalMs = 0;
-    }
-
-	wxASSERT( m_buffer == NULL && m_totalBytes == 0 );
-	Empty();
-}
-
+	if( m_buffer )
+	{
+		free(m_buffer);
+		m_buffer = NULL;
+	}
 
-void SjRingbuffer::Empty()
-{
-    m_validPos							= 0;
-    m_validBytes						= 0;
-	ResizeCheck();
+	m_totalSamples = 0;
+	m_mask = 0;
+	m_writePos = 0;
+	m_writeEnd = 0;
 }
 
 
-void SjRingbuffer::PushToEnd(const unsigned char* src, long bytesToCopy)
+void SjRingbuffer::Write(const float* src, long samples)
 {
-	// Function adds the given data to the end of the ringbuffer.
-	// If you use this function in different threads, don't forget
-	// to call Lock()/Unlock().
-
-	long i, destPos;
-
-	// check param
-    if( !m_buffer || !src || bytesToCopy <= 0 || m_validPos >= m_totalBytes ) {
+	if( m_buffer == NULL || src == NULL || samples <= 0 ) {
 		return;
-    }
-
-	// are there enough free bytes in the buffer?
-	if( bytesToCopy > GetFreeBytes() )
-	{
-		bytesToCopy = GetFreeBytes();
-
-		if( bytesToCopy <= 0 )
-		{
-			return; // buffer is full
-		}
 	}
 
-	// add data to buffer
-    destPos = (m_validPos + m_validBytes) % m_totalBytes;
+	// if we get more than the buffer can hold, only the end is of interest
+	if( samples > m_totalSamples ) {
+		src += samples - m_totalSamples;
+		samples = m_totalSamples;
+	}
 
-    if( destPos + bytesToCopy > m_totalBytes )
-    {
-        i = m_totalBytes - destPos;
+	// announce the range we're going to overwrite before touching the data
+	int64_t writePos = m_writePos.load(std::memory_order_relaxed); // only changed by us
+	m_writeEnd.store(writePos + samples, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
 
-        memcpy(m_buffer + destPos,  src,       i);
-        memcpy(m_buffer,            src + i,   bytesToCopy - i);
-    }
-    else
-    {
-        memcpy(m_buffer + destPos,  src,       bytesToCopy);
-    }
+	long destPos = (long)(writePos & m_mask);
+	long samplesAtEnd = m_totalSamples - destPos;
+	if( samples > samplesAtEnd )
+	{
+		memcpy(m_buffer + destPos, src,                samplesAtEnd*sizeof(float));
+		memcpy(m_buffer,           src + samplesAtEnd, (samples-samplesAtEnd)*sizeof(float));
+	}
+	else
+	{
+		memcpy(m_buffer + destPos, src, samples*sizeof(float));
+	}
 
-	// correct ringbuffer pointers
-    m_validBytes += bytesToCopy;
+	// publish the data
+	m_writePos.store(writePos + samples, std::memory_order_release);
 }
 
 
-void SjRingbuffer::PeekFromBeg(unsigned char* dest, long offset, long bytesToCopy) const
+long SjRingbuffer::ReadRange(int64_t from, int64_t to, float* dest) const
 {
-	// Function gets a number of valid bytes from the ringbuffer.
-	// If you use this function in different threads, don't forget
-	// to call Lock()/Unlock().
-
-	long bytesAtEnd, validPos;
-
-	if( !dest || !m_buffer || offset < 0 || bytesToCopy <= 0 ) {
-		return;
-	}
-
-	// check if there are enough bytes to copy
-	if( offset >= m_validBytes )
+	// copy [from, to); returns the number of samples at the end of dest
+	// that are still valid after the copy - the other ones may have been
+	// overwritten by the writer in the meantime.
+	long samples = (long)(to - from);
+	long srcPos = (long)(from & m_mask);
+	long samplesAtEnd = m_totalSamples - srcPos;
+	if( samples > samplesAtEnd )
 	{
-		memset(dest, 0, bytesToCopy);
-		return;
+		memcpy(dest,                m_buffer + srcPos, samplesAtEnd*sizeof(float));
+		memcpy(dest + samplesAtEnd, m_buffer,          (samples-samplesAtEnd)*sizeof(float));
 	}
-
-	if( bytesToCopy > (m_validBytes-offset) )
+	else
 	{
-		if( dest )
-		{
-			memset(dest + (m_validBytes-offset), 0, bytesToCopy-(m_validBytes-offset));
-		}
-
-		bytesToCopy = (m_validBytes-offset);
-
-		if( bytesToCopy <= 0 )
-		{
-			return;
-		}
+		memcpy(dest, m_buffer + srcPos, samples*sizeof(float));
 	}
 
-    // copy data
-	validPos = (m_validPos + offset) % m_totalBytes;
-
-    if( validPos + bytesToCopy > m_totalBytes )
-    {
-        bytesAtEnd = m_totalBytes - validPos;
-
-		if( dest )
-		{
-	        memcpy(dest,				m_buffer + validPos, bytesAtEnd);
-		    memcpy(dest + bytesAtEnd,	m_buffer,			 bytesToCopy - bytesAtEnd);
-		}
-    }
-    else
-    {
-		if( dest )
-		{
-			memcpy(dest,     m_buffer + validPos, bytesToCopy);
-		}
-    }
+	std::atomic_thread_fence(std::memory_order_acquire);
+	int64_t firstValid = m_writeEnd.load(std::memory_order_relaxed) - m_totalSamples;
+	if( firstValid <= from ) {
+		return samples;
+	}
+	else if( firstValid >= to ) {
+		return 0;
+	}
+	return (long)(to - firstValid);
 }
 
 
-void SjRingbuffer::RemoveFromBeg(long bytesToRemove)
+long SjRingbuffer::ReadNew(int64_t& readPos, float* dest, long maxSamples) const
 {
-	// Remove some bytes from the beginning of the buffer.
-	// If you use this function in different threads, don't forget
-	// to call Lock()/Unlock().
-	//
-	// It is okay to remove 0 bytes in which case the function does nothing.
+	if( m_buffer == NULL || dest == NULL || maxSamples <= 0 ) {
+		return 0;
+	}
 
-	if( bytesToRemove > m_validBytes ) {
-		bytesToRemove = m_validBytes;
+	int64_t to = GetWritePos();
+	int64_t from = readPos;
+	if( from > to ) {
+		from = to; // buffer re-allocated
+	}
+	if( to - from > maxSamples ) {
+		from = to - maxSamples;
+	}
+	if( to - from > m_totalSamples ) {
+		from = to - m_totalSamples;
 	}
+	readPos = to;
 
-    // correct buffer
-    m_validPos = (m_validPos + bytesToRemove) % m_totalBytes;
-    m_validBytes -= bytesToRemove;
+	long samples = (long)(to - from);
+	if( samples <= 0 ) {
+		return 0;
+	}
 
-	// are the valid bytes small enough to perform a possibly waiting buffer shrinking?
-	ResizeCheck();
+	long valid = ReadRange(from, to, dest);
+	if( valid < samples ) {
+		memmove(dest, dest + (samples-valid), valid*sizeof(float));
+	}
+	return valid;
 }
 
 
-
+long SjRingbuffer::ReadLast(float* dest, long samples) const
+{
+	int64_t readPos = 0;
+	return ReadNew(readPos, dest, samples);
+}
@@ -21,7 +21,7 @@
  *
  * File:    ringbuffer.h
  * Authors: Björn Petersen
- * Purpose: A simple ringbuffer
+ * Purpose: A lock-free ringbuffer with one writer and any number of readers
  *
  ******************************************************************************/
 
@@ -30,6 +30,15 @@
 #define __SJ_RINGBUFFER_H__
 
 
+#include <atomic>
+
+
+// SjRingbuffer holds the most recent samples written to it.  There is exactly
+// one writer (eg. the audio thread) and any number of readers; the writer
+// never waits for the readers and nobody allocates memory or takes a lock
+// after Alloc().  If a reader is too slow, the oldest samples are lost.
+//
+// Positions are counted in samples since Alloc() and never wrap around.
 class SjRingbuffer
 {
 public:
@@ -37,52 +46,39 @@ public:
 	               SjRingbuffer        ();
 	               ~SjRingbuffer       ();
 
-	// (Re-)Allocating the buffer
-	bool            Alloc               (long totalBytes);
-	bool            Resize              (long totalBytes);
+	// (Re-)Allocating the buffer, the number of samples is rounded up to a
+	// power of two.  Not thread-safe, call this before the buffer is used.
+	bool            Alloc               (long totalSamples);
 	void            Free                ();
 	bool            IsAllocated         () const { return m_buffer!=NULL; }
+	long            GetTotalSamples     () const { return m_totalSamples; }
 
-	// Common Buffer Information
-	// Note: free+valid is not always equal to the number of total bytes eg. when
-	// a buffer resizing is waiting!!
-	long           GetTotalBytes       () const { return m_totalBytes; }
-	long           GetFreeBytes        () const { return m_waitingForResizeBytes?
-															   0
-															: ((m_totalBytes - m_validBytes));
-												 }
-	long            GetValidBytes       () const { return m_validBytes; }
-
-	// Writing and reading to/from the buffer.
-	void            PushToEnd           (const unsigned char* src, long bytes);
-	void            PeekFromBeg         (unsigned char* dest, long offset, long bytes) const;
-	void            RemoveFromBeg       (long bytes);
+	// Writing, only one thread may call this function
+	void            Write               (const float* src, long samples);
 
-	// Empty the buffer content, this does NOT free the buffer.
-	void            Empty               ();
-
-	// Locking the buffer, if you use the buffer from withing
-	// threads you should call Lock()/Unlock() before/after
-	// every function that will modify the buffer.  SjRingbuffer does
-	// not use Lock()/Unlock() itself for performance reasons.
-	void            Lock                () { m_criticalSection.Enter(); }
-	void		    Unlock              () { m_criticalSection.Leave(); }
+	// Reading, may be called from any thread.  GetWritePos() returns the
+	// number of samples written so far.
+	// ReadNew() copies the samples written since readPos and advances readPos;
+	// if there are more than maxSamples (or the writer has overwritten
+	// some), only the newest ones are copied.  ReadLast() copies the newest
+	// samples.  Both return the number of samples copied.
+	int64_t         GetWritePos         () const { return m_writePos.load(std::memory_order_acquire); }
+	long            ReadNew             (int64_t& readPos, float* dest, long maxSamples) const;
+	long            ReadLast            (float* dest, long samples) const;
 
 private:
 	// private stuff
-	wxCriticalSection m_criticalSection;
-
-	unsigned char*  m_buffer;
-	long            m_totalBytes;
+	float*          m_buffer;
+	long            m_totalSamples;
+	long            m_mask;
 
-	long            m_validPos;
-	long            m_validBytes;
+	// m_writePos is set after the samples are written, m_writeEnd before;
+	// samples before m_writeEnd-m_totalSamples may be overwritten while being read.
+	std::atomic<int64_t> m_writePos;
+	std::atomic<int64_t> m_writeEnd;
 
-	bool            ResizeDo            (long totalBytes);
-	void            ResizeCheck         () { if( m_waitingForResizeBytes && m_validBytes <= m_waitingForResizeBytes ) { ResizeDo(m_waitingForResizeBytes); } }
-	long            m_waitingForResizeBytes;
+	long            ReadRange           (int64_t from, int64_t to, float* dest) const;
 };
 
 
 #endif // __SJ_RINGBUFFER_H__
-
@@ -184,13 +184,21 @@ extern "C"
 wxSqltDb* wxSqltDb::s_defaultDb = NULL;
 
 
-wxSqltDb::wxSqltDb(const wxString& file)
+wxSqltDb::wxSqltDb(const wxString& file, long flags)
 {
 	m_transactionCount          = 0;
 	m_transactionVacuumPending  = FALSE;
 	m_file                      = file;
+	m_flags                     = flags;
 	m_dbExistsBeforeOpening     = ::wxFileExists(file);
 	m_sqlite                    = NULL;
+	m_mmapBytes                 = 0;
+	m_readersMax                = 0;
+	m_readersOpen               = 0;
+	m_readersSemaphore          = NULL;
+	m_configCache               = NULL;
+	m_configPending             = NULL;
+	m_configPendingCount        = 0;
 	#ifdef __WXDEBUG__
 	m_instanceCount             = 0;
 	#endif
@@ -218,7 +226,8 @@ wxSqltDb::wxSqltDb(const wxString& file)
 	#endif
 	const char* fileSqlite3Str = fileCharBuf.data();
 
-	if( sqlite3_open(fileSqlite3Str, &m_sqlite) != SQLITE_OK )
+	int openFlags = (flags&WXSQLT_READONLY)? SQLITE_OPEN_READONLY : (SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE);
+	if( sqlite3_open_v2(fileSqlite3Str, &m_sqlite, openFlags, NULL) != SQLITE_OK )
 	{
 		if( m_sqlite )
 		{
@@ -234,6 +243,12 @@ wxSqltDb::wxSqltDb(const wxString& file)
 	}
 
 	// some initialisations ... database strings are _always_ encoded using UTF-8.
+	if( flags&WXSQLT_READONLY )
+	{
+		// ... readers wait for the main connection instead of failing
+		sqlite3_busy_timeout(m_sqlite, 5000);
+	}
+	else
 	{
 		wxSqlt sql(this);
 
@@ -249,7 +264,9 @@ wxSqltDb::wxSqltDb(const wxString& file)
 	sqlite3_create_function(m_sqlite, "timestamp",    1/*number of arguments*/,     SQLITE_ANY, this, sqlite_timestamp,   NULL, NULL);
 	sqlite3_create_function(m_sqlite, "filetype",     1/*number of arguments*/,     SQLITE_ANY, this, sqlite_filetype,    NULL, NULL);
 	sqlite3_create_function(m_sqlite, "levensthein", -1/*any number of arguments*/, SQLITE_ANY, this, sqlite_levensthein, NULL, NULL);
-	sqlite3_create_function(m_sqlite, "queuepos",    -1/*any number of arguments*/, SQLITE_ANY, this, sqlite_queuepos,    NULL, NULL);
+	if( !(flags&WXSQLT_READONLY) ) {
+		sqlite3_create_function(m_sqlite, "queuepos", -1/*any number of arguments*/, SQLITE_ANY, this, sqlite_queuepos, NULL, NULL); // needs the main thread
+	}
 	sqlite3_create_function(m_sqlite, "sortable",    -1/*any number of arguments*/, SQLITE_ANY, this, sqlite_sortable,    NULL, NULL);
 	sqlite3_create_function(m_sqlite, "nulltoend",    1/*any number of arguments*/, SQLITE_ANY, this, sqlite_nulltoend,   NULL, NULL);
 }
@@ -259,11 +276,28 @@ wxSqltDb::~wxSqltDb()
 {
 	wxASSERT(m_transactionCount == 0);
 
+	// write pending configuration changes
+	if( m_sqlite )
+	{
+		ConfigFlush();
+	}
+	delete m_configCache;
+	delete m_configPending;
+
 	if( s_defaultDb == this )
 	{
 		s_defaultDb = NULL;
 	}
 
+	// close the reader pool; all readers should be released at this point
+	wxASSERT( m_readersOpen == (int)m_readersFree.GetCount() );
+	for( size_t i = 0; i < m_readersFree.GetCount(); i++ )
+	{
+		delete (wxSqltDb*)m_readersFree[i];
+	}
+	m_readersFree.Clear();
+	delete m_readersSemaphore;
+
 	if( m_sqlite )
 	{
 		#ifdef __WXDEBUG__
@@ -359,6 +393,107 @@ long wxSqltDb::GetSync()
 }
 
 
+bool wxSqltDb::SetWal(bool wal)
+{
+	// the journal mode is stored in the file, however, setting it again does not harm
+	wxSqlt sql(this);
+	sql.Query(wal? wxT("PRAGMA journal_mode=WAL;") : wxT("PRAGMA journal_mode=DELETE;"));
+	return GetWal();
+}
+
+
+bool wxSqltDb::GetWal()
+{
+	wxSqlt sql(this);
+	sql.Query(wxT("PRAGMA journal_mode;"));
+	if( sql.Next() )
+	{
+		return sql.GetString(0).Lower()==wxT("wal");
+	}
+	return FALSE;
+}
+
+
+void wxSqltDb::SetMmapSize(long bytes)
+{
+	// memory mapping is a setting of the connection, it is also used for
+	// readers opened later; 0 disables memory mapped I/O
+	m_mmapBytes = bytes<0? 0 : bytes;
+	wxSqlt sql(this);
+	sql.Query(wxString::Format(wxT("PRAGMA mmap_size=%li;"), m_mmapBytes));
+}
+
+
+void wxSqltDb::SetMaxReaders(int count)
+{
+	wxASSERT( wxThread::IsMain() );
+	wxASSERT( !(m_flags&WXSQLT_READONLY) );
+	wxASSERT( m_readersSemaphore == NULL );
+	if( m_readersSemaphore || count <= 0 )
+	{
+		return;
+	}
+
+	m_readersMax = count;
+	m_readersSemaphore = new wxSemaphore(count, count);
+}
+
+
+wxSqltDb* wxSqltDb::AcquireReader()
+{
+	if( m_readersSemaphore == NULL )
+	{
+		return NULL; // no pool
+	}
+
+	m_readersSemaphore->Wait();
+
+	{
+		wxCriticalSectionLocker locker(m_readersCritical);
+		if( !m_readersFree.IsEmpty() )
+		{
+			wxSqltDb* reader = (wxSqltDb*)m_readersFree.Last();
+			m_readersFree.RemoveAt(m_readersFree.GetCount()-1);
+			return reader;
+		}
+		m_readersOpen++;
+	}
+
+	// open a new connection, this is done outside the critical section;
+	// the semaphore makes sure, we do not open more than m_readersMax connections
+	wxSqltDb* reader = new wxSqltDb(m_file, WXSQLT_READONLY);
+	if( !reader->IsOk() )
+	{
+		delete reader;
+		{
+			wxCriticalSectionLocker locker(m_readersCritical);
+			m_readersOpen--;
+		}
+		m_readersSemaphore->Post();
+		return NULL;
+	}
+
+	if( m_mmapBytes > 0 )
+	{
+		wxSqlt sql(reader);
+		sql.Query(wxString::Format(wxT("PRAGMA mmap_size=%li;"), m_mmapBytes));
+	}
+
+	return reader;
+}
+
+
+void wxSqltDb::ReleaseReader(wxSqltDb* reader)
+{
+	wxASSERT( reader && m_readersSemaphore );
+	{
+		wxCriticalSectionLocker locker(m_readersCritical);
+		m_readersFree.Add(reader);
+	}
+	m_readersSemaphore->Post();
+}
+
+
 long wxSqltDb::Bytes2Pages(long bytes)
 {
 	// each page needs about 1 KB on disk and 1.5 KB in memory,
@@ -404,15 +539,41 @@ wxString wxSqlt::QParam(const wxString& str)
 
 bool wxSqlt::Query(const wxString& query)
 {
-	int         sqlState;
+	if( !Prepare(query) )
+	{
+		return FALSE;
+	}
+
+	m_prepared = FALSE;
+	if( !Execute() )
+	{
+		// error - message already displayed in FetchQuery_()
+		CloseQuery();
+		return FALSE;
+	}
+	else if( m_fetchState == 'd' )
+	{
+		// success - however, there is no result, the virtual machine
+		// is not needed any longer
+		CloseQuery();
+	}
+
+	// success - you can get the rows using Next()
+	return TRUE;
+}
+
+
+bool wxSqlt::Prepare(const wxString& query)
+{
 	const char* sqlTail = NULL;  // OUT: Part of zSQL not compiled
 
 	// close any open query
 	CloseQuery();
 
-	// compile the complete SQL string
+	// compile the complete SQL string; sqlite3_prepare_v2() recompiles the statement
+	// after schema changes and returns the real error codes from sqlite3_step()
 	WXSTRING_TO_SQLITE3(query)
-	if( sqlite3_prepare(m_db->m_sqlite, querySqlite3Str, -1, &m_stmt, &sqlTail) != SQLITE_OK )
+	if( sqlite3_prepare_v2(m_db->m_sqlite, querySqlite3Str, -1, &m_stmt, &sqlTail) != SQLITE_OK )
 	{
 		const char* err = sqlite3_errmsg(m_db->m_sqlite);
 		SQLITE3_TO_WXSTRING(err)
@@ -430,27 +591,104 @@ bool wxSqlt::Query(const wxString& query)
 		return FALSE;
 	}
 
-	// fetch query
-	sqlState = FetchQuery_();
+	m_prepared = TRUE;
+	m_fetchState = 'd'; // nothing fetched yet
+	m_fieldCount = 0;
+	return TRUE;
+}
+
+
+void wxSqlt::Reset()
+{
+	if( m_stmt )
+	{
+		sqlite3_reset(m_stmt);
+		sqlite3_clear_bindings(m_stmt);
+		m_fetchState = 'd';
+		m_fieldCount = 0;
+	}
+}
+
+
+bool wxSqlt::BindError_(int sqlState)
+{
+	if( sqlState != SQLITE_OK )
+	{
+		const char* err = sqlite3_errmsg(m_db->m_sqlite);
+		SQLITE3_TO_WXSTRING(err)
+		wxLogError(errWxStr);
+
+		wxLogError(wxT("Cannot bind SQL parameter.")/*n/t*/);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+
+bool wxSqlt::Bind(int paramIndex, const wxString& value)
+{
+	wxASSERT(m_stmt);
+	WXSTRING_TO_SQLITE3(value)
+	return !BindError_(sqlite3_bind_text(m_stmt, paramIndex, valueSqlite3Str, -1, SQLITE_TRANSIENT));
+}
+
+
+bool wxSqlt::Bind(int paramIndex, const char* utf8, int bytes)
+{
+	wxASSERT(m_stmt);
+	return !BindError_(sqlite3_bind_text(m_stmt, paramIndex, utf8, bytes, SQLITE_TRANSIENT));
+}
+
+
+bool wxSqlt::Bind(int paramIndex, long value)
+{
+	wxASSERT(m_stmt);
+	return !BindError_(sqlite3_bind_int64(m_stmt, paramIndex, value));
+}
+
+
+bool wxSqlt::Bind(int paramIndex, double value)
+{
+	wxASSERT(m_stmt);
+	return !BindError_(sqlite3_bind_double(m_stmt, paramIndex, value));
+}
+
+
+bool wxSqlt::BindNull(int paramIndex)
+{
+	wxASSERT(m_stmt);
+	return !BindError_(sqlite3_bind_null(m_stmt, paramIndex));
+}
+
+
+bool wxSqlt::Execute()
+{
+	if( m_stmt == NULL )
+	{
+		return FALSE;
+	}
+
+	// a prepared statement may have been executed before; the bindings stay
+	if( m_prepared )
+	{
+		sqlite3_reset(m_stmt);
+	}
+
+	int sqlState = FetchQuery_();
 	if( sqlState == SQLITE_ERROR )
 	{
-		// error - message already displayed in FetchQuery_()
-		CloseQuery();
+		m_fetchState = 'd';
 		return FALSE;
 	}
 	else if( sqlState == SQLITE_ROW )
 	{
-		// success - you can get the rows using Next()
 		m_fetchState = 'f'; // [f]irst
-		return TRUE;
 	}
 	else
 	{
-		// success - however, there is no result, the virtual machine
-		// stays in memory for reuse
-		CloseQuery();
-		return TRUE;
+		m_fetchState = 'd'; // [d]one
 	}
+	return TRUE;
 }
 
 
@@ -477,11 +715,14 @@ int wxSqlt::FetchQuery_()
 		// error - we do not log this as this error may occur under mysterious circumstances - see
 		// http://www.silverjuke.net/forum/viewtopic.php?t=900
 		#ifdef __WXDEBUG__
-		const char* err = sqlite3_errmsg(m_db->m_sqlite);
-		SQLITE3_TO_WXSTRING(err)
-		wxLogError(errWxStr);
+		if( sqlState != SQLITE_INTERRUPT ) // cancelled by a progress handler
+		{
+			const char* err = sqlite3_errmsg(m_db->m_sqlite);
+			SQLITE3_TO_WXSTRING(err)
+			wxLogError(errWxStr);
 
-		wxLogError(wxT("Cannot get SQL row.")/*n/t*/);
+			wxLogError(wxT("Cannot get SQL row.")/*n/t*/);
+		}
 		#endif
 		return SQLITE_ERROR;
 	}
@@ -492,7 +733,10 @@ void wxSqlt::CloseQuery()
 {
 	if( m_stmt )
 	{
-		if( sqlite3_finalize(m_stmt) != SQLITE_OK )
+		// sqlite3_finalize() returns the error of the last step; a query interrupted
+		// by a progress handler is not an error worth logging
+		int sqlState = sqlite3_finalize(m_stmt);
+		if( sqlState != SQLITE_OK && sqlState != SQLITE_INTERRUPT )
 		{
 			const char* err = sqlite3_errmsg(m_db->m_sqlite);
 			SQLITE3_TO_WXSTRING(err)
@@ -504,6 +748,7 @@ void wxSqlt::CloseQuery()
 		m_stmt = NULL;
 		m_fieldCount = 0; // needed eg. for save scripting
 		m_fetchState = 'd'; // [d]one
+		m_prepared = FALSE;
 	}
 }
 
@@ -526,7 +771,14 @@ bool wxSqlt::Next()
 		// fetch next row
 		if( FetchQuery_()!=SQLITE_ROW )
 		{
-			CloseQuery();
+			if( m_prepared )
+			{
+				m_fetchState = 'd'; // keep the statement for the next Execute()
+			}
+			else
+			{
+				CloseQuery();
+			}
 			return FALSE;
 		}
 	}
@@ -625,8 +877,103 @@ void wxSqlt::AddColumn(const wxString& tablename, const wxString& column_def)
  ******************************************************************************/
 
 
+bool wxSqltDb::ConfigLoad()
+{
+	// load the config table, the caller should lock m_configCritical;
+	// readers are not cached as they would not see the changes of the main connection
+	if( m_configCache == NULL && !(m_flags&WXSQLT_READONLY) )
+	{
+		m_configCache = new SjSSHash();
+
+		wxSqlt sql(this);
+		sql.Query(wxT("SELECT keyname, value FROM config ORDER BY id DESC;")); // DESC: for duplicate keys, the first one wins as with a single SELECT
+		while( sql.Next() )
+		{
+			m_configCache->Insert(sql.GetString(0), sql.GetString(1));
+		}
+	}
+
+	return m_configCache!=NULL;
+}
+
+
+void wxSqltDb::ConfigFlush()
+{
+	wxCriticalSectionLocker locker(m_configCritical);
+
+	if( m_configPending == NULL || m_configPendingCount == 0 )
+	{
+		return; // nothing to write
+	}
+
+	// write all pending changes in one transaction; we do not use wxSqltTransaction
+	// as the transaction calls ConfigFlush() itself
+	wxSqlt sql(this);
+	bool ownTransaction = sqlite3_get_autocommit(m_sqlite)!=0; // not in a transaction, may also be started by a script
+	if( ownTransaction )
+	{
+		sql.Query(wxT("BEGIN;"));
+	}
+
+	SjHashIterator iterator;
+	wxString keyname, *value;
+	while( (value=m_configPending->Iterate(iterator, keyname)) )
+	{
+		sql.Query(wxT("UPDATE config SET value='") + sql.QParam(*value) + wxT("' WHERE keyname='") + sql.QParam(keyname) + wxT("';"));
+		if( sql.GetChangedRows() == 0 )
+		{
+			sql.Query(wxT("INSERT INTO config (keyname, value) VALUES ('") + sql.QParam(keyname) + wxT("', '") + sql.QParam(*value) + wxT("')"));
+		}
+	}
+
+	if( ownTransaction )
+	{
+		sql.Query(wxT("COMMIT;"));
+	}
+
+	m_configPending->Clear();
+	m_configPendingCount = 0;
+}
+
+
+void wxSqltDb::ConfigForget()
+{
+	// the pending changes are dropped; if needed, call ConfigFlush() before
+	wxCriticalSectionLocker locker(m_configCritical);
+
+	delete m_configCache;
+	m_configCache = NULL;
+
+	delete m_configPending;
+	m_configPending = NULL;
+	m_configPendingCount = 0;
+}
+
+
 void wxSqlt::ConfigWrite(const wxString& keyname, const wxString& value)
 {
+	{
+		wxCriticalSectionLocker locker(m_db->m_configCritical);
+		if( m_db->ConfigLoad() )
+		{
+			wxString* oldValue = m_db->m_configCache->Lookup(keyname);
+			if( oldValue && *oldValue == value )
+			{
+				return; // nothing changed
+			}
+
+			m_db->m_configCache->Insert(keyname, value);
+
+			if( m_db->m_configPending == NULL )
+			{
+				m_db->m_configPending = new SjSSHash();
+			}
+			m_db->m_configPending->Insert(keyname, value);
+			m_db->m_configPendingCount = m_db->m_configPending->GetCount();
+			return; // written by ConfigFlush()
+		}
+	}
+
 	Query(wxT("SELECT value FROM config WHERE keyname='") +  QParam(keyname) + wxT("';"));
 	if( !Next() )
 	{
@@ -641,6 +988,15 @@ void wxSqlt::ConfigWrite(const wxString& keyname, const wxString& value)
 
 wxString wxSqlt::ConfigRead(const wxString& keyname, const wxString& def)
 {
+	{
+		wxCriticalSectionLocker locker(m_db->m_configCritical);
+		if( m_db->ConfigLoad() )
+		{
+			wxString* value = m_db->m_configCache->Lookup(keyname);
+			return value? *value : def;
+		}
+	}
+
 	Query(wxT("SELECT value FROM config WHERE keyname='") + QParam(keyname) + wxT("';"));
 	return Next()? GetString(0) : def;
 }
@@ -648,6 +1004,27 @@ wxString wxSqlt::ConfigRead(const wxString& keyname, const wxString& def)
 
 long wxSqlt::ConfigRead(const wxString& keyname, long def)
 {
+	{
+		wxCriticalSectionLocker locker(m_db->m_configCritical);
+		if( m_db->ConfigLoad() )
+		{
+			wxString* value = m_db->m_configCache->Lookup(keyname);
+			if( value == NULL )
+			{
+				return def;
+			}
+
+			// ConfigWrite() writes longs using %lu, so negative values
+			// are stored as large unsigned numbers
+			unsigned long ul;
+			if( value->ToULong(&ul) )
+			{
+				return (long)ul;
+			}
+			return wxAtol(*value); // as sqlite, use the leading number, if any
+		}
+	}
+
 	Query(wxT("SELECT value FROM config WHERE keyname='") + QParam(keyname) + wxT("';"));
 	return Next()? GetLong(0) : def;
 }
@@ -655,6 +1032,19 @@ long wxSqlt::ConfigRead(const wxString& keyname, long def)
 
 void wxSqlt::ConfigDeleteEntry(const wxString& keyname)
 {
+	{
+		wxCriticalSectionLocker locker(m_db->m_configCritical);
+		if( m_db->m_configCache )
+		{
+			m_db->m_configCache->Remove(keyname);
+		}
+		if( m_db->m_configPending )
+		{
+			m_db->m_configPending->Remove(keyname);
+			m_db->m_configPendingCount = m_db->m_configPending->GetCount();
+		}
+	}
+
 	Query(wxT("DELETE FROM config WHERE keyname='") + QParam(keyname) + wxT("';"));
 }
 
@@ -672,6 +1062,13 @@ wxSqltTransaction::wxSqltTransaction(wxSqltDb* db)
 		wxLogFatalError(wxT("No database given to wxSqltTransaction()."));
 	}
 
+	// write pending configuration changes before, so that a rollback
+	// only drops the changes made inside the transaction
+	if( m_db->m_transactionCount == 0 )
+	{
+		m_db->ConfigFlush();
+	}
+
 	wxASSERT( m_db->m_transactionCount >= 0 );
 	m_db->m_transactionCount++;
 	m_commited = FALSE;
@@ -702,6 +1099,7 @@ wxSqltTransaction::~wxSqltTransaction()
 				wxSqlt sql(m_db);
 				sql.Query(wxT("ROLLBACK;"));
 			}
+			m_db->ConfigForget(); // the config table may have changed by the rollback
 		}
 	}
 
@@ -720,6 +1118,10 @@ bool wxSqltTransaction::Commit()
 		bool ret;
 		m_db->OnTransactionCommit();
 		{
+			// configuration changes made inside the transaction are written
+			// with it; ConfigFlush() does not start its own transaction here
+			m_db->ConfigFlush();
+
 			wxBusyCursor busy;
 			wxSqlt sql(m_db);
 			ret = sql.Query(wxT("COMMIT;"));
@@ -748,4 +1150,22 @@ bool wxSqltTransaction::Commit()
 }
 
 
+/*******************************************************************************
+ * wxSqltReader
+ ******************************************************************************/
 
+
+wxSqltReader::wxSqltReader(wxSqltDb* db)
+{
+	m_db = db? db : wxSqltDb::s_defaultDb;
+	m_reader = m_db? m_db->AcquireReader() : NULL;
+}
+
+
+wxSqltReader::~wxSqltReader()
+{
+	if( m_reader )
+	{
+		m_db->ReleaseReader(m_reader);
+	}
+}
@@ -31,6 +31,7 @@
 
 
 #include <wx/wx.h>
+#include <wx/thread.h>
 #include <sqlite3.h>
 
 
@@ -75,13 +76,19 @@
 
 
 class wxSqlt;
+class SjSSHash;
+
+
+
+// flags for wxSqltDb
+#define WXSQLT_READONLY 0x01L
 
 
 
 class wxSqltDb
 {
 public:
-						wxSqltDb                (const wxString& file);
+						wxSqltDb                (const wxString& file, long flags=0);
 	virtual             ~wxSqltDb               ();
 
 	bool                IsOk                    () const {return m_sqlite? TRUE : FALSE; }
@@ -99,6 +106,29 @@ public:
 	long                GetSync                 ();
 	sqlite3*            GetDb                   () { return m_sqlite; }
 
+	// journal and memory mapping; in WAL mode, readers in other threads are
+	// not blocked by writing on the main connection and vice versa.
+	// SetWal() returns TRUE if WAL is in use afterwards.
+	bool                SetWal                  (bool wal);
+	bool                GetWal                  ();
+	void                SetMmapSize             (long bytes);
+
+	// a pool of read-only connections to the same file for use by other
+	// threads, see wxSqltReader.  SetMaxReaders() should be called only once
+	// after opening; 0 disables the pool.
+	void                SetMaxReaders           (int count);
+	int                 GetMaxReaders           () const { return m_readersMax; }
+
+	// the config table is loaded into memory on the first ConfigRead() and
+	// ConfigWrite() only changes the memory; the changes are written by
+	// ConfigFlush() in one transaction, this should be done from time to time
+	// and is done before a transaction is started, just before it is committed
+	// and before the database is closed.  ConfigForget() drops the loaded table, this must be called if
+	// the config table is modified by other ways.  Readers are not cached.
+	bool                HasConfigPending        () const { return m_configPending!=NULL && m_configPendingCount>0; }
+	void                ConfigFlush             ();
+	void                ConfigForget            ();
+
 	// some events that may be used by derived classes.
 	// the event are placed here and not in wxSqltTransaction as calling
 	// virtual functions in the constructor/destructor is not straight-forward
@@ -111,6 +141,7 @@ public:
 
 private:
 	wxString            m_file;
+	long                m_flags;
 	bool                m_dbExistsBeforeOpening;
 	sqlite3*            m_sqlite;
 	int                 m_transactionCount;
@@ -122,10 +153,28 @@ private:
 	long                Bytes2Pages         (long bytes);
 	long                Pages2Bytes         (long pages);
 
+	// the reader pool, only used by the main connection
+	long                m_mmapBytes;
+	int                 m_readersMax;
+	int                 m_readersOpen;
+	wxArrayPtrVoid      m_readersFree;
+	wxCriticalSection   m_readersCritical;
+	wxSemaphore*        m_readersSemaphore;
+	wxSqltDb*           AcquireReader       ();
+	void                ReleaseReader       (wxSqltDb*);
+
+	// the config cache, see ConfigFlush()
+	SjSSHash*           m_configCache;      // NULL if not yet loaded
+	SjSSHash*           m_configPending;    // changed keys not yet written
+	long                m_configPendingCount;
+	wxCriticalSection   m_configCritical;
+	bool                ConfigLoad          ();
+
 	static wxSqltDb*    s_defaultDb;
 
 	friend class        wxSqlt;
 	friend class        wxSqltTransaction;
+	friend class        wxSqltReader;
 
 	bool                RecodeToUtf8        (wxSqlt& sql1);
 };
@@ -140,6 +189,7 @@ public:
 	{
 		m_db = db? db : wxSqltDb::s_defaultDb;
 		m_stmt = NULL;
+		m_prepared = FALSE;
 		wxASSERT(m_db);
 		#ifdef __WXDEBUG__
 			m_db->m_instanceCount++;
@@ -173,6 +223,22 @@ public:
 	bool            Query               (const wxString& query);
 	bool            Next                ();
 
+	// prepared statements, use as:
+	//  sql.Prepare("SELECT id FROM tracks WHERE artistname=? AND year>?");
+	//  sql.Bind(1, artist); sql.Bind(2, 1980L);
+	//  sql.Execute();
+	//  while( sql.Next() ) ...
+	//  sql.Reset(); // rebind and execute again
+	// the statement stays compiled until CloseQuery() or the next Query()/Prepare()
+	bool            Prepare             (const wxString& query);
+	void            Reset               ();
+	bool            Bind                (int paramIndex, const wxString& value);
+	bool            Bind                (int paramIndex, const char* utf8, int bytes=-1);
+	bool            Bind                (int paramIndex, long value);
+	bool            Bind                (int paramIndex, double value);
+	bool            BindNull            (int paramIndex);
+	bool            Execute             ();
+
 	// query the result using the field index
 	long            GetFieldCount       () const { return m_fieldCount; }
 	bool            IsSet               (int fieldIndex) const
@@ -196,6 +262,16 @@ public:
 		return (const char*)sqlite3_column_text(m_stmt, fieldIndex);
 	}
 	long            GetLong             (int fieldIndex) const { wxASSERT(fieldIndex>=0 && fieldIndex<m_fieldCount); return sqlite3_column_int(m_stmt, fieldIndex); }
+	double          GetDouble           (int fieldIndex) const { wxASSERT(fieldIndex>=0 && fieldIndex<m_fieldCount); return sqlite3_column_double(m_stmt, fieldIndex); }
+	int             GetType             (int fieldIndex) const { wxASSERT(fieldIndex>=0 && fieldIndex<m_fieldCount); return sqlite3_column_type(m_stmt, fieldIndex); } // SQLITE_INTEGER, SQLITE_TEXT etc.
+	const char*     GetUtf8Ptr          (int fieldIndex, int* bytes) const
+	{
+		// the pointer is valid until the next call to Next(); this avoids the conversion to wxString
+		wxASSERT(fieldIndex>=0 && fieldIndex<m_fieldCount);
+		const char* str = (const char*)sqlite3_column_text(m_stmt, fieldIndex);
+		*bytes = sqlite3_column_bytes(m_stmt, fieldIndex);
+		return str;
+	}
 
 	// same as the functions above, but for names fields;
 	// note that this is some slower!
@@ -232,9 +308,11 @@ private:
 	// private stuff, use as less an as "easy" objects as possible
 	// for fast wxSqlt creation on the stack
 	int             FetchQuery_         ();
+	bool            BindError_          (int sqlState);
 	wxSqltDb*       m_db;
 	sqlite3_stmt*   m_stmt;
 	int             m_fetchState; // [d]one, [f]irst or 0
+	bool            m_prepared;   // keep m_stmt when done, set by Prepare()
 
 	int             m_fieldCount;
 };
@@ -258,6 +336,31 @@ private:
 };
 
 
+class wxSqltReader
+{
+	// Borrows a read-only connection from the pool of the given (or the
+	// default) database, use as:
+	//  wxSqltReader reader;
+	//  if( reader.IsOk() ) {
+	//      wxSqlt sql(reader.GetDb());
+	//      sql.Query(...
+	//  }
+	// Readers may be used in any thread, however, one reader must not be used
+	// by two threads at the same time.  If all connections are in use, the
+	// constructor waits until one is released.  The SQL function queuepos()
+	// is not available for readers.
+public:
+	wxSqltReader        (wxSqltDb* db = NULL);
+	~wxSqltReader       ();
+	bool            IsOk                () const { return m_reader!=NULL; }
+	wxSqltDb*       GetDb               () const { return m_reader; }
+
+private:
+	wxSqltDb*       m_db;
+	wxSqltDb*       m_reader;
+};
+
+
 #ifdef __WXDEBUG__
 extern "C"
 {
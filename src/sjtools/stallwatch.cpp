@@ -0,0 +1,265 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2016 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    stallwatch.cpp
+ * Authors: Björn Petersen
+ * Purpose: Finding out where the main thread is blocked
+ *
+ ******************************************************************************/
+
+
+#include <sjbase/base.h>
+#include <sjtools/stallwatch.h>
+#include <chrono>
+
+
+SjStallWatch* SjStallWatch::s_this = NULL;
+
+
+/*******************************************************************************
+ * the sampling thread
+ ******************************************************************************/
+
+
+class SjStallWatchThread : public wxThread
+{
+public:
+	SjStallWatchThread(SjStallWatch* watch) : wxThread(wxTHREAD_JOINABLE) { m_watch = watch; }
+
+private:
+	SjStallWatch* m_watch;
+
+	void* Entry()
+	{
+		long sampleMs = (long)(m_watch->m_thresholdUs / 2000);
+		if( sampleMs < 10 ) {
+			sampleMs = 10;
+		}
+
+		while( m_watch->m_exitSemaphore.WaitTimeout(sampleMs) == wxSEMA_TIMEOUT )
+		{
+			m_watch->Sample();
+		}
+		return NULL;
+	}
+};
+
+
+/*******************************************************************************
+ * SjStallWatch
+ ******************************************************************************/
+
+
+void SjStallWatch::Init(long thresholdMs, const wxString& traceFile)
+{
+	wxASSERT( wxThread::IsMain() );
+
+	if( thresholdMs > 0 && s_this == NULL )
+	{
+		s_this = new SjStallWatch(thresholdMs, traceFile);
+		wxLogInfo(wxT("Main thread stalls longer than %i ms are recorded to %s"), (int)thresholdMs, traceFile.c_str());
+	}
+}
+
+
+void SjStallWatch::Exit()
+{
+	wxASSERT( wxThread::IsMain() );
+
+	if( s_this )
+	{
+		SjStallWatch* watch = s_this;
+		s_this = NULL; // scopes still open just do nothing on leave
+		delete watch;
+	}
+}
+
+
+SjStallWatch::SjStallWatch(long thresholdMs, const wxString& traceFile)
+{
+	m_depth          = 0;
+	m_startUs        = GetUsTicks();
+	m_lastActivityUs = m_startUs;
+	m_lastStallUs    = 0;
+	m_droppedEvents  = 0;
+	m_stallCount     = 0;
+	m_thresholdUs    = (int64_t)thresholdMs * 1000;
+	m_traceFile      = traceFile;
+
+	AddEvent(wxT("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"main\"}}"));
+
+	m_thread = new SjStallWatchThread(this);
+	if( m_thread->Create() != wxTHREAD_NO_ERROR || m_thread->Run() != wxTHREAD_NO_ERROR )
+	{
+		delete m_thread;
+		m_thread = NULL; // handlers and scopes are still recorded, we just do not sample
+	}
+}
+
+
+SjStallWatch::~SjStallWatch()
+{
+	if( m_thread )
+	{
+		m_exitSemaphore.Post();
+		m_thread->Wait();
+		delete m_thread;
+	}
+
+	WriteTrace();
+}
+
+
+int64_t SjStallWatch::GetUsTicks()
+{
+	// not wxGetUTCTimeUSec() - adjusting the wall clock would fake or hide stalls
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void SjStallWatch::Enter(const char* name, const wxEvent* event)
+{
+	int64_t nowUs = GetUsTicks();
+
+	wxCriticalSectionLocker locker(m_critical);
+
+	if( m_depth < SJ_STALL_MAX_DEPTH )
+	{
+		SjStallFrame& frame = m_frames[m_depth];
+		frame.name       = name;
+		frame.eventClass = event? event->GetClassInfo() : NULL;
+		frame.eventType  = event? (int)event->GetEventType() : 0;
+		frame.eventId    = event? event->GetId() : 0;
+		frame.startUs    = nowUs;
+	}
+	m_depth++;
+	m_lastActivityUs = nowUs;
+}
+
+
+void SjStallWatch::Leave()
+{
+	int64_t nowUs = GetUsTicks();
+
+	wxCriticalSectionLocker locker(m_critical);
+
+	if( m_depth <= 0 ) {
+		return;
+	}
+
+	m_depth--;
+	m_lastActivityUs = nowUs;
+
+	if( m_depth < SJ_STALL_MAX_DEPTH )
+	{
+		const SjStallFrame& frame = m_frames[m_depth];
+		int64_t durUs = nowUs - frame.startUs;
+		if( durUs >= (frame.name? m_thresholdUs/4 : m_thresholdUs) )
+		{
+			AddEvent(wxString::Format(wxT("{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.0f,\"dur\":%.0f,\"pid\":1,\"tid\":1,\"args\":{%s}}"),
+			                          GetFrameName(frame).c_str(),
+			                          frame.name? wxT("scope") : wxT("handler"),
+			                          (double)(frame.startUs-m_startUs), (double)durUs,
+			                          GetFrameArgs(frame).c_str()));
+		}
+	}
+}
+
+
+void SjStallWatch::Sample()
+{
+	// called by the thread
+	int64_t nowUs = GetUsTicks();
+
+	wxCriticalSectionLocker locker(m_critical);
+
+	int64_t stalledUs = nowUs - m_lastActivityUs;
+	if( m_depth > 0 && stalledUs >= m_thresholdUs )
+	{
+		if( m_lastStallUs != m_lastActivityUs ) {
+			m_lastStallUs = m_lastActivityUs;
+			m_stallCount++;
+		}
+
+		// record the innermost frame we know; this is where the main thread hangs
+		const SjStallFrame& frame = m_frames[(m_depth<SJ_STALL_MAX_DEPTH? m_depth : SJ_STALL_MAX_DEPTH)-1];
+		AddEvent(wxString::Format(wxT("{\"name\":\"stall\",\"cat\":\"sample\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.0f,\"pid\":1,\"tid\":1,\"args\":{\"in\":\"%s\",\"stalledMs\":%i}}"),
+		                          (double)(nowUs-m_startUs),
+		                          GetFrameName(frame).c_str(),
+		                          (int)(stalledUs/1000)));
+	}
+}
+
+
+void SjStallWatch::AddEvent(const wxString& json)
+{
+	// m_critical must be locked by the caller (or the thread is not yet started)
+	if( m_events.GetCount() < SJ_STALL_MAX_EVENTS ) {
+		m_events.Add(json);
+	}
+	else {
+		m_droppedEvents++;
+	}
+}
+
+
+wxString SjStallWatch::GetFrameName(const SjStallFrame& frame) const
+{
+	if( frame.name ) {
+		return wxString::FromAscii(frame.name);
+	}
+	else if( frame.eventClass ) {
+		return frame.eventClass->GetClassName();
+	}
+	return wxT("event");
+}
+
+
+wxString SjStallWatch::GetFrameArgs(const SjStallFrame& frame) const
+{
+	if( frame.name ) {
+		return wxT("");
+	}
+	return wxString::Format(wxT("\"type\":%i,\"id\":%i"), frame.eventType, frame.eventId);
+}
+
+
+void SjStallWatch::WriteTrace()
+{
+	// called from the destructor, the thread is no longer running
+	wxString content(wxT("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"));
+	for( size_t i = 0; i < m_events.GetCount(); i++ )
+	{
+		content += m_events[i];
+		content += (i < m_events.GetCount()-1)? wxT(",\n") : wxT("\n");
+	}
+	content += wxT("]}\n");
+
+	wxFile file;
+	if( !file.Create(m_traceFile, true/*overwrite*/) || !file.Write(content, wxConvUTF8) )
+	{
+		wxLogError(_("Cannot write \"%s\"."), m_traceFile.c_str());
+		return;
+	}
+
+	wxLogInfo(wxT("%i main thread stalls, %i events written to %s (%i events dropped)"),
+	          (int)m_stallCount, (int)m_events.GetCount(), m_traceFile.c_str(), (int)m_droppedEvents);
+}
@@ -0,0 +1,121 @@
+/*******************************************************************************
+ *
+ *                                 Silverjuke
+ *     Copyright (C) 2016 Björn Petersen Software Design and Development
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ *******************************************************************************
+ *
+ * File:    stallwatch.h
+ * Authors: Björn Petersen
+ * Purpose: Finding out where the main thread is blocked
+ *
+ ******************************************************************************/
+
+
+#ifndef __SJ_STALLWATCH_H__
+#define __SJ_STALLWATCH_H__
+
+
+class SjStallWatchThread;
+
+
+// a handler or scope currently running on the main thread
+struct SjStallFrame
+{
+	const char*         name;       // NULL for event handlers
+	const wxClassInfo*  eventClass;
+	int                 eventType;
+	int                 eventId;
+	int64_t             startUs;
+};
+
+
+// SjStallWatch records all event handlers and named scopes (see SJ_STALL_SCOPE)
+// on the main thread that take longer than a given threshold; named scopes
+// are already recorded if they take a quarter of this time.  In addition, a
+// thread samples the main thread: if it does not enter or leave any handler or
+// scope for longer than the threshold, the innermost scope is recorded as
+// "stall" every threshold/2 milliseconds.
+//
+// On exit, everything is written as a Chrome trace file, which can be viewed
+// eg. with chrome://tracing or https://ui.perfetto.dev .
+//
+// The watchdog is enabled by the threshold given in main/stallWatchdog; if it is
+// disabled, a scope costs nothing but a pointer check.
+class SjStallWatch
+{
+public:
+	// Start/stop watching, called by SjMainApp
+	static void     Init                (long thresholdMs, const wxString& traceFile);
+	static void     Exit                ();
+	static bool     IsEnabled           () { return s_this!=NULL; }
+
+private:
+	// private stuff
+	                SjStallWatch        (long thresholdMs, const wxString& traceFile);
+	                ~SjStallWatch       ();
+	static SjStallWatch* s_this;
+
+	#define         SJ_STALL_MAX_DEPTH  64
+	#define         SJ_STALL_MAX_EVENTS 100000
+	wxCriticalSection m_critical;       // protects all members below accessed by the thread
+	SjStallFrame    m_frames[SJ_STALL_MAX_DEPTH];
+	int             m_depth;
+	int64_t         m_lastActivityUs;   // last enter or leave of a handler or scope
+	int64_t         m_lastStallUs;      // m_lastActivityUs of the last stall counted
+	wxArrayString   m_events;
+	long            m_droppedEvents;
+	long            m_stallCount;
+
+	int64_t         m_startUs;
+	int64_t         m_thresholdUs;
+	wxString        m_traceFile;
+	wxSemaphore     m_exitSemaphore;
+	SjStallWatchThread* m_thread;
+
+	void            Enter               (const char* name, const wxEvent* event);
+	void            Leave               ();
+	void            Sample              ();
+	void            AddEvent            (const wxString& json);
+	wxString        GetFrameName        (const SjStallFrame&) const;
+	wxString        GetFrameArgs        (const SjStallFrame&) const;
+	void            WriteTrace          ();
+	static int64_t  GetUsTicks          ();
+
+	friend class    SjStallScope;
+	friend class    SjStallWatchThread;
+};
+
+
+class SjStallScope
+{
+public:
+	                SjStallScope        (const char* name)     { m_enabled = (SjStallWatch::s_this && wxThread::IsMain()); if(m_enabled) {SjStallWatch::s_this->Enter(name, NULL);} }
+	                SjStallScope        (const wxEvent& event) { m_enabled = (SjStallWatch::s_this && wxThread::IsMain()); if(m_enabled) {SjStallWatch::s_this->Enter(NULL, &event);} }
+	                ~SjStallScope       ()                     { if(m_enabled && SjStallWatch::s_this) {SjStallWatch::s_this->Leave();} }
+
+private:
+	bool            m_enabled;
+};
+
+
+// Place SJ_STALL_SCOPE("name") at the beginning of a function (or block) that
+// may take a while on the main thread; the name must be a string constant.
+#define SJ_STALL_SCOPE(name) SjStallScope sjStallScope__(name)
+
+
+#endif // __SJ_STALLWATCH_H__
@@ -505,6 +505,19 @@ void SjTestdrive1()
 
 
 
+	/* Check the query plans of the music library; all frequently used queries
+	should use an index, see SjLibraryModule::UpdateIndexes() */
+	if( g_debug&0x08 )
+	{
+		if( g_mainFrame->m_libraryModule
+		 && g_mainFrame->m_libraryModule->CheckQueryPlans() > 0 )
+		{
+			wxLogWarning(wxT("Testdrive: Some library queries do not use an index."));
+		}
+	}
+
+
+
 	/* Scripting tests */
 	#if SJ_USE_SCRIPTS
 	if( g_debug&0x04 )
@@ -39,6 +39,8 @@ class SjMainFrame;
 
 
 #include "hash.h"
+#include "hiliter.h"
+#include "idset.h"
 #include "levensthein.h"
 #include "homepageids.h"
 #include "timeout.h"